@@ -12,6 +12,7 @@
 
 #include "misc.h"
 #include "assert.h"
+#include "memory_pool.h"
 
 namespace codepad {
 	/// A struct used to specify that no additional data is stored in the nodes of a \ref binary_tree.
@@ -44,6 +45,40 @@ namespace codepad {
 		template <typename Node> void operator()(Node&&) const {
 		}
 	};
+	/// A node allocator that uses \p new and \p delete.
+	struct heap_node_allocator {
+		/// Allocates and constructs a node.
+		template <typename Node, typename ...Args> [[nodiscard]] inline static Node *create(Args &&...args) {
+			return new Node(std::forward<Args>(args)...);
+		}
+		/// Destroys and frees a node.
+		template <typename Node> inline static void destroy(Node *n) {
+			delete n;
+		}
+	};
+	/// A node allocator that allocates nodes from a \ref fixed_size_block_pool shared by all nodes with the same size
+	/// and alignment. Nodes that are allocated together are kept close in memory, which helps traversal, and most
+	/// allocations don't go through the global heap. Nodes can be moved freely between trees that use this allocator.
+	struct pooled_node_allocator {
+		/// The pool used for the given node type.
+		template <typename Node> using pool = fixed_size_block_pool<sizeof(Node), alignof(Node)>;
+
+		/// Allocates and constructs a node.
+		template <typename Node, typename ...Args> [[nodiscard]] inline static Node *create(Args &&...args) {
+			void *mem = pool<Node>::allocate();
+			try {
+				return new (mem) Node(std::forward<Args>(args)...);
+			} catch (...) {
+				pool<Node>::deallocate(mem);
+				throw;
+			}
+		}
+		/// Destroys and frees a node.
+		template <typename Node> inline static void destroy(Node *n) {
+			n->~Node();
+			pool<Node>::deallocate(n);
+		}
+	};
 	/// Inserts or searches for a node in a tree as if it were a binary search tree.
 	///
 	/// \tparam Comp Comparison function used to compare the values held by nodes.
@@ -149,9 +184,11 @@ namespace codepad {
 	/// \tparam Synth Provides operator() to calculate \ref binary_tree_node::synth_data. If this is
 	///               \ref lacks_synthesizer, then there will be no default synthesizer and all methods that make use
 	///               of it will be disabled.
+	/// \tparam NodeAllocator Used to allocate and free nodes. See \ref pooled_node_allocator.
 	/// \sa binary_tree_node
 	template <
-		typename T, typename AdditionalData = no_data, typename Synth = default_synthesizer<AdditionalData>
+		typename T, typename AdditionalData = no_data, typename Synth = default_synthesizer<AdditionalData>,
+		typename NodeAllocator = pooled_node_allocator
 	> struct binary_tree {
 	public:
 		using node = binary_tree_node<T, AdditionalData>; ///< The type of tree nodes.
@@ -442,7 +479,7 @@ namespace codepad {
 		template <typename BranchSelector, typename MySynth, typename ...Args> iterator select_insert(
 			BranchSelector &&d, MySynth &&synth, Args &&...args
 		) {
-			node *n = new node(std::forward<Args>(args)...), *prev = nullptr, **pptr = &_root;
+			node *n = create_node(std::forward<Args>(args)...), *prev = nullptr, **pptr = &_root;
 			while (*pptr) {
 				prev = *pptr;
 				pptr = d.select_insert(*prev, *n) ? &prev->left : &prev->right;
@@ -528,7 +565,7 @@ namespace codepad {
 		template <typename MySynth, typename ...Args> iterator emplace_before_custom_synth(
 			node *before, MySynth &&synth, Args &&...args
 		) {
-			node *n = new node(std::forward<Args>(args)...);
+			node *n = create_node(std::forward<Args>(args)...);
 			synth(*n);
 			insert_before(before, n, std::forward<MySynth>(synth));
 			return get_iterator_for(n);
@@ -746,7 +783,7 @@ namespace codepad {
 			if (oc) {
 				oc->parent = f;
 			}
-			delete n;
+			destroy_node(n);
 			refresh_synthesized_result(f, std::forward<MySynth>(synth));
 			return next;
 		}
@@ -906,6 +943,15 @@ namespace codepad {
 		}
 
 
+		/// Allocates and constructs a detached node using \p NodeAllocator.
+		template <typename ...Args> [[nodiscard]] inline static node *create_node(Args &&...args) {
+			return NodeAllocator::template create<node>(std::forward<Args>(args)...);
+		}
+		/// Destroys and frees a detached node that's been created by \ref create_node().
+		inline static void destroy_node(node *n) {
+			NodeAllocator::destroy(n);
+		}
+
 		/// Clones a tree.
 		///
 		/// \param n The root of the tree to clone.
@@ -920,7 +966,7 @@ namespace codepad {
 			do {
 				_clone_node curv = stk.top();
 				stk.pop();
-				auto *cn = new node(curv.src->value);
+				auto *cn = create_node(curv.src->value);
 				// copy synth data directly because we're replicating the tree structure exactly
 				cn->synth_data = curv.src->synth_data;
 				cn->parent = curv.parent;
@@ -952,7 +998,7 @@ namespace codepad {
 				if (c->right) {
 					ns.emplace(c->right);
 				}
-				delete c;
+				destroy_node(c);
 			} while (!ns.empty());
 		}
 		/// Builds a tree from an array of objects. Objects are copied from the container.
@@ -963,7 +1009,23 @@ namespace codepad {
 		/// \return The root of the newly built tree.
 		template <typename It, typename SynRef> inline static node *build_tree_copy(It &&beg, It &&end, SynRef &&synth) {
 			return _build_tree<_copy_value>(
-				std::forward<It>(beg), std::forward<It>(end), std::forward<SynRef>(synth)
+				std::forward<It>(beg), std::forward<It>(end), 0, std::forward<SynRef>(synth), _no_visit()
+				);
+		}
+		/// Builds a tree from an array of objects, calling the given visitor for each node before it's synthesized.
+		/// Objects are copied from the container.
+		///
+		/// \param beg Iterator to the first element.
+		/// \param end Iterator past the last element.
+		/// \param synth The synthesizer used.
+		/// \param visit Called with each node and its depth, where the root has depth 0. Nodes are visited in
+		///              post-order.
+		/// \return The root of the newly built tree.
+		template <typename It, typename SynRef, typename Visit> inline static node *build_tree_copy(
+			It &&beg, It &&end, SynRef &&synth, Visit &&visit
+		) {
+			return _build_tree<_copy_value>(
+				std::forward<It>(beg), std::forward<It>(end), 0, std::forward<SynRef>(synth), std::forward<Visit>(visit)
 				);
 		}
 		/// Builds a tree from an array of objects. Objects are moved out of the container.
@@ -974,7 +1036,18 @@ namespace codepad {
 		/// \return The root of the newly built tree.
 		template <typename It, typename SynRef> inline static node *build_tree_move(It &&beg, It &&end, SynRef &&synth) {
 			return _build_tree<_move_value>(
-				std::forward<It>(beg), std::forward<It>(end), std::forward<SynRef>(synth)
+				std::forward<It>(beg), std::forward<It>(end), 0, std::forward<SynRef>(synth), _no_visit()
+				);
+		}
+		/// Builds a tree from an array of objects, calling the given visitor for each node before it's synthesized.
+		/// Objects are moved out of the container.
+		///
+		/// \sa build_tree_copy(It&&, It&&, SynRef&&, Visit&&)
+		template <typename It, typename SynRef, typename Visit> inline static node *build_tree_move(
+			It &&beg, It &&end, SynRef &&synth, Visit &&visit
+		) {
+			return _build_tree<_move_value>(
+				std::forward<It>(beg), std::forward<It>(end), 0, std::forward<SynRef>(synth), std::forward<Visit>(visit)
 				);
 		}
 		/// Searches in a tree for a matching node using a branch selector.
@@ -1028,25 +1101,35 @@ namespace codepad {
 			/// \param it The iterator to copy value from.
 			/// \return A pointer to the newly created node.
 			template <typename It> inline static node *get(It it) {
-				return new node(*it);
+				return create_node(*it);
 			}
 		};
 		/// Struct that moves values from iterators to initialize nodes.
 		struct _move_value {
 			/// \sa _copy_value::get
 			template <typename It> inline static node *get(It it) {
-				return new node(std::move(*it));
+				return create_node(std::move(*it));
+			}
+		};
+
+		/// Visitor for \ref _build_tree() that does nothing.
+		struct _no_visit {
+			/// Does nothing.
+			void operator()(node&, std::size_t) const {
 			}
 		};
 
-		/// Builds a tree from a range of elements using the designated synthesizer and construct operation.
+		/// Builds a tree from a range of elements using the designated synthesizer and construct operation. The
+		/// range is recursively halved, so all leaves of the resulting tree are on its last two levels.
 		///
 		/// \tparam Op Either \ref _copy_value or \ref _move_value. Indicates whether values are copied or moved.
 		/// \param beg Iterator to the first element.
 		/// \param end Iterator past the last element.
-		/// \param s The synthesizer used.
-		template <typename Op, typename It, typename SynRef> inline static node *_build_tree(
-			It beg, It end, SynRef &&synth
+		/// \param depth The depth of the root of the subtree that's being built.
+		/// \param synth The synthesizer used.
+		/// \param visit Called for every node and its depth before the node is synthesized.
+		template <typename Op, typename It, typename SynRef, typename Visit> inline static node *_build_tree(
+			It beg, It end, std::size_t depth, SynRef &&synth, Visit &&visit
 		) {
 			if (beg == end) {
 				return nullptr;
@@ -1054,8 +1137,12 @@ namespace codepad {
 			auto half = beg + (end - beg) / 2;
 			// recursively call _build_tree
 			node
-				*left = _build_tree<Op, It, SynRef>(beg, half, std::forward<SynRef>(synth)),
-				*right = _build_tree<Op, It, SynRef>(half + 1, end, std::forward<SynRef>(synth)),
+				*left = _build_tree<Op, It, SynRef, Visit>(
+					beg, half, depth + 1, std::forward<SynRef>(synth), std::forward<Visit>(visit)
+				),
+				*right = _build_tree<Op, It, SynRef, Visit>(
+					half + 1, end, depth + 1, std::forward<SynRef>(synth), std::forward<Visit>(visit)
+				),
 				*cur = Op::get(half);
 			cur->left = left;
 			cur->right = right;
@@ -1065,6 +1152,7 @@ namespace codepad {
 			if (cur->right) {
 				cur->right->parent = cur;
 			}
+			visit(*cur, depth);
 			synth(*cur);
 			return cur;
 		}
@@ -6,6 +6,7 @@
 /// \file
 /// Basic mathmatics.
 
+#include <algorithm>
 #include <cmath>
 #include <type_traits>
 
@@ -546,6 +547,16 @@ namespace codepad {
 				elem[1][0] * v.x + elem[1][1] * v.y + elem[1][2]
 				);
 		}
+		/// Returns the bounding box of the given rectangle transformed by this matrix.
+		[[nodiscard]] std::enable_if_t<W == 3 && H == 3, rect<T>> transform_bounding_box(rect<T> r) const {
+			vec2<T>
+				p1 = transform_position(r.xmin_ymin()), p2 = transform_position(r.xmax_ymin()),
+				p3 = transform_position(r.xmin_ymax()), p4 = transform_position(r.xmax_ymax());
+			return rect<T>(
+				std::min({ p1.x, p2.x, p3.x, p4.x }), std::max({ p1.x, p2.x, p3.x, p4.x }),
+				std::min({ p1.y, p2.y, p3.y, p4.y }), std::max({ p1.y, p2.y, p3.y, p4.y })
+			);
+		}
 
 		/// Returns a matrix that translates vectors by a given offset.
 		///
@@ -0,0 +1,161 @@
+// Copyright (c) the Codepad contributors. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+/// \file
+/// Pooled allocation of fixed-size memory blocks.
+
+#include <cstddef>
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace codepad {
+	/// A process-wide pool of memory blocks with the given size and alignment. Blocks are carved out of large slabs
+	/// so that blocks allocated one after another are adjacent in memory. Freed blocks are kept in a per-thread free
+	/// list and are exchanged with a shared free list in batches, so most allocations and deallocations don't need
+	/// to acquire any lock. A block may be freed on a thread different from the one that allocated it.
+	///
+	/// Slabs are never returned to the system. This means that a block obtained from one instantiation of this pool
+	/// can also be safely returned to another instantiation with the same parameters (e.g., one in a different
+	/// shared library), and that blocks can be freed during static destruction.
+	///
+	/// \tparam Size The minimum size of a block.
+	/// \tparam Align The minimum alignment of a block.
+	template <std::size_t Size, std::size_t Align> class fixed_size_block_pool {
+	public:
+		/// The alignment of all blocks.
+		constexpr static std::size_t block_alignment = std::max(Align, alignof(void*));
+		/// The actual size of a block.
+		constexpr static std::size_t block_size =
+			(std::max(Size, sizeof(void*)) + block_alignment - 1) / block_alignment * block_alignment;
+		/// The number of blocks in a slab. Each slab is roughly 64 KiB large.
+		constexpr static std::size_t blocks_per_slab = std::max<std::size_t>(64, 65536 / block_size);
+		/// The number of blocks that are moved between a thread-local free list and the shared free list at once.
+		constexpr static std::size_t batch_size = std::min<std::size_t>(64, blocks_per_slab);
+
+		/// Allocates a block.
+		[[nodiscard]] inline static void *allocate() {
+			_thread_cache &cache = _get_thread_cache();
+			if (cache.head == nullptr) {
+				_refill(cache);
+			}
+			_free_block *res = cache.head;
+			cache.head = res->next;
+			--cache.count;
+			return res;
+		}
+		/// Returns a block to the pool.
+		inline static void deallocate(void *ptr) {
+			_thread_cache &cache = _get_thread_cache();
+			auto *block = static_cast<_free_block*>(ptr);
+			block->next = cache.head;
+			cache.head = block;
+			++cache.count;
+			if (cache.flushed) { // the thread is exiting; don't keep any blocks
+				_return_blocks(cache, cache.count);
+			} else if (cache.count >= 2 * batch_size) {
+				_return_blocks(cache, batch_size);
+			}
+		}
+	protected:
+		/// A block that's not in use.
+		struct _free_block {
+			_free_block *next; ///< The next free block.
+		};
+		/// Free list of a single thread. This struct is trivially destructible so that it can still be used by
+		/// objects that are destroyed after \ref _thread_cache_flusher.
+		struct _thread_cache {
+			_free_block *head = nullptr; ///< The first free block.
+			std::size_t count = 0; ///< The number of blocks in this list.
+			bool flushed = false; ///< Whether \ref _thread_cache_flusher has been destroyed.
+		};
+		/// Returns all blocks in a \ref _thread_cache to the shared free list when the thread exits.
+		struct _thread_cache_flusher {
+			/// Initializes \ref cache.
+			explicit _thread_cache_flusher(_thread_cache &c) : cache(c) {
+			}
+			/// Returns all blocks and marks the cache as flushed.
+			~_thread_cache_flusher() {
+				_return_blocks(cache, cache.count);
+				cache.flushed = true;
+			}
+
+			_thread_cache &cache; ///< The cache.
+		};
+		/// State shared among all threads.
+		struct _shared_state {
+			std::mutex lock; ///< Protects all other fields.
+			_free_block *head = nullptr; ///< The first block in the shared free list.
+			std::byte
+				*slab_next = nullptr, ///< The first unused block in the current slab.
+				*slab_end = nullptr; ///< The end of the current slab.
+		};
+
+		/// Returns the \ref _shared_state. The state is allocated on first use and intentionally never freed, so
+		/// that it outlives all \ref _thread_cache objects and all static objects that may own blocks.
+		[[nodiscard]] inline static _shared_state &_get_shared_state() {
+			static _shared_state *_state = new _shared_state();
+			return *_state;
+		}
+		/// Returns the \ref _thread_cache of this thread.
+		[[nodiscard]] inline static _thread_cache &_get_thread_cache() {
+			thread_local _thread_cache _cache;
+			thread_local _thread_cache_flusher _flusher(_cache);
+			return _cache;
+		}
+
+		/// Moves at most \ref batch_size blocks from the shared free list into the given cache. If the shared free
+		/// list is empty, carves new blocks out of the current slab, allocating a new slab if necessary.
+		inline static void _refill(_thread_cache &cache) {
+			_shared_state &state = _get_shared_state();
+			std::lock_guard<std::mutex> guard(state.lock);
+			if (state.head) {
+				_free_block *last = state.head;
+				std::size_t count = 1;
+				for (; count < batch_size && last->next; ++count) {
+					last = last->next;
+				}
+				cache.head = std::exchange(state.head, last->next);
+				last->next = nullptr;
+				cache.count = count;
+				return;
+			}
+			if (state.slab_next == state.slab_end) {
+				state.slab_next = static_cast<std::byte*>(::operator new(
+					block_size * blocks_per_slab, std::align_val_t(block_alignment)
+				));
+				state.slab_end = state.slab_next + block_size * blocks_per_slab;
+			}
+			// link the new blocks in reverse so that they're handed out in increasing address order
+			std::byte *end = std::min(state.slab_end, state.slab_next + block_size * batch_size);
+			for (std::byte *cur = end; cur != state.slab_next; ) {
+				cur -= block_size;
+				auto *block = reinterpret_cast<_free_block*>(cur);
+				block->next = cache.head;
+				cache.head = block;
+				++cache.count;
+			}
+			state.slab_next = end;
+		}
+		/// Moves the given number of blocks from the front of the given cache to the shared free list.
+		inline static void _return_blocks(_thread_cache &cache, std::size_t count) {
+			if (count == 0) {
+				return;
+			}
+			_free_block *first = cache.head, *last = first;
+			for (std::size_t i = 1; i < count; ++i) {
+				last = last->next;
+			}
+			cache.head = last->next;
+			cache.count -= count;
+
+			_shared_state &state = _get_shared_state();
+			std::lock_guard<std::mutex> guard(state.lock);
+			last->next = state.head;
+			state.head = first;
+		}
+	};
+}
@@ -3,6 +3,8 @@
 /// \file
 /// Implementation of red-black tree operations.
 
+#include <bit>
+
 #include "binary_tree.h"
 
 /// Implementation of red-black tree oprations.
@@ -542,10 +544,12 @@ namespace codepad::red_black_tree {
 	/// may corrupt the red-black tree structure and is not recommended.
 	template <
 		typename T, typename RedBlackAccess,
-		typename AdditionalData = no_data, typename Synth = default_synthesizer<AdditionalData>
-	> class tree : protected binary_tree<T, AdditionalData, Synth> {
+		typename AdditionalData = no_data, typename Synth = default_synthesizer<AdditionalData>,
+		typename NodeAllocator = pooled_node_allocator
+	> class tree : protected binary_tree<T, AdditionalData, Synth, NodeAllocator> {
 	public:
-		using binary_tree_t = binary_tree<T, AdditionalData, Synth>; ///< The base binary tree type.
+		/// The base binary tree type.
+		using binary_tree_t = binary_tree<T, AdditionalData, Synth, NodeAllocator>;
 
 		using typename binary_tree_t::node;
 		using typename binary_tree_t::iterator;
@@ -592,7 +596,7 @@ namespace codepad::red_black_tree {
 			node *next = detach(
 				*static_cast<binary_tree_t*>(this), it.get_node(), _rb_access, std::forward<MySynth>(synth)
 			);
-			delete n;
+			destroy_node(n);
 			return this->get_iterator_for(next);
 		}
 		/// Erases the given node using the default synthesizer.
@@ -619,6 +623,9 @@ namespace codepad::red_black_tree {
 
 		using binary_tree_t::root;
 
+		using binary_tree_t::create_node;
+		using binary_tree_t::destroy_node;
+
 
 		/// Merges two trees using the middle node (which must be isolated), and returns the new tree. The red black
 		/// access and synthesizer of the left tree are used for this operation and the new tree.
@@ -637,7 +644,7 @@ namespace codepad::red_black_tree {
 		template <typename ...Args> [[nodiscard]] inline static tree join_trees(
 			tree left, tree right, Args &&...center
 		) {
-			return join_trees(std::move(left), std::move(right), new node(std::forward<Args>(center)...));
+			return join_trees(std::move(left), std::move(right), create_node(std::forward<Args>(center)...));
 		}
 
 		/// Splits a tree into one tree containing all nodes before the given node, one tree containing all nodes
@@ -664,6 +671,38 @@ namespace codepad::red_black_tree {
 			return std::make_tuple(std::move(split.first), n.get_node(), std::move(split.second));
 		}
 
+		/// Builds a new tree from the given range of values in linear time, using the synthesizer and red black
+		/// access of this tree. Nodes are constructed from the dereferenced iterators, so a
+		/// \p std::move_iterator can be used to move values out of the range. The tree is perfectly balanced:
+		/// nodes on the deepest level are colored red if it's not the root, and all other nodes are colored black.
+		template <typename It> [[nodiscard]] tree build_from_range(It beg, It end) {
+			tree result(this->_synth, _rb_access);
+			auto count = static_cast<std::size_t>(end - beg);
+			if (count == 0) {
+				return result;
+			}
+			// halving the range results in a tree whose deepest level has index floor(log2(count)), and all leaves
+			// are on the last two levels
+			auto max_depth = static_cast<std::size_t>(std::bit_width(count) - 1);
+			result.mutable_root() = binary_tree_t::build_tree_copy(
+				beg, end, result.get_synthesizer(), [&result, max_depth](node &n, std::size_t depth) {
+					result._rb_access.set(n, depth > 0 && depth == max_depth ? color::red : color::black);
+				}
+			);
+			return result;
+		}
+		/// Inserts the given range of values before the given position. The values are copied. This first builds
+		/// the range into a tree using \ref build_from_range(), then inserts it using \ref insert_range().
+		template <typename It> void insert_range_before_copy(const_iterator it, It beg, It end) {
+			insert_range(build_from_range(std::move(beg), std::move(end)), it);
+		}
+		/// Similar to \ref insert_range_before_copy(), but values are moved out of the range.
+		template <typename It> void insert_range_before_move(const_iterator it, It beg, It end) {
+			insert_range_before_copy(
+				it, std::make_move_iterator(std::move(beg)), std::make_move_iterator(std::move(end))
+			);
+		}
+
 		/// Inserts the tree before the given position.
 		void insert_range(tree t, const_iterator it) {
 			assert_true_logical(it.get_container() == this, "iterator does not belong to this tree");
@@ -672,6 +711,10 @@ namespace codepad::red_black_tree {
 			if (detached == nullptr) {
 				return;
 			}
+			if (this->mutable_root() == nullptr) { // this tree is empty, simply take the other tree
+				this->mutable_root() = std::exchange(t.mutable_root(), nullptr);
+				return;
+			}
 			for (; detached->left; detached = detached->left) {
 			}
 			detach(t.raw_tree(), detached, t._rb_access, t.get_synthesizer());
@@ -632,6 +632,9 @@ namespace codepad::regex {
 			std::deque<ast_nodes::node_ref> dependency_queue;
 			/// Nodes queued to have their \ref _end_analysis() function called.
 			std::deque<ast_nodes::node_ref> end_stack;
+			/// All capturing subexpressions, used to look up the groups referenced by subroutines.
+			std::vector<ast_nodes::node_ref> capture_groups;
+			std::size_t num_subroutines = 0; ///< The number of subroutine nodes in the expression.
 			analysis output; ///< Analysis result.
 		};
 
@@ -738,18 +741,12 @@ namespace codepad::regex {
 			// TODO we can do more analysis here
 			return result;
 		}
-		/// Analyzes a \ref ast_nodes::numbered_subroutine node.
-		[[nodiscard]] ast_nodes::analysis _analyze(const ast_nodes::numbered_subroutine&, _analysis_context&) const {
-			ast_nodes::analysis result;
-			// TODO we can do more analysis here
-			return result;
-		}
-		/// Analyzes a \ref ast_nodes::named_subroutine node.
-		[[nodiscard]] ast_nodes::analysis _analyze(const ast_nodes::named_subroutine&, _analysis_context&) const {
-			ast_nodes::analysis result;
-			// TODO we can do more analysis here
-			return result;
-		}
+		/// Analyzes a \ref ast_nodes::numbered_subroutine node using the current analysis of the referenced group.
+		[[nodiscard]] ast_nodes::analysis _analyze(
+			const ast_nodes::numbered_subroutine&, _analysis_context&
+		) const;
+		/// Analyzes a \ref ast_nodes::named_subroutine node using the current analysis of the referenced group.
+		[[nodiscard]] ast_nodes::analysis _analyze(const ast_nodes::named_subroutine&, _analysis_context&) const;
 		/// Analyzes a \ref ast_nodes::character_class node.
 		[[nodiscard]] ast_nodes::analysis _analyze(const ast_nodes::character_class&, _analysis_context&) const {
 			ast_nodes::analysis result;
@@ -6,7 +6,9 @@
 /// \file
 /// Compiler for regular expressions.
 
+#include <bitset>
 #include <deque>
+#include <optional>
 #include <variant>
 #include <vector>
 #include <map>
@@ -46,6 +48,34 @@ namespace codepad::regex {
 		};
 	}
 
+	/// The set of codepoints that all matches of a regular expression must start with. This is used by the matcher
+	/// to quickly skip positions where no match can start. The set may contain codepoints that no match starts
+	/// with, but never misses any.
+	struct first_codepoint_set {
+		codepoint_range_list
+			/// Codepoints that are matched exactly.
+			ranges,
+			/// Codepoints that are matched case-insensitively, with the same semantics as case-insensitive
+			/// character classes.
+			case_insensitive_ranges;
+
+		/// Sorts all ranges and computes \ref _ascii. This must be called after the ranges have been modified.
+		void finalize();
+
+		/// Returns whether a match may start with the given codepoint.
+		[[nodiscard]] bool contains(codepoint cp) const {
+			if (cp < _ascii.size()) {
+				return _ascii[cp];
+			}
+			return _contains_slow(cp);
+		}
+	protected:
+		std::bitset<128> _ascii; ///< Cached results for all ASCII codepoints.
+
+		/// Checks the ranges to determine whether the set contains the given codepoint.
+		[[nodiscard]] bool _contains_slow(codepoint) const;
+	};
+
 
 	/// Compiled components of a state machine.
 	template <typename DataTypes> class compiled {
@@ -277,21 +307,27 @@ namespace codepad::regex {
 				bool is_negate = false; ///< Whether the codepoint should not match any character in this class.
 				bool case_insensitive = false; ///< Whether the condition is case-insensitive.
 
-				/// Tests whether the given codepoint is matched by this character class.
+				/// Tests whether the given codepoint is matched by this character class. Latin-1 codepoints are
+				/// looked up in a bitmap once \ref build_lookup_table() has been called.
 				[[nodiscard]] bool matches(codepoint cp) const {
-					bool result = ranges.contains(cp);
-					if (case_insensitive && !result) {
-						result = ranges.contains(unicode::case_folding::get_cached().fold_simple(cp));
-						if (!result) {
-							for (auto folded : unicode::case_folding::get_cached().inverse_fold_simple(cp)) {
-								if (ranges.contains(folded)) {
-									result = true;
-									break;
-								}
-							}
-						}
+					if (_has_lookup_table && cp < _latin1.size()) {
+						return _latin1[cp];
 					}
-					return is_negate ? !result : result;
+					return _matches_slow(cp);
+				}
+				/// Computes the results for all Latin-1 codepoints without using the cache.
+				[[nodiscard]] std::bitset<256> compute_latin1() const {
+					std::bitset<256> result;
+					for (codepoint cp = 0; cp < result.size(); ++cp) {
+						result[cp] = _matches_slow(cp);
+					}
+					return result;
+				}
+				/// Caches the results for all Latin-1 codepoints in \ref _latin1. This must be called again after
+				/// any field has been modified.
+				void build_lookup_table() {
+					_latin1 = compute_latin1();
+					_has_lookup_table = true;
 				}
 
 				/// Converts to another data type.
@@ -302,8 +338,33 @@ namespace codepad::regex {
 					result.ranges = std::move(ranges);
 					result.is_negate = is_negate;
 					result.case_insensitive = case_insensitive;
+					result.build_lookup_table();
 					return result;
 				}
+			protected:
+				/// Cached results for all Latin-1 codepoints. This is only used when the class is part of a complex
+				/// condition such as \ref character_class_assertion that's checked by
+				/// \ref matcher::_check_transition(); character class transitions are lowered into instructions that
+				/// store their own bitmap in \ref compiled::pooled_character_class::latin1.
+				std::bitset<256> _latin1;
+				bool _has_lookup_table = false; ///< Whether \ref _latin1 has been computed.
+
+				/// Tests whether the given codepoint is matched by searching in \ref ranges.
+				[[nodiscard]] bool _matches_slow(codepoint cp) const {
+					bool result = ranges.contains(cp);
+					if (case_insensitive && !result) {
+						result = ranges.contains(unicode::case_folding::fold_simple(cp));
+						if (!result) {
+							for (auto folded : unicode::case_folding::inverse_fold_simple(cp)) {
+								if (ranges.contains(folded)) {
+									result = true;
+									break;
+								}
+							}
+						}
+					}
+					return is_negate ? !result : result;
+				}
 			};
 
 			/// Simple assertion.
@@ -622,10 +683,51 @@ namespace codepad::regex {
 			state_ref new_state; ///< The state to transition to.
 		};
 
+		/// The operation of an \ref instruction.
+		enum class opcode : std::uint8_t {
+			/// Matches \ref instruction::length codepoints in the literal pool starting at
+			/// \ref instruction::operand.
+			literal,
+			/// Same as \ref opcode::literal, but input codepoints are case folded before being compared.
+			literal_case_insensitive,
+			/// Matches one codepoint using the character class whose index is \ref instruction::operand.
+			character_class,
+			/// A \ref transitions::simple_assertion whose type is \ref instruction::operand.
+			simple_assertion,
+			capture_begin, ///< Starts the capture whose index is \ref instruction::operand.
+			capture_end, ///< \sa transitions::capture_end
+			reset_match_start, ///< \sa transitions::reset_match_start
+			push_position, ///< \sa transitions::push_position
+			check_infinite_loop, ///< \sa transitions::check_infinite_loop
+			/// Any other transition. \ref instruction::operand is the index of its condition, which can be
+			/// obtained using \ref state_machine::get_complex_condition().
+			complex,
+		};
+		/// A transition of a finalized \ref state_machine. The data of literals and character classes is stored
+		/// in pools shared by the whole state machine.
+		struct instruction {
+			opcode op = opcode::complex; ///< The operation.
+			std::uint32_t
+				operand = 0, ///< The operand. The meaning depends on \ref op.
+				length = 0; ///< The length of a literal.
+			state_ref new_state; ///< The state to transition to.
+		};
+		/// A character class whose ranges are stored in the range pool of a \ref state_machine.
+		struct pooled_character_class {
+			/// Results for all Latin-1 codepoints, with negation and case folding already applied.
+			std::bitset<256> latin1;
+			std::uint32_t
+				first_range = 0, ///< Index of the first range in the range pool.
+				past_last_range = 0; ///< Index past the last range in the range pool.
+			bool is_negate = false; ///< Whether the codepoint should not match any character in this class.
+			bool case_insensitive = false; ///< Whether the condition is case-insensitive.
+		};
+
 		/// A state in a \ref state_machine.
 		struct state {
-			transition_index first_transition = 0; ///< Index of the first transition associated with this state.
-			/// Index past the last trnasition assocaited with this state.
+			/// Index of the first instruction associated with this state.
+			transition_index first_transition = 0;
+			/// Index past the last instruction associated with this state.
 			transition_index past_last_transition = 0;
 		};
 		/// State machine corresponding to a regular expression.
@@ -640,14 +742,45 @@ namespace codepad::regex {
 			[[nodiscard]] state_ref get_end_state() const {
 				return _end_state;
 			}
-			/// Returns the transitions associated with the given \ref state_ref.
-			[[nodiscard]] std::span<const transition> get_transitions(state_ref r) const {
+			/// Returns the instructions associated with the given \ref state_ref.
+			[[nodiscard]] std::span<const instruction> get_instructions(state_ref r) const {
 				const auto &s = _states[r._index];
 				return {
-					_transitions.begin() + s.first_transition,
-					_transitions.begin() + s.past_last_transition
+					_instructions.begin() + s.first_transition,
+					_instructions.begin() + s.past_last_transition
 				};
 			}
+			/// Returns the number of states.
+			[[nodiscard]] std::size_t get_num_states() const {
+				return _states.size();
+			}
+			/// Returns the number of instructions of all states.
+			[[nodiscard]] std::size_t get_num_instructions() const {
+				return _instructions.size();
+			}
+			/// Returns the index of the given instruction among the instructions of all states.
+			[[nodiscard]] std::size_t get_instruction_index(const instruction &i) const {
+				return static_cast<std::size_t>(&i - _instructions.data());
+			}
+
+			/// Returns the contents of a \ref opcode::literal or \ref opcode::literal_case_insensitive
+			/// instruction.
+			[[nodiscard]] std::span<const codepoint> get_literal(const instruction &i) const {
+				return { _literal_pool.begin() + i.operand, _literal_pool.begin() + i.operand + i.length };
+			}
+			/// Tests whether the given codepoint is matched by the character class of a
+			/// \ref opcode::character_class instruction.
+			[[nodiscard]] bool matches_character_class(const instruction &i, codepoint cp) const {
+				const auto &cls = _class_pool[i.operand];
+				if (cp < cls.latin1.size()) {
+					return cls.latin1[cp];
+				}
+				return _matches_ranges(cls, cp);
+			}
+			/// Returns the condition of a \ref opcode::complex instruction.
+			[[nodiscard]] const typename transition::key &get_complex_condition(const instruction &i) const {
+				return _complex_conditions[i.operand];
+			}
 			/// Returns the \ref named_capture_registry.
 			[[nodiscard]] const named_capture_registry &get_named_captures() const {
 				return _named_captures;
@@ -657,14 +790,70 @@ namespace codepad::regex {
 			[[nodiscard]] const std::u8string &get_marker_name(marker_ref m) const {
 				return _marker_names[m._index];
 			}
+
+			/// Returns the set of codepoints that all matches start with, or \p std::nullopt if it cannot be
+			/// determined or if the expression can match empty strings.
+			[[nodiscard]] const std::optional<first_codepoint_set> &get_first_codepoints() const {
+				return _first_codepoints;
+			}
+			/// Returns whether this expression uses features that can only be matched by backtracking, i.e.,
+			/// backreferences, lookarounds, subroutines, conditions, atomic groups, and backtracking control verbs.
+			/// Other expressions can be matched in linear time.
+			[[nodiscard]] bool requires_backtracking() const {
+				return _requires_backtracking;
+			}
+			/// Returns one plus the largest index of all captures that appear in this state machine.
+			[[nodiscard]] std::size_t get_num_captures() const {
+				return _num_captures;
+			}
 		protected:
 			std::vector<state> _states; ///< States.
-			std::vector<transition> _transitions; ///< Transitions.
+			/// Instructions of all states. The instructions of each state are contiguous.
+			std::vector<instruction> _instructions;
+			std::vector<codepoint> _literal_pool; ///< Contents of all literals.
+			std::vector<pooled_character_class> _class_pool; ///< All character classes.
+			/// Sorted ranges of all character classes. Ranges of case-sensitive classes only contain codepoints
+			/// outside of Latin-1; ranges of case-insensitive classes are kept intact, since a codepoint outside of
+			/// Latin-1 may be case folded into Latin-1.
+			std::vector<codepoint_range> _range_pool;
+			/// Conditions of all \ref opcode::complex instructions.
+			std::vector<typename transition::key> _complex_conditions;
 			std::vector<std::u8string> _marker_names; ///< Sorted marker names.
 			/// Mapping from named captures to regular indexed captures.
 			named_capture_registry _named_captures;
+			std::optional<first_codepoint_set> _first_codepoints; ///< Codepoints that all matches start with.
+			bool _requires_backtracking = true; ///< \sa requires_backtracking()
+			std::size_t _num_captures = 0; ///< \sa get_num_captures()
 			state_ref _start_state; ///< The starting state.
 			state_ref _end_state; ///< The ending state.
+
+			/// Tests whether the given codepoint outside of Latin-1 is matched by the given character class by
+			/// searching in its ranges.
+			[[nodiscard]] bool _matches_ranges(const pooled_character_class &cls, codepoint cp) const {
+				auto contains = [&](codepoint c) {
+					auto end = _range_pool.begin() + cls.past_last_range;
+					auto it = std::lower_bound(
+						_range_pool.begin() + cls.first_range, end, c,
+						[](const codepoint_range &range, codepoint target) {
+							return range.last < target;
+						}
+					);
+					return it != end && c >= it->first;
+				};
+				bool result = contains(cp);
+				if (cls.case_insensitive && !result) {
+					result = contains(unicode::case_folding::fold_simple(cp));
+					if (!result) {
+						for (auto folded : unicode::case_folding::inverse_fold_simple(cp)) {
+							if (contains(folded)) {
+								result = true;
+								break;
+							}
+						}
+					}
+				}
+				return cls.is_negate ? !result : result;
+			}
 		};
 	};
 	using compiled_unoptimized = compiled<data_types::unoptimized>; ///< Unoptimized compiled components.
@@ -705,6 +894,11 @@ namespace codepad::regex {
 			compiled_unoptimized::state_ref start_state; ///< The starting state.
 			compiled_unoptimized::state_ref end_state; ///< The ending state.
 			std::vector<std::u8string> marker_names; ///< Sorted marker names.
+			/// Codepoints that all matches start with. See \ref compiled::state_machine::get_first_codepoints().
+			std::optional<first_codepoint_set> first_codepoints;
+			/// Whether this expression can only be matched by backtracking. See
+			/// \ref compiled::state_machine::requires_backtracking().
+			bool requires_backtracking = true;
 
 			/// Creates a new state in this \ref state_machine and returns its index.
 			[[nodiscard]] compiled_unoptimized::state_ref create_state();
@@ -736,24 +930,26 @@ namespace codepad::regex {
 				result._start_state = start_state.into<TargetDataTypes>();
 				result._marker_names = std::move(marker_names);
 				result._end_state = end_state.into<TargetDataTypes>();
+				result._first_codepoints = std::move(first_codepoints);
+				result._requires_backtracking = requires_backtracking;
 				result._states.reserve(states.size());
 				for (auto &st : states) {
 					auto &res_st = result._states.emplace_back();
 					res_st.first_transition = static_cast<typename TargetDataTypes::transition_index>(
-						result._transitions.size()
+						result._instructions.size()
 					);
 					for (auto &trans : st.transitions) {
-						auto &res_trans = result._transitions.emplace_back();
-						res_trans.new_state = trans.new_state.into<TargetDataTypes>();
+						auto &instr = result._instructions.emplace_back();
+						instr.new_state = trans.new_state.into<TargetDataTypes>();
 						std::visit(
 							[&](auto &&cond) {
-								res_trans.condition = std::move(cond).into<TargetDataTypes>();
+								_lower<TargetDataTypes>(result, instr, std::move(cond));
 							},
 							std::move(trans.condition)
 						);
 					}
 					res_st.past_last_transition = static_cast<typename TargetDataTypes::transition_index>(
-						result._transitions.size()
+						result._instructions.size()
 					);
 				}
 				return result;
@@ -761,6 +957,64 @@ namespace codepad::regex {
 
 			/// Dumps this state macine into a DOT file.
 			void dump(std::ostream&, bool valid_only = true) const;
+		protected:
+			/// Lowers the given transition condition into an \ref compiled::instruction. The contents of literals
+			/// are appended to the literal pool, and results for Latin-1 codepoints are computed for character
+			/// classes whose ranges are appended to the range pool. Conditions that are not inlined into the
+			/// instruction are converted and stored separately.
+			template <typename TargetDataTypes, typename Cond> static void _lower(
+				typename compiled<TargetDataTypes>::state_machine &sm,
+				typename compiled<TargetDataTypes>::instruction &instr,
+				Cond &&cond
+			) {
+				using _opcode = typename compiled<TargetDataTypes>::opcode;
+				using _transitions = compiled_unoptimized::transitions;
+				using _cond_t = std::decay_t<Cond>;
+
+				if constexpr (std::is_same_v<_cond_t, _transitions::literal>) {
+					instr.op = cond.case_insensitive ? _opcode::literal_case_insensitive : _opcode::literal;
+					instr.operand = static_cast<std::uint32_t>(sm._literal_pool.size());
+					instr.length = static_cast<std::uint32_t>(cond.contents.size());
+					sm._literal_pool.insert(sm._literal_pool.end(), cond.contents.begin(), cond.contents.end());
+				} else if constexpr (std::is_same_v<_cond_t, _transitions::character_class>) {
+					instr.op = _opcode::character_class;
+					instr.operand = static_cast<std::uint32_t>(sm._class_pool.size());
+					auto &cls = sm._class_pool.emplace_back();
+					cls.latin1 = cond.compute_latin1();
+					cls.is_negate = cond.is_negate;
+					cls.case_insensitive = cond.case_insensitive;
+					cls.first_range = static_cast<std::uint32_t>(sm._range_pool.size());
+					for (const auto &range : cond.ranges.ranges) {
+						if (cond.case_insensitive) {
+							sm._range_pool.emplace_back(range);
+						} else if (range.last >= cls.latin1.size()) {
+							sm._range_pool.emplace_back(
+								std::max(range.first, static_cast<codepoint>(cls.latin1.size())), range.last
+							);
+						}
+					}
+					cls.past_last_range = static_cast<std::uint32_t>(sm._range_pool.size());
+				} else if constexpr (std::is_same_v<_cond_t, _transitions::simple_assertion>) {
+					instr.op = _opcode::simple_assertion;
+					instr.operand = static_cast<std::uint32_t>(cond.assertion_type);
+				} else if constexpr (std::is_same_v<_cond_t, _transitions::capture_begin>) {
+					instr.op = _opcode::capture_begin;
+					instr.operand = static_cast<std::uint32_t>(cond.capture.get_index());
+					sm._num_captures = std::max<std::size_t>(sm._num_captures, cond.capture.get_index() + 1);
+				} else if constexpr (std::is_same_v<_cond_t, _transitions::capture_end>) {
+					instr.op = _opcode::capture_end;
+				} else if constexpr (std::is_same_v<_cond_t, _transitions::reset_match_start>) {
+					instr.op = _opcode::reset_match_start;
+				} else if constexpr (std::is_same_v<_cond_t, _transitions::push_position>) {
+					instr.op = _opcode::push_position;
+				} else if constexpr (std::is_same_v<_cond_t, _transitions::check_infinite_loop>) {
+					instr.op = _opcode::check_infinite_loop;
+				} else {
+					instr.op = _opcode::complex;
+					instr.operand = static_cast<std::uint32_t>(sm._complex_conditions.size());
+					sm._complex_conditions.emplace_back(std::move(cond).template into<TargetDataTypes>());
+				}
+			}
 		};
 	}
 
@@ -844,6 +1098,13 @@ namespace codepad::regex {
 		template <typename Node> void _collect_marker_name(const Node&) {
 		}
 
+		/// Computes \ref half_compiled::state_machine::first_codepoints by collecting all transitions that can be
+		/// taken first from the start state that consume codepoints.
+		[[nodiscard]] std::optional<first_codepoint_set> _find_first_codepoints() const;
+		/// Computes \ref half_compiled::state_machine::requires_backtracking by checking the types of all
+		/// transitions.
+		[[nodiscard]] bool _requires_backtracking() const;
+
 		/// Returns the fail state, creating it if necessary.
 		[[nodiscard]] compiled_unoptimized::state_ref _get_fail_state() {
 			if (!_fail_state) {
@@ -8,13 +8,14 @@
 
 #include <optional>
 #include <format>
-#include <deque>
+#include <vector>
 
 #include "compiler.h"
 
 namespace codepad::regex {
-	/// A spliced stack.
-	template <typename T, typename Container = std::deque<T>, typename MarkType = std::size_t> class spliced_stack {
+	/// A spliced stack. The storage is contiguous by default so that it can be cleared and reused without freeing
+	/// memory.
+	template <typename T, typename Container = std::vector<T>, typename MarkType = std::size_t> class spliced_stack {
 	public:
 		static_assert(std::is_unsigned_v<MarkType>, "Marker must be unsigned integral type.");
 
@@ -88,6 +89,10 @@ namespace codepad::regex {
 			_storage.resize(size, val);
 		}
 
+		/// Removes all elements without releasing the storage.
+		void clear() {
+			_storage.clear();
+		}
 		/// Erases the given range of elements.
 		void erase(const_iterator begin, const_iterator end) {
 			_storage.erase(begin, end);
@@ -203,12 +208,31 @@ namespace codepad::regex {
 		/// \p reject_empty_match is used both to determine if an empty match should be rejected based on the
 		/// previous result, and to notify the caller if the next empty match should be rejected.
 		///
+		/// Expressions that don't require backtracking (see
+		/// \ref compiled_types::state_machine::requires_backtracking()) are matched in linear time by simulating
+		/// all paths simultaneously, in which case \p max_iters is not used. The two engines may disagree on
+		/// repetitions whose body can match an empty string; see \ref _find_next_linear().
+		///
 		/// \return Starting position of the match.
 		[[nodiscard]] std::optional<result> find_next(
 			Stream &s, const typename compiled_types::state_machine &expr,
 			bool &reject_empty_match, std::size_t max_iters = 1000000
 		) {
+			if (!expr.requires_backtracking()) {
+				return _find_next_linear(s, expr, reject_empty_match);
+			}
+
+			const auto &first_codepoints = expr.get_first_codepoints();
 			while (true) {
+				if (first_codepoints) {
+					// skip to the next position where a match may start; such expressions never match empty strings
+					while (!s.empty() && !first_codepoints->contains(s.peek())) {
+						s.take();
+					}
+					if (s.empty()) {
+						break;
+					}
+				}
 				Stream temp = s;
 				if (auto res = try_match(temp, expr, reject_empty_match, max_iters)) {
 					// if this match is empty, reject the next match if it's empty
@@ -347,31 +371,34 @@ namespace codepad::regex {
 			/// Overriden match starting position before this state was pushed onto the stack.
 			std::optional<Stream> initial_match_begin;
 
-			/// Returns all transitions of the state.
-			[[nodiscard]] std::span<const typename compiled_types::transition> get_transitions(
+			/// Returns all instructions of the state.
+			[[nodiscard]] std::span<const typename compiled_types::instruction> get_instructions(
 				const typename compiled_types::state_machine &sm
 			) const {
-				return sm.get_transitions(automata_state);
+				return sm.get_instructions(automata_state);
 			}
-			/// Returns the associated \ref state_machine::transition.
-			[[nodiscard]] const typename compiled_types::transition &get_current_transition(
+			/// Returns the instruction of the current transition.
+			[[nodiscard]] const typename compiled_types::instruction &get_current_instruction(
 				const typename compiled_types::state_machine &sm
 			) const {
-				return get_transitions(sm)[transition];
+				return get_instructions(sm)[transition];
 			}
 		};
 
 		const typename compiled_types::state_machine *_expr = nullptr; ///< State machine for the expression.
 		result _result; ///< Cached match result.
 
-		std::deque<_state> _state_stack; ///< States for backtracking.
+		// the stacks below are cleared but not deallocated after each call to try_match(), so that their storage can
+		// be reused by subsequent attempts
+
+		std::vector<_state> _state_stack; ///< States for backtracking.
 
-		std::deque<_capture_info> _ongoing_captures; ///< Ongoing captures.
+		std::vector<_capture_info> _ongoing_captures; ///< Ongoing captures.
 		/// Size of \ref _state_stack at the beginning of each ongoing atomic group.
-		std::deque<std::size_t> _atomic_stack_sizes;
-		std::deque<_subroutine_stackframe> _subroutine_stack; ///< Subroutine stack.
-		std::deque<_checkpointed_stream> _checkpoint_stack; ///< Checkpoint stack.
-		std::deque<_stream_position> _stream_position_stack; ///< Saved stream positions.
+		std::vector<std::size_t> _atomic_stack_sizes;
+		std::vector<_subroutine_stackframe> _subroutine_stack; ///< Subroutine stack.
+		std::vector<_checkpointed_stream> _checkpoint_stack; ///< Checkpoint stack.
+		std::vector<_stream_position> _stream_position_stack; ///< Saved stream positions.
 
 		/// A spliced stack that stores the stack of captures that started before a state was pushed, and ended after
 		/// the state was pushed, but before the next state was pushed.
@@ -389,6 +416,177 @@ namespace codepad::regex {
 		/// state was pushed but before the next state was pushed.
 		spliced_stack<_stream_position> _state_finished_stream_positions;
 
+		/// Storage for the data of all threads of \ref _find_next_linear(). All positions are codepoint positions.
+		///
+		/// The data of each thread occupies a fixed-size slot in a single buffer, which contains the starting
+		/// position of the match, the starting position overriden using \p \\K, the number of ongoing captures,
+		/// the indices and starting positions of ongoing captures, and the starting positions and lengths of all
+		/// captures. Threads refer to their slots by offset. Freed slots are reused, and the buffer is kept across
+		/// calls, so no memory is allocated once the buffer can hold all threads that are alive at the same time.
+		class _thread_pool {
+		public:
+			/// Indicates that the match begin has not been overriden.
+			constexpr static std::size_t no_match_begin = std::numeric_limits<std::size_t>::max();
+
+			/// Frees all slots and sets the number of captures for all new slots.
+			void reset(std::size_t num_captures) {
+				_num_captures = num_captures;
+				_slot_size = 3 + 4 * num_captures;
+				_storage.clear();
+				_free_slots.clear();
+			}
+
+			/// Allocates a slot for a new thread that starts at the given position.
+			[[nodiscard]] std::size_t allocate(std::size_t start) {
+				std::size_t slot = _allocate();
+				std::size_t *data = _storage.data() + slot;
+				data[0] = start;
+				data[1] = no_match_begin;
+				data[2] = 0;
+				for (std::size_t i = 0; i < _num_captures; ++i) {
+					data[3 + 2 * (_num_captures + i)] = 0;
+					data[4 + 2 * (_num_captures + i)] = result::capture::invalid_capture_length;
+				}
+				return slot;
+			}
+			/// Allocates a slot that's a copy of the given slot.
+			[[nodiscard]] std::size_t copy(std::size_t slot) {
+				std::size_t new_slot = _allocate();
+				std::copy_n(_storage.begin() + slot, _slot_size, _storage.begin() + new_slot);
+				return new_slot;
+			}
+			/// Frees the given slot so that it can be reused.
+			void free(std::size_t slot) {
+				_free_slots.emplace_back(slot);
+			}
+
+			/// Returns the starting position of the match.
+			[[nodiscard]] std::size_t get_start(std::size_t slot) const {
+				return _storage[slot];
+			}
+			/// Returns the starting position overriden using \p \\K, or \ref no_match_begin.
+			[[nodiscard]] std::size_t get_match_begin(std::size_t slot) const {
+				return _storage[slot + 1];
+			}
+			/// Sets the starting position overriden using \p \\K.
+			void set_match_begin(std::size_t slot, std::size_t pos) {
+				_storage[slot + 1] = pos;
+			}
+			/// Starts a capture at the given position.
+			void begin_capture(std::size_t slot, std::size_t index, std::size_t pos) {
+				std::size_t &count = _storage[slot + 2];
+				assert_true_logical(count < _num_captures, "too many ongoing captures");
+				_storage[slot + 3 + 2 * count] = index;
+				_storage[slot + 4 + 2 * count] = pos;
+				++count;
+			}
+			/// Finishes the last ongoing capture at the given position.
+			void end_capture(std::size_t slot, std::size_t pos) {
+				std::size_t &count = _storage[slot + 2];
+				assert_true_logical(count > 0, "no ongoing captures");
+				--count;
+				std::size_t index = _storage[slot + 3 + 2 * count];
+				std::size_t begin = _storage[slot + 4 + 2 * count];
+				_storage[slot + 3 + 2 * (_num_captures + index)] = begin;
+				_storage[slot + 4 + 2 * (_num_captures + index)] = pos - begin;
+			}
+			/// Returns the starting position and length of the given capture. Unmatched captures have a length of
+			/// \ref result::capture::invalid_capture_length.
+			[[nodiscard]] std::pair<std::size_t, std::size_t> get_capture(std::size_t slot, std::size_t index) const {
+				return {
+					_storage[slot + 3 + 2 * (_num_captures + index)],
+					_storage[slot + 4 + 2 * (_num_captures + index)]
+				};
+			}
+			/// Returns the number of captures.
+			[[nodiscard]] std::size_t get_num_captures() const {
+				return _num_captures;
+			}
+		protected:
+			std::vector<std::size_t> _storage; ///< Slots of all threads.
+			std::vector<std::size_t> _free_slots; ///< Offsets of all slots that have been freed.
+			std::size_t
+				_num_captures = 0, ///< The number of captures.
+				_slot_size = 3; ///< The size of a slot.
+
+			/// Returns the offset of a free slot, extending the buffer if necessary.
+			[[nodiscard]] std::size_t _allocate() {
+				if (!_free_slots.empty()) {
+					std::size_t slot = _free_slots.back();
+					_free_slots.pop_back();
+					return slot;
+				}
+				std::size_t slot = _storage.size();
+				_storage.resize(slot + _slot_size);
+				return slot;
+			}
+		};
+		/// A thread in \ref _find_next_linear() that's waiting to consume the next codepoint.
+		struct _consuming_thread {
+			/// Default constructor.
+			_consuming_thread() = default;
+			/// Initializes all fields of this struct.
+			_consuming_thread(std::size_t d, const typename compiled_types::instruction &t, std::size_t off) :
+				data(d), transition(&t), offset(off) {
+			}
+
+			std::size_t data = 0; ///< Slot of this thread in \ref _linear_threads.
+			const typename compiled_types::instruction *transition = nullptr; ///< The transition to take.
+			std::size_t offset = 0; ///< For literals, the number of codepoints that have already been matched.
+		};
+		/// A thread in \ref _find_next_linear() that has just consumed a codepoint. If \ref transition is
+		/// \p nullptr, the thread is at \ref state; otherwise it's in the middle of a literal.
+		struct _stepped_thread {
+			std::size_t data = 0; ///< Slot of this thread in \ref _linear_threads.
+			typename compiled_types::state_ref state; ///< The state of this thread.
+			const typename compiled_types::instruction *transition = nullptr; ///< The literal transition.
+			std::size_t offset = 0; ///< The number of codepoints in the literal that have been matched.
+		};
+		/// A state being explored when computing the closure of a thread in \ref _find_next_linear().
+		struct _closure_frame {
+			std::size_t data = 0; ///< Slot of this thread in \ref _linear_threads.
+			typename compiled_types::state_ref state; ///< The state.
+			/// The number of stream positions on top of the stack pushed at the current position. Since the stack
+			/// is only used to check for infinite loops, this is the only information that affects matching.
+			std::size_t fresh_positions = 0;
+			std::size_t next_transition = 0; ///< Index of the next transition to explore.
+		};
+
+		/// For each state, the step of \ref _find_next_linear() when it was last visited with no fresh stream
+		/// positions.
+		std::vector<std::size_t> _linear_state_steps;
+		/// For each instruction, the step of \ref _find_next_linear() when it was last added as a consuming thread
+		/// at its first codepoint.
+		std::vector<std::size_t> _linear_instruction_steps;
+		/// States that have been visited with fresh stream positions in the current step.
+		std::vector<std::pair<std::size_t, std::size_t>> _linear_fresh_visited;
+		std::vector<_consuming_thread> _linear_consuming; ///< Consuming threads of the current step.
+		std::vector<_stepped_thread> _linear_stepped; ///< Threads that have consumed the current codepoint.
+		std::vector<_closure_frame> _linear_frames; ///< The stack used for computing closures.
+		_thread_pool _linear_threads; ///< Data of all threads.
+		std::size_t _linear_step = 0; ///< The step counter. This is never reset.
+
+		/// Finds the next match in linear time, by simulating all threads simultaneously in the order of their
+		/// priority. Threads at the same state and position as another thread with higher priority are dropped.
+		/// The expression must not require backtracking.
+		///
+		/// When an iteration of a repetition matches an empty string, the backtracking engine abandons the whole
+		/// repetition at that point, while this function still tries the other alternatives of that iteration
+		/// in order, as PCRE does. For example, for <tt>/(|ab)*?d/</tt> on \p abd the backtracking engine finds
+		/// \p d at position 2, but this function finds \p abd with \p ab captured, which matches PCRE.
+		[[nodiscard]] std::optional<result> _find_next_linear(
+			Stream&, const typename compiled_types::state_machine&, bool &reject_empty_match
+		);
+		/// Follows all transitions from the given state that don't consume codepoints, and adds all threads that
+		/// need to consume codepoints to \ref _linear_consuming, in the order of their priority.
+		///
+		/// \param data Slot of the thread, which is freed or handed over to other threads by this function.
+		/// \return The slot of the thread that has reached the end state, if any. In that case, all threads with
+		///         lower priorities should be discarded.
+		[[nodiscard]] std::optional<std::size_t> _linear_closure(
+			const Stream&, typename compiled_types::state_ref, std::size_t data, std::size_t reject_position
+		);
+
 		/// Logs the given string.
 		void _log([[maybe_unused]] std::u8string_view str) {
 			if constexpr (_uses_log) {
@@ -424,36 +622,59 @@ namespace codepad::regex {
 			Stream&, typename compiled_types::capture_ref, bool case_insensitive
 		) const;
 
-		/// Blanket overload that handles all conditions that always passes.
-		template <typename Condition> [[nodiscard]] bool _check_transition(const Stream&, const Condition&) const {
-			return true;
-		}
-		/// Checks if the contents in the given stream starts with the given string.
-		[[nodiscard]] bool _check_transition(
-			Stream &stream, const typename compiled_types::transitions::literal &cond
-		) const {
-			for (codepoint cp : cond.contents) {
-				if (stream.empty()) {
-					return false;
-				}
-				codepoint got_codepoint = stream.take();
-				if (cond.case_insensitive) {
-					got_codepoint = unicode::case_folding::get_cached().fold_simple(got_codepoint);
+		/// Checks if the given instruction can be taken, consuming codepoints from the stream if necessary.
+		[[nodiscard]] bool _check_instruction(Stream &stream, const typename compiled_types::instruction &instr) {
+			using _opcode = typename compiled_types::opcode;
+
+			switch (instr.op) {
+			case _opcode::literal:
+				[[fallthrough]];
+			case _opcode::literal_case_insensitive:
+				for (codepoint cp : _expr->get_literal(instr)) {
+					if (stream.empty()) {
+						return false;
+					}
+					codepoint got_codepoint = stream.take();
+					if (instr.op == _opcode::literal_case_insensitive) {
+						got_codepoint = unicode::case_folding::fold_simple(got_codepoint);
+					}
+					if (got_codepoint != cp) {
+						return false;
+					}
 				}
-				if (got_codepoint != cp) {
+				return true;
+			case _opcode::character_class:
+				if (stream.empty()) {
 					return false;
 				}
+				return _expr->matches_character_class(instr, stream.take());
+			case _opcode::simple_assertion:
+				return _check_simple_assertion(stream, instr);
+			case _opcode::check_infinite_loop:
+				return _check_transition(stream, typename compiled_types::transitions::check_infinite_loop());
+			case _opcode::complex:
+				return std::visit(
+					[&, this](const auto &cond) {
+						return _check_transition(stream, cond);
+					},
+					_expr->get_complex_condition(instr)
+				);
+			default: // the other instructions always pass
+				return true;
 			}
-			return true;
 		}
-		/// Checks if the next character in the stream is in the given codepoint ranges.
-		[[nodiscard]] bool _check_transition(
-			Stream &stream, const typename compiled_types::transitions::character_class &cond
+		/// Checks if the assertion of a \ref compiled::opcode::simple_assertion instruction is satisfied.
+		[[nodiscard]] bool _check_simple_assertion(
+			const Stream &stream, const typename compiled_types::instruction &instr
 		) const {
-			if (stream.empty()) {
-				return false;
-			}
-			return cond.matches(stream.take());
+			typename compiled_types::transitions::simple_assertion cond;
+			cond.assertion_type = static_cast<ast_nodes::simple_assertion::type>(instr.operand);
+			return _check_transition(stream, cond);
+		}
+
+		/// Blanket overload that handles all conditions that always passes.
+		template <typename Condition> [[nodiscard]] bool _check_transition(const Stream&, const Condition&) const {
+			return true;
 		}
 		/// Checks if the assertion is satisfied.
 		[[nodiscard]] bool _check_transition(
@@ -619,6 +840,43 @@ namespace codepad::regex {
 			_result.captures[index] = std::move(cap);
 		}
 
+		/// Executes the side effects of the given instruction after it has been checked.
+		void _execute_instruction(Stream &stream, const typename compiled_types::instruction &instr) {
+			using _opcode = typename compiled_types::opcode;
+			using _transitions = typename compiled_types::transitions;
+
+			switch (instr.op) {
+			case _opcode::capture_begin:
+				{
+					typename _transitions::capture_begin beg;
+					beg.capture = typename compiled_types::capture_ref(
+						static_cast<typename compiled_types::capture_index>(instr.operand)
+					);
+					_execute_transition(stream, beg);
+				}
+				break;
+			case _opcode::capture_end:
+				_execute_transition(stream, typename _transitions::capture_end());
+				break;
+			case _opcode::reset_match_start:
+				_execute_transition(stream, typename _transitions::reset_match_start());
+				break;
+			case _opcode::push_position:
+				_execute_transition(stream, typename _transitions::push_position());
+				break;
+			case _opcode::complex:
+				std::visit(
+					[&, this](const auto &trans) {
+						_execute_transition(stream, trans);
+					},
+					_expr->get_complex_condition(instr)
+				);
+				break;
+			default: // nothing extra needs to be done for the other instructions
+				break;
+			}
+		}
+
 		/// By default nothing extra needs to be done for transitions.
 		template <typename Trans> void _execute_transition(const Stream&, const Trans&) {
 		}
@@ -14,7 +14,9 @@ namespace codepad::regex {
 		Stream &stream, const typename compiled_types::state_machine &expr,
 		bool reject_empty_match, std::size_t max_iters
 	) {
-		_result = result();
+		// reuse the storage of the previous result
+		_result.captures.clear();
+		_result.overriden_match_begin.reset();
 		_result.captures.emplace_back().begin = stream;
 		_expr = &expr;
 		std::size_t reject_starting_position =
@@ -98,40 +100,30 @@ namespace codepad::regex {
 				}
 			}
 			Stream checkpoint_stream = current_state.stream;
-			const compiled_types::transition *transition = nullptr;
-			if (!current_state.get_transitions(expr).empty()) {
-				transition = &current_state.get_current_transition(expr);
-				std::visit(
-					[&, this](auto &&cond) {
-						if (!_check_transition(current_state.stream, cond)) {
-							transition = nullptr;
-						}
-					},
-					transition->condition
-				);
+			const typename compiled_types::instruction *instr = nullptr;
+			if (!current_state.get_instructions(expr).empty()) {
+				instr = &current_state.get_current_instruction(expr);
+				if (!_check_instruction(current_state.stream, *instr)) {
+					instr = nullptr;
+				}
 			}
 
 			++current_state.transition;
-			if (transition) {
+			if (instr) {
 				_log(u8"\tTransition OK\n");
-				if (current_state.transition < current_state.get_transitions(expr).size()) {
+				if (current_state.transition < current_state.get_instructions(expr).size()) {
 					_log(u8"\t\tPushing state\n");
 					_state_stack.emplace_back(
 						std::move(checkpoint_stream), current_state.automata_state, current_state.transition,
 						*this, _result.overriden_match_begin
 					);
 				}
-				std::visit(
-					[&, this](auto &&trans) {
-						_execute_transition(current_state.stream, trans);
-					},
-					transition->condition
-				);
-				current_state.automata_state = transition->new_state;
+				_execute_instruction(current_state.stream, *instr);
+				current_state.automata_state = instr->new_state;
 				current_state.transition = 0;
 				// continue to the next iteration
 			} else {
-				if (current_state.transition < current_state.get_transitions(expr).size()) {
+				if (current_state.transition < current_state.get_instructions(expr).size()) {
 					_log(u8"\tTransition fail: next transition\n");
 					current_state.stream = std::move(checkpoint_stream);
 					continue; // try the next transition
@@ -212,12 +204,12 @@ namespace codepad::regex {
 		}
 		stream = std::move(current_state.stream);
 
-		_state_stack = std::deque<_state>();
-		_state_partial_finished_captures = spliced_stack<_partial_finished_capture_info>();
-		_state_finished_captures = spliced_stack<_finished_capture_info>();
-		_state_finished_subroutines = spliced_stack<_subroutine_stackframe>();
-		_state_restored_checkpoints = spliced_stack<_checkpointed_stream>();
-		_state_finished_stream_positions = spliced_stack<_stream_position>();
+		_state_stack.clear();
+		_state_partial_finished_captures.clear();
+		_state_finished_captures.clear();
+		_state_finished_subroutines.clear();
+		_state_restored_checkpoints.clear();
+		_state_finished_stream_positions.clear();
 
 		_expr = nullptr;
 
@@ -235,15 +227,15 @@ namespace codepad::regex {
 				while (!_result.captures.empty() && !_result.captures.back().is_valid()) {
 					_result.captures.pop_back();
 				}
-				return std::move(_result);
+				return _result; // copy the result so that the storage of _result can be reused
 			}
 		}
 
-		_ongoing_captures = std::deque<_capture_info>();
-		_atomic_stack_sizes = std::deque<std::size_t>();
-		_subroutine_stack = std::deque<_subroutine_stackframe>();
-		_checkpoint_stack = std::deque<_checkpointed_stream>();
-		_stream_position_stack = std::deque<_stream_position>();
+		_ongoing_captures.clear();
+		_atomic_stack_sizes.clear();
+		_subroutine_stack.clear();
+		_checkpoint_stack.clear();
+		_stream_position_stack.clear();
 
 		return std::nullopt;
 	}
@@ -310,8 +302,8 @@ namespace codepad::regex {
 			codepoint got = new_stream.take();
 			codepoint expected = target_stream.take();
 			if (case_insensitive) {
-				got = unicode::case_folding::get_cached().fold_simple(got);
-				expected = unicode::case_folding::get_cached().fold_simple(expected);
+				got = unicode::case_folding::fold_simple(got);
+				expected = unicode::case_folding::fold_simple(expected);
 			}
 			if (got != expected) {
 				return false;
@@ -556,4 +548,311 @@ namespace codepad::regex {
 		sf.subroutine_capture = jmp.subroutine_capture;
 		sf.state_stack_size = _state_stack.size();
 	}
+
+	template <
+		typename Stream, typename DataTypes, typename LogFunc
+	> std::optional<match_result<Stream>> matcher<Stream, DataTypes, LogFunc>::_find_next_linear(
+		Stream &s, const typename compiled_types::state_machine &expr, bool &reject_empty_match
+	) {
+		_expr = &expr;
+		if (_linear_state_steps.size() < expr.get_num_states()) {
+			_linear_state_steps.resize(expr.get_num_states(), 0);
+		}
+		if (_linear_instruction_steps.size() < expr.get_num_instructions()) {
+			_linear_instruction_steps.resize(expr.get_num_instructions(), 0);
+		}
+		_linear_threads.reset(expr.get_num_captures());
+		const auto &first_codepoints = expr.get_first_codepoints();
+		std::size_t reject_position =
+			reject_empty_match ? s.codepoint_position() : std::numeric_limits<std::size_t>::max();
+
+		Stream stream = s;
+		std::optional<std::size_t> matched;
+		std::size_t match_end = 0;
+		_linear_stepped.clear();
+		while (true) {
+			++_linear_step;
+			_linear_fresh_visited.clear();
+			_linear_consuming.clear();
+
+			// continue all threads in the order of their priority
+			bool found = false;
+			for (auto it = _linear_stepped.begin(); it != _linear_stepped.end(); ++it) {
+				if (it->transition) { // in the middle of a literal
+					_linear_consuming.emplace_back(it->data, *it->transition, it->offset);
+					continue;
+				}
+				if (auto res = _linear_closure(stream, it->state, it->data, reject_position)) {
+					// discard all threads with lower priority
+					if (matched) {
+						_linear_threads.free(matched.value());
+					}
+					matched = res;
+					match_end = stream.codepoint_position();
+					found = true;
+					for (++it; it != _linear_stepped.end(); ++it) {
+						_linear_threads.free(it->data);
+					}
+					break;
+				}
+			}
+			_linear_stepped.clear();
+
+			// start a new thread with the lowest priority at this position, if no match has been found
+			if (!found && !matched) {
+				if (first_codepoints && _linear_consuming.empty()) {
+					// skip to the next position where a match may start
+					while (!stream.empty() && !first_codepoints->contains(stream.peek())) {
+						stream.take();
+					}
+				}
+				if (!first_codepoints || (!stream.empty() && first_codepoints->contains(stream.peek()))) {
+					std::size_t data = _linear_threads.allocate(stream.codepoint_position());
+					if (auto res = _linear_closure(stream, expr.get_start_state(), data, reject_position)) {
+						matched = res;
+						match_end = stream.codepoint_position();
+					}
+				}
+			}
+
+			if (stream.empty() || (_linear_consuming.empty() && matched)) {
+				break;
+			}
+			codepoint cp = stream.take();
+			for (auto &thread : _linear_consuming) {
+				const auto &instr = *thread.transition;
+				switch (instr.op) {
+				case compiled_types::opcode::literal:
+					[[fallthrough]];
+				case compiled_types::opcode::literal_case_insensitive:
+					{
+						codepoint got =
+							instr.op == compiled_types::opcode::literal_case_insensitive ?
+							unicode::case_folding::fold_simple(cp) :
+							cp;
+						if (got != expr.get_literal(instr)[thread.offset]) {
+							_linear_threads.free(thread.data);
+							continue;
+						}
+						if (thread.offset + 1 < instr.length) {
+							auto &stepped = _linear_stepped.emplace_back();
+							stepped.data = thread.data;
+							stepped.transition = thread.transition;
+							stepped.offset = thread.offset + 1;
+							continue;
+						}
+					}
+					break;
+				case compiled_types::opcode::character_class:
+					if (!expr.matches_character_class(instr, cp)) {
+						_linear_threads.free(thread.data);
+						continue;
+					}
+					break;
+				default:
+					assert_true_logical(false, "instruction does not consume codepoints");
+					break;
+				}
+				auto &stepped = _linear_stepped.emplace_back();
+				stepped.data = thread.data;
+				stepped.state = thread.transition->new_state;
+			}
+		}
+		_linear_stepped.clear();
+		_linear_consuming.clear();
+		_expr = nullptr;
+
+		if (!matched) {
+			s = std::move(stream);
+			return std::nullopt;
+		}
+
+		// only positions are recorded during matching; obtain the streams at these positions
+		std::size_t match_start = _linear_threads.get_start(matched.value());
+		std::size_t match_begin = _linear_threads.get_match_begin(matched.value());
+		std::vector<std::size_t> positions{ match_start, match_end };
+		if (match_begin != _thread_pool::no_match_begin) {
+			positions.emplace_back(match_begin);
+		}
+		for (std::size_t i = 0; i < _linear_threads.get_num_captures(); ++i) {
+			auto [begin, length] = _linear_threads.get_capture(matched.value(), i);
+			if (length != result::capture::invalid_capture_length) {
+				positions.emplace_back(begin);
+			}
+		}
+		std::sort(positions.begin(), positions.end());
+		positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+		std::vector<Stream> streams;
+		streams.reserve(positions.size());
+		for (std::size_t pos : positions) {
+			while (s.codepoint_position() < pos) {
+				s.take();
+			}
+			streams.emplace_back(s);
+		}
+		auto get_stream = [&](std::size_t pos) {
+			return streams[std::lower_bound(positions.begin(), positions.end(), pos) - positions.begin()];
+		};
+
+		result res;
+		res.captures.resize(std::max<std::size_t>(_linear_threads.get_num_captures(), 1));
+		for (std::size_t i = 1; i < _linear_threads.get_num_captures(); ++i) {
+			auto [begin, length] = _linear_threads.get_capture(matched.value(), i);
+			if (length != result::capture::invalid_capture_length) {
+				res.captures[i] = typename result::capture(get_stream(begin), length);
+			}
+		}
+		res.captures[0] = typename result::capture(get_stream(match_start), match_end - match_start);
+		if (match_begin != _thread_pool::no_match_begin) {
+			res.overriden_match_begin = get_stream(match_begin);
+		}
+		while (!res.captures.empty() && !res.captures.back().is_valid()) {
+			res.captures.pop_back();
+		}
+		reject_empty_match = match_start == match_end;
+		s = get_stream(match_end);
+		return res;
+	}
+
+	template <
+		typename Stream, typename DataTypes, typename LogFunc
+	> auto matcher<Stream, DataTypes, LogFunc>::_linear_closure(
+		const Stream &stream, typename compiled_types::state_ref state, std::size_t data,
+		std::size_t reject_position
+	) -> std::optional<std::size_t> {
+		using _opcode = typename compiled_types::opcode;
+		using _transitions = typename compiled_types::transitions;
+
+		// marks the state as visited, and returns whether it has not been visited before
+		auto visit = [this](typename compiled_types::state_ref st, std::size_t fresh) {
+			if (fresh == 0) {
+				auto &step = _linear_state_steps[st.get_index()];
+				if (step == _linear_step) {
+					return false;
+				}
+				step = _linear_step;
+				return true;
+			}
+			std::pair<std::size_t, std::size_t> key(st.get_index(), fresh);
+			auto it = std::find(_linear_fresh_visited.begin(), _linear_fresh_visited.end(), key);
+			if (it != _linear_fresh_visited.end()) {
+				return false;
+			}
+			_linear_fresh_visited.emplace_back(key);
+			return true;
+		};
+
+		if (!visit(state, 0)) {
+			_linear_threads.free(data);
+			return std::nullopt;
+		}
+		std::size_t position = stream.codepoint_position();
+		_linear_frames.clear();
+		auto &first_frame = _linear_frames.emplace_back();
+		first_frame.data = data;
+		first_frame.state = state;
+		while (!_linear_frames.empty()) {
+			auto &frame = _linear_frames.back();
+			if (frame.next_transition == 0 && frame.state == _expr->get_end_state() && position != reject_position) {
+				std::size_t result = frame.data;
+				_linear_frames.pop_back();
+				for (auto &f : _linear_frames) {
+					_linear_threads.free(f.data);
+				}
+				_linear_frames.clear();
+				return result;
+			}
+			auto instructions = _expr->get_instructions(frame.state);
+			if (frame.next_transition >= instructions.size()) {
+				_linear_threads.free(frame.data);
+				_linear_frames.pop_back();
+				continue;
+			}
+			const auto &instr = instructions[frame.next_transition];
+			++frame.next_transition;
+
+			std::size_t fresh = frame.fresh_positions;
+			std::size_t new_data = 0;
+			bool passed = true;
+			switch (instr.op) {
+			case _opcode::literal:
+				[[fallthrough]];
+			case _opcode::literal_case_insensitive:
+				if (instr.length == 0) {
+					new_data = _linear_threads.copy(frame.data);
+					break;
+				}
+				[[fallthrough]];
+			case _opcode::character_class:
+				{
+					// all threads that consume codepoints using the same instruction behave the same way
+					auto &step = _linear_instruction_steps[_expr->get_instruction_index(instr)];
+					if (step != _linear_step) {
+						step = _linear_step;
+						_linear_consuming.emplace_back(_linear_threads.copy(frame.data), instr, 0);
+					}
+					passed = false;
+				}
+				break;
+			case _opcode::simple_assertion:
+				passed = _check_simple_assertion(stream, instr);
+				if (passed) {
+					new_data = _linear_threads.copy(frame.data);
+				}
+				break;
+			case _opcode::capture_begin:
+				new_data = _linear_threads.copy(frame.data);
+				_linear_threads.begin_capture(new_data, instr.operand, position);
+				break;
+			case _opcode::capture_end:
+				new_data = _linear_threads.copy(frame.data);
+				_linear_threads.end_capture(new_data, position);
+				break;
+			case _opcode::reset_match_start:
+				new_data = _linear_threads.copy(frame.data);
+				_linear_threads.set_match_begin(new_data, position);
+				break;
+			case _opcode::push_position:
+				new_data = _linear_threads.copy(frame.data);
+				++fresh;
+				break;
+			case _opcode::check_infinite_loop:
+				// fails if the position on top of the stack has been pushed at this position; the position is
+				// popped regardless, which also affects the remaining transitions of this state
+				if (fresh > 0) {
+					frame.fresh_positions = --fresh;
+					passed = false;
+				} else {
+					new_data = _linear_threads.copy(frame.data);
+				}
+				break;
+			case _opcode::complex:
+				passed = std::visit([&](const auto &cond) {
+					using _cond_t = std::decay_t<decltype(cond)>;
+					if constexpr (std::is_same_v<_cond_t, typename _transitions::character_class_assertion>) {
+						return _check_transition(stream, cond);
+					} else {
+						assert_true_logical(false, "transition requires backtracking");
+						return false;
+					}
+				}, _expr->get_complex_condition(instr));
+				if (passed) {
+					new_data = _linear_threads.copy(frame.data);
+				}
+				break;
+			}
+
+			if (passed) {
+				if (visit(instr.new_state, fresh)) {
+					auto &new_frame = _linear_frames.emplace_back(); // this invalidates frame
+					new_frame.data = new_data;
+					new_frame.state = instr.new_state;
+					new_frame.fresh_positions = fresh;
+				} else {
+					_linear_threads.free(new_data);
+				}
+			}
+		}
+		return std::nullopt;
+	}
 }
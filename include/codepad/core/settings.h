@@ -308,6 +308,11 @@ namespace codepad {
 		/// Loads all settings from the given file.
 		void load(const std::filesystem::path&);
 
+		/// Returns \ref _timestamp. This value changes whenever settings are updated.
+		[[nodiscard]] std::size_t get_timestamp() const {
+			return _timestamp;
+		}
+
 		/// Invoked whenever the settings have been changed. Objects that are eager to detect settings changes can
 		/// register for this event.
 		info_event<void> changed;
@@ -62,7 +62,7 @@ namespace codepad {
 				auto prev = ranges.begin();
 				for (auto it = ranges.begin() + 1; it != ranges.end(); ++it) {
 					if (it->first <= prev->last + 1) {
-						prev->last = it->last;
+						prev->last = std::max(prev->last, it->last);
 					} else {
 						*++prev = *it;
 					}
@@ -13,6 +13,7 @@
 #include "codepad/core/misc.h"
 #include "codepad/core/assert.h"
 #include "common.h"
+#include "case_folding_tables.h"
 
 namespace codepad::unicode {
 	namespace database {
@@ -244,12 +245,20 @@ namespace codepad::unicode {
 
 		/// Cached Unicode data.
 		struct cache {
-			/// Returns the Unicode database, loading it if necessary.
+			/// Returns the Unicode database, loading it if necessary. Properties of codepoints can be obtained
+			/// without loading the database using \ref get_general_category(), \ref get_bidi_class(), and
+			/// \ref get_canonical_combining_class().
 			[[nodiscard]] static const unicode_data &get_database();
-			/// Returns all codepoints in the given category, computing it if necessary.
+			/// Returns all codepoints in the given category, computing it if necessary. This uses the precomputed
+			/// tables and does not load the database.
 			[[nodiscard]] static const codepoint_range_list &get_codepoints_in_category(general_category_index);
-			/// Returns all codepoints in the given category or categories, computing it if necessary.
+			/// Returns all codepoints in the given category or categories. Single categories, named combinations
+			/// such as \ref general_category::letter, and combinations used by the regex parser are computed once
+			/// and looked up without locking; other combinations are computed on demand.
 			[[nodiscard]] static const codepoint_range_list &get_codepoints_in_category(general_category);
+		protected:
+			/// Collects codepoints in the given category or categories from the precomputed tables.
+			[[nodiscard]] static codepoint_range_list _get_codepoints_in_category(general_category);
 		};
 
 		std::vector<entry> entries; ///< Entries in this database.
@@ -261,6 +270,15 @@ namespace codepad::unicode {
 		[[nodiscard]] static unicode_data parse(const std::filesystem::path&);
 	};
 
+	/// Returns the general category of the given codepoint using precomputed tables. Codepoints that are not in
+	/// UnicodeData.txt are unassigned.
+	[[nodiscard]] general_category get_general_category(codepoint);
+	/// Returns the bidi class of the given codepoint using precomputed tables, or \ref bidi_class::unknown if the
+	/// codepoint is not in UnicodeData.txt.
+	[[nodiscard]] bidi_class get_bidi_class(codepoint);
+	/// Returns the canonical combining class of the given codepoint using precomputed tables.
+	[[nodiscard]] std::uint8_t get_canonical_combining_class(codepoint);
+
 	/// Lists of codepoints with specific properties contained in PropList.txt.
 	struct property_list {
 		/// Spaces, separator characters and other control characters which should be treated by programming
@@ -274,26 +292,38 @@ namespace codepad::unicode {
 		[[nodiscard]] static const property_list &get_cached();
 	};
 
-	/// The case folding database in CaseFolding.txt.
+	/// The case folding database in CaseFolding.txt. Simple case folding is performed using the precomputed tables
+	/// in case_folding_tables.h, and does not require the database to be loaded.
 	struct case_folding {
 	public:
 		std::unordered_map<codepoint, codepoint> simple; ///< Simple case folding.
 		std::unordered_map<codepoint, codepoint_string> full; ///< Full case folding.
 
 		/// Folds the given codepoint with only the simple folding rules.
-		[[nodiscard]] codepoint fold_simple(codepoint cp) const {
-			if (auto it = simple.find(cp); it != simple.end()) {
-				return it->second;
+		[[nodiscard]] constexpr static codepoint fold_simple(codepoint cp) {
+			std::size_t block = cp >> tables::case_folding_block_bits;
+			if (block >= std::size(tables::simple_case_folding_blocks)) {
+				return cp;
 			}
-			return cp;
+			std::size_t index = _get_table_index(tables::simple_case_folding_blocks[block], cp);
+			return static_cast<codepoint>(static_cast<std::int32_t>(cp) + tables::simple_case_folding_deltas[index]);
 		}
 		/// Inverse maps the given codepoint using the simple folding rules.
-		[[nodiscard]] std::span<const codepoint> inverse_fold_simple(codepoint cp) const {
-			auto it = _simple_inverse_info.find(cp);
-			if (it == _simple_inverse_info.end()) {
+		[[nodiscard]] constexpr static std::span<const codepoint> inverse_fold_simple(codepoint cp) {
+			std::size_t block = cp >> tables::case_folding_block_bits;
+			if (block >= std::size(tables::simple_case_folding_inverse_blocks)) {
+				return {};
+			}
+			std::size_t index = tables::simple_case_folding_inverse_indices[
+				_get_table_index(tables::simple_case_folding_inverse_blocks[block], cp)
+			];
+			if (index == 0) {
 				return {};
 			}
-			return std::span<const codepoint>(_simple_inverse_data.begin() + it->second.begin, it->second.count);
+			std::size_t
+				begin = tables::simple_case_folding_inverse_offsets[index - 1],
+				end = tables::simple_case_folding_inverse_offsets[index];
+			return std::span<const codepoint>(tables::simple_case_folding_inverse_data + begin, end - begin);
 		}
 		/// Folds the given codepoint with the full folding rules.
 		[[nodiscard]] codepoint_string fold_full(codepoint cp) const {
@@ -308,13 +338,10 @@ namespace codepad::unicode {
 		/// Returns the global case folding, loading it if necessary.
 		[[nodiscard]] static const case_folding &get_cached();
 	protected:
-		/// Information about a inverse mapping.
-		struct _inverse_mapping_info {
-			std::size_t begin = 0; ///< First inverse mapping element.
-			std::size_t count = 0; ///< The number of mapped elements.
-		};
-		/// Information about the inverse mapping for simple case folding.
-		std::unordered_map<codepoint, _inverse_mapping_info> _simple_inverse_info;
-		std::vector<codepoint> _simple_inverse_data; ///< Inverse mapped data.
+		/// Returns the index of the given codepoint in the second stage of a case folding table.
+		[[nodiscard]] constexpr static std::size_t _get_table_index(std::size_t block, codepoint cp) {
+			constexpr codepoint _mask = (static_cast<codepoint>(1) << tables::case_folding_block_bits) - 1;
+			return (block << tables::case_folding_block_bits) | (cp & _mask);
+		}
 	};
 }
@@ -23,11 +23,21 @@ namespace codepad::os {
 		}
 	protected:
 		/// Event handler of the `draw' signal. Sets \ref _renderer_data to the given \p cairo_t, invokes
-		/// \ref _on_render(), and resets \ref _renderer_data.
+		/// \ref _on_render() with the clip region of the context so that only that region is redrawn, and resets
+		/// \ref _renderer_data.
 		inline static gboolean _on_draw_event(GtkWidget*, cairo_t *cr, ui::window *wnd) {
 			auto &data = _get_window_data_as<_window_data>(*wnd);
 			data.context.set_share(cr);
-			_details::cast_window_impl(wnd->get_impl())._on_render();
+			std::vector<rectd> damage;
+			cairo_rectangle_list_t *clip = cairo_copy_clip_rectangle_list(cr);
+			if (clip->status == CAIRO_STATUS_SUCCESS) { // otherwise the clip is not rectangular, redraw everything
+				for (int i = 0; i < clip->num_rectangles; ++i) {
+					const cairo_rectangle_t &r = clip->rectangles[i];
+					damage.emplace_back(rectd::from_xywh(r.x, r.y, r.width, r.height));
+				}
+			}
+			cairo_rectangle_list_destroy(clip);
+			_details::cast_window_impl(wnd->get_impl())._on_render(damage);
 			data.context.reset();
 			return true;
 		}
@@ -47,10 +57,12 @@ namespace codepad::os {
 			));
 		}
 
-		/// Connects the \p draw signal to \ref _on_draw_event().
+		/// Connects the \p draw signal to \ref _on_draw_event(), and enables partial redraws for the window since
+		/// GTK preserves its contents.
 		void _new_window(ui::window &wnd) override {
 			renderer_base::_new_window(wnd);
 			auto &wnd_impl = _details::cast_window_impl(wnd.get_impl());
+			wnd_impl._partial_redraw = true;
 			g_signal_connect(
 				wnd_impl.get_native_handle(), "draw",
 				reinterpret_cast<GCallback>(_on_draw_event), &wnd
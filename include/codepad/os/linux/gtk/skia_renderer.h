@@ -50,7 +50,8 @@ namespace codepad::os {
 			auto &data = _get_window_data_as<_window_data>(*wnd);
 			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 			glClear(GL_COLOR_BUFFER_BIT);
-			_details::cast_window_impl(wnd->get_impl())._on_render();
+			// the contents of the GL area are not preserved between frames, so always redraw the entire window
+			_details::cast_window_impl(wnd->get_impl())._on_render({});
 			data.renderer->_skia_context->flush();
 			if (GError *error = gtk_gl_area_get_error(area)) {
 				assert_true_sys(false, "GL error");
@@ -103,6 +103,15 @@ namespace codepad::os {
 		void _invalidate_window_visuals() override {
 			gtk_widget_queue_draw(_wnd);
 		}
+		/// Calls \p gtk_widget_queue_draw_area().
+		void _invalidate_window_region(rectd region) override {
+			recti rgn = region.fit_grid_enlarge<int>();
+			gtk_widget_queue_draw_area(_wnd, rgn.xmin, rgn.ymin, rgn.width(), rgn.height());
+		}
+		/// Returns \ref _partial_redraw, which is set by the renderer backend.
+		[[nodiscard]] bool _supports_partial_redraw() const override {
+			return _partial_redraw;
+		}
 
 		/// Calls \p gdk_window_set_functions() to set a hint for the window manager to show or hide the maximize
 		/// button.
@@ -228,8 +237,10 @@ namespace codepad::os {
 		}
 
 
-		/// Calls \ref window::_on_render(). This acts as a interface for renderer backends.
-		void _on_render() {
+		/// Calls \ref window::_on_render(). This acts as a interface for renderer backends. \p damage is the list of
+		/// rectangles that need redrawing reported by the system; if it's empty, the entire window is redrawn.
+		void _on_render(const std::vector<rectd> &damage) {
+			_window._set_damage(damage);
 			_window._on_render();
 		}
 
@@ -313,6 +324,9 @@ namespace codepad::os {
 
 		GtkWidget *_wnd = nullptr; ///< The \p GtkWindow.
 		GtkIMContext *_imctx = nullptr; ///< GTK context for input methods.
+		/// Whether the renderer backend preserves the contents of this window between frames, so that only damaged
+		/// regions are redrawn. Backends that support this set it when the window is created.
+		bool _partial_redraw = false;
 
 		/// Timestamp of the previous scroll event used for eliminating duplicate events.
 		guint32 _prev_scroll_timestamp = 0;
@@ -142,6 +142,11 @@ namespace codepad::ui {
 			}
 		}
 
+		/// Returns the number of worker threads.
+		[[nodiscard]] std::size_t get_num_threads() const {
+			return _threads.size();
+		}
+
 		/// Starts a new task. This function can be called from any thread - if the task scheduler has been shut
 		/// down, the new task will simply be discarded.
 		template <typename Task> token<Task> start_task(std::shared_ptr<Task> task) {
@@ -373,7 +373,7 @@ namespace codepad::ui::cairo {
 		/// Finishes drawing.
 		void end_drawing() override;
 
-		/// Clears the current surface.
+		/// Clears the current surface within the current clip.
 		void clear(colord) override;
 
 		/// Pushes a matrix onto the stack.
@@ -312,6 +312,9 @@ namespace codepad::ui {
 		/// one. For windows themselves, this function returns a pointer to the window itself, even if it's a child
 		/// of another window.
 		[[nodiscard]] window *get_window();
+		/// Returns the bounding box of this element in the coordinate system of its window, taking the render
+		/// transforms of this element and all its ancestors into account.
+		[[nodiscard]] rectd get_window_bounds() const;
 		/// Returns the \ref manager of this element.
 		[[nodiscard]] manager &get_manager() const {
 			return *_manager;
@@ -352,6 +355,21 @@ namespace codepad::ui {
 		[[nodiscard]] bool get_clip_to_bounds() const {
 			return _clip_to_bounds;
 		}
+		/// Sets whether to render this element and its descendants into an offscreen layer that's reused until the
+		/// visual of any of them is invalidated. Contents outside of the layout of this element are clipped, as if
+		/// \ref set_clip_to_bounds() were set. This has no effect on windows.
+		void set_cache_layer(bool cache) {
+			if (cache != _cache_layer) {
+				_cache_layer = cache;
+				_layer = render_target_data();
+				_layer_valid = false;
+				invalidate_visual();
+			}
+		}
+		/// Returns whether this element is rendered using a cached layer.
+		[[nodiscard]] bool get_cache_layer() const {
+			return _cache_layer;
+		}
 
 		/// Returns if the mouse is hovering over this element.
 		[[nodiscard]] bool is_mouse_over() const {
@@ -359,7 +377,8 @@ namespace codepad::ui {
 		}
 
 
-		/// Invalidates the visual of the element so that it'll be re-rendered next frame.
+		/// Invalidates the visual of the element so that it'll be re-rendered next frame. This also invalidates the
+		/// cached layers of this element and all its ancestors.
 		///
 		/// \sa manager::invalidate_visual()
 		void invalidate_visual();
@@ -417,7 +436,12 @@ namespace codepad::ui {
 		bool
 			_mouse_over = false, ///< Indicates if the mouse is hovering over this element.
 			/// Indicates that all contents that lie outside of the layout of this element should be clipped.
-			_clip_to_bounds = false;
+			_clip_to_bounds = false,
+			_cache_layer = false, ///< Indicates that this element is rendered using \ref _layer.
+			_layer_valid = false; ///< Indicates that the contents of \ref _layer are up-to-date.
+		render_target_data _layer; ///< The cached rendering of this element and its descendants.
+		vec2d _layer_size; ///< The size that \ref _layer has been created with.
+		vec2d _layer_scaling_factor; ///< The scaling factor that \ref _layer has been created with.
 
 		std::list<_animation_info> _animations; ///< A list of playing animations.
 
@@ -529,6 +553,8 @@ namespace codepad::ui {
 			lost_capture.invoke();
 		}
 
+		/// Returns the matrix that transforms the local coordinate system of this element into that of its parent.
+		[[nodiscard]] matd3x3 _get_local_render_matrix() const;
 		/// Called when the element is about to be rendered.
 		virtual void _on_prerender();
 		/// Called when the element is rendered. Renders all \ref visuals::geometries of \ref _params.
@@ -536,8 +562,14 @@ namespace codepad::ui {
 		virtual void _custom_render() const;
 		/// Called after the element has been rendered.
 		virtual void _on_postrender();
+		/// Called instead of \ref _custom_render() when \ref _cache_layer is set. Re-renders \ref _layer if
+		/// necessary, then draws it. \ref _layer is only recreated when the size or the scaling factor changes.
+		void _render_cached_layer();
 		/// Renders the element if the element is visible for \ref visibility::visual. This function first calls
-		/// \ref _on_prerender(), then calls \ref _custom_render(), and finally calls \ref _on_postrender().
+		/// \ref _on_prerender(), then calls \ref _custom_render(), and finally calls \ref _on_postrender(). If the
+		/// element clips its contents, including when it's cached in a layer, and lies completely outside of the
+		/// region of the window that's being redrawn, rendering is skipped entirely. If \ref _cache_layer is set,
+		/// \ref _render_cached_layer() is called instead of \ref _custom_render().
 		void _on_render();
 
 		/// Computes and returns the desired size of this element given available space. Returns the full size by
@@ -547,7 +579,8 @@ namespace codepad::ui {
 		}
 		/// Called by the element itself when its desired size has changed.
 		virtual void _on_desired_size_changed();
-		/// Called by \ref manager when the layout has changed. Calls \ref invalidate_visual. Derived classes can
+		/// Called by \ref manager when the layout has changed. Calls \ref invalidate_visual on this element and its
+		/// parent, since the region previously covered by this element also needs redrawing. Derived classes can
 		/// override this to update layout-dependent properties. For panels, override
 		/// \ref panel::_on_update_children_layout() instead when re-calculating the layout of its children.
 		virtual void _on_layout_changed();
@@ -10,6 +10,7 @@
 #include <charconv>
 #include <chrono>
 #include <compare>
+#include <vector>
 
 #include "codepad/core/misc.h"
 #include "codepad/core/math.h"
@@ -504,5 +505,57 @@ namespace codepad {
 			/// Offset of the caret within the selection. This must be between 0 and \ref selection_length.
 			std::size_t caret_offset = 0;
 		};
+
+
+		/// A region that needs to be redrawn, represented as a small number of rectangles. Overlapping rectangles
+		/// are merged, and once there are too many rectangles they're replaced by their bounding box.
+		class damage_region {
+		public:
+			/// The maximum number of rectangles kept before they're collapsed into a single one.
+			constexpr static std::size_t maximum_num_rectangles = 8;
+
+			/// Adds the given rectangle to this region. Rectangles without positive area are ignored.
+			void add(rectd r) {
+				if (!r.has_positive_area()) {
+					return;
+				}
+				// merge with all overlapping rectangles; merging may produce new overlaps, so repeat until there
+				// are none
+				for (bool merged = true; merged; ) {
+					merged = false;
+					for (auto it = _rects.begin(); it != _rects.end(); ) {
+						if (rectd::common_part(*it, r).has_positive_area()) {
+							r = rectd::bounding_box(*it, r);
+							it = _rects.erase(it);
+							merged = true;
+						} else {
+							++it;
+						}
+					}
+				}
+				if (_rects.size() >= maximum_num_rectangles) {
+					for (const rectd &rect : _rects) {
+						r = rectd::bounding_box(rect, r);
+					}
+					_rects.clear();
+				}
+				_rects.emplace_back(r);
+			}
+			/// Clears this region.
+			void clear() {
+				_rects.clear();
+			}
+
+			/// Returns whether this region is empty.
+			[[nodiscard]] bool empty() const {
+				return _rects.empty();
+			}
+			/// Returns the list of disjoint rectangles in this region.
+			[[nodiscard]] const std::vector<rectd> &get_rectangles() const {
+				return _rects;
+			}
+		protected:
+			std::vector<rectd> _rects; ///< The rectangles in this region.
+		};
 	}
 }
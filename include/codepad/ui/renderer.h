@@ -621,7 +621,7 @@ namespace codepad {
 			/// Finishes drawing to the last render target on which \ref begin_drawing() has been called.
 			virtual void end_drawing() = 0;
 
-			/// Clears the current surface using the given color.
+			/// Clears the current surface using the given color. Only the region inside the current clip is cleared.
 			virtual void clear(colord) = 0;
 
 			// transform
@@ -198,13 +198,14 @@ namespace codepad::ui {
 		/// called if layout is already in progress.
 		void update_element_layout_immediate(element&);
 
-		/// Marks the given element for re-rendering. This will re-render the whole window,
-		/// but even if the visual of multiple elements in the window is invalidated,
-		/// the window is still rendered once.
+		/// Marks the given element for re-rendering. This will re-render the region of the window covered by the
+		/// nearest ancestor (or the element itself) that clips its contents, or the whole window if there's no such
+		/// element. Even if the visual of multiple elements in the window is invalidated, the window is still
+		/// rendered once.
 		void invalidate_visual(element &e) {
 			_dirty.insert(&e);
 		}
-		/// Re-renders the windows that contain elements whose visuals are invalidated.
+		/// Re-renders the regions of windows that contain elements whose visuals are invalidated.
 		void update_invalid_visuals();
 
 
@@ -8,6 +8,8 @@
 
 #include <chrono>
 #include <functional>
+#include <optional>
+#include <vector>
 
 #include "codepad/core/encodings.h"
 #include "codepad/core/event.h"
@@ -76,6 +78,17 @@ namespace codepad::ui {
 
 			/// Invoked when this winodw needs redrawing.
 			virtual void _invalidate_window_visuals() = 0;
+			/// Invoked when the given region of this window, in window coordinates, needs redrawing. By default this
+			/// function calls \ref _invalidate_window_visuals().
+			virtual void _invalidate_window_region(rectd) {
+				_invalidate_window_visuals();
+			}
+			/// Returns whether the contents of this window are preserved between frames, so that only invalidated
+			/// regions need to be redrawn. If this returns \p false, \ref window::invalidate_window_region() always
+			/// redraws the entire window.
+			[[nodiscard]] virtual bool _supports_partial_redraw() const {
+				return false;
+			}
 
 			/// Sets whether the `maximize' button is displayed.
 			virtual void _set_display_maximize_button(bool) = 0;
@@ -125,6 +138,7 @@ namespace codepad::ui {
 		friend scheduler;
 		friend element_collection;
 		friend renderer_base;
+		friend element;
 		friend os::window_impl;
 	public:
 		/// Contains information about the resizing of a window.
@@ -193,10 +207,32 @@ namespace codepad::ui {
 			_impl->_hide();
 		}
 
-		/// Invoked when any element in this winodw needs redrawing.
+		/// Invoked when any element in this winodw needs redrawing. The entire window will be redrawn.
 		void invalidate_window_visuals() {
+			_full_redraw = true;
+			_damage.clear();
 			_impl->_invalidate_window_visuals();
 		}
+		/// Marks the given region of this window, in window coordinates, as needing redrawing. Falls back to
+		/// \ref invalidate_window_visuals() if the window cannot be partially redrawn.
+		void invalidate_window_region(rectd region) {
+			if (!_impl->_supports_partial_redraw()) {
+				invalidate_window_visuals();
+				return;
+			}
+			// align the region to pixels so that partially covered pixels are not blended during redraws
+			region = region.fit_grid_enlarge<double>();
+			if (!_full_redraw) {
+				_damage.add(region);
+			}
+			_impl->_invalidate_window_region(region);
+		}
+		/// During rendering, returns the bounding box of the region of this window that's being redrawn, in the
+		/// coordinate system of the renderer (i.e., not transformed by \ref renderer_base::get_matrix()). Returns
+		/// \p std::nullopt if the entire window is being redrawn or if the window is not being rendered.
+		[[nodiscard]] const std::optional<rectd> &get_rendering_damage() const {
+			return _rendering_damage;
+		}
 
 		/// Sets whether the `maximize' button is displayed.
 		void set_display_maximize_button(bool b) {
@@ -311,6 +347,10 @@ namespace codepad::ui {
 		std::any _renderer_data; ///< Renderer-specific data associated with this window.
 		std::unique_ptr<_details::window_impl> _impl; ///< The implementation of this window.
 		element *_capture = nullptr; ///< The element that captures the mouse.
+		damage_region _damage; ///< The region that needs to be redrawn. Ignored if \ref _full_redraw is \p true.
+		/// The region that's currently being redrawn. See \ref get_rendering_damage().
+		mutable std::optional<rectd> _rendering_damage;
+		bool _full_redraw = false; ///< Whether the entire window needs to be redrawn.
 		size_policy
 			_width_policy = size_policy::user,
 			_height_policy = size_policy::user;
@@ -319,11 +359,30 @@ namespace codepad::ui {
 		/// corresponding \ref mouse_position object. Note that the input position is in device independent units.
 		mouse_position _update_mouse_position(vec2d);
 
-		/// Calls \ref renderer_base::begin_drawing() and \ref renderer_base::clear() to start rendering to this
-		/// window.
+		/// Returns whether the entire window will be redrawn during the next rendering pass, i.e., when
+		/// \ref _full_redraw is set or when no specific region has been invalidated. The latter happens when the
+		/// system requests the window to be redrawn.
+		[[nodiscard]] bool _is_full_redraw() const {
+			return _full_redraw || _damage.empty();
+		}
+		/// Replaces the damaged region with the given list of rectangles in window coordinates. This is used by
+		/// implementations when the system reports the exact region to redraw. If the list is empty, the entire
+		/// window will be redrawn.
+		void _set_damage(const std::vector<rectd> &rects) {
+			_damage.clear();
+			for (const rectd &r : rects) {
+				_damage.add(r);
+			}
+			_full_redraw = _damage.empty();
+		}
+
+		/// Calls \ref renderer_base::begin_drawing() to start rendering to this window, and clears the window if
+		/// it's going to be fully redrawn.
 		void _on_prerender() override;
-		/// Ignores all child windows.
-		void _custom_render() const override {
+		/// Renders the window once for each damaged rectangle, clipped to that rectangle. Ignores all child windows.
+		void _custom_render() const override;
+		/// Renders the window itself and all children that are not windows.
+		void _render_contents() const {
 			element::_custom_render();
 			for (auto i = _children.z_ordered().rbegin(); i != _children.z_ordered().rend(); ++i) {
 				if (!(*i)->_get_as_window()) {
@@ -331,7 +390,7 @@ namespace codepad::ui {
 				}
 			}
 		}
-		/// Calls \ref renderer_base::end_drawing() to stop drawing.
+		/// Calls \ref renderer_base::end_drawing() to stop drawing, and resets the damaged region.
 		void _on_postrender() override;
 
 		/// Called when the user clicks the `close' button.
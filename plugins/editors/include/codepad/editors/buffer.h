@@ -31,6 +31,14 @@ namespace codepad::editors {
 		external ///< This edit is made externally.
 	};
 
+	/// Indicates how the contents of a file is loaded into a \ref buffer.
+	enum class file_load_mode : unsigned char {
+		read, ///< The file is read into memory in its entirety.
+		/// The file is memory-mapped, and chunks point directly into the mapping until they're modified. This makes
+		/// opening large files much faster, but the file must not be modified externally while it's open.
+		memory_mapped
+	};
+
 	/// Stores the contents of a file as binary data. The contents is split into chunks and stored in a binary tree.
 	/// Each node contains one chunk and some additional data to help navigate to a certain position.
 	class buffer : public std::enable_shared_from_this<buffer> {
@@ -49,17 +57,94 @@ namespace codepad::editors {
 		/// Additional data for the \ref language_changed event.
 		using language_changed_info = value_update_info<language_id, value_update_info_contents::old_value>;
 
-		/// Stores the contents of a chunk.
+		/// Stores the contents of a chunk. The bytes are either owned by the chunk, or reside in a memory-mapped
+		/// file that's shared by all chunks loaded from it, in which case they're copied into \ref _owned_data the
+		/// first time the chunk is modified.
 		struct chunk_data {
-			byte_array data; ///< The binary data.
-			red_black_tree::color color = red_black_tree::color::black; ///< The color of this node.
+		public:
+			/// Default constructor.
+			chunk_data() = default;
+			/// Initializes this chunk with the given owned data.
+			explicit chunk_data(byte_array data) : _owned_data(std::move(data)) {
+			}
+			/// Initializes this chunk as a view into the given file mapping.
+			chunk_data(const std::byte *beg, const std::byte *end, std::shared_ptr<const os::file_mapping> mapping) :
+				_mapping(std::move(mapping)), _mapped_begin(beg), _mapped_end(end) {
+			}
+
+			/// Returns a pointer to the first byte of this chunk.
+			[[nodiscard]] const std::byte *begin() const {
+				return _mapping ? _mapped_begin : _owned_data.data();
+			}
+			/// Returns a pointer past the last byte of this chunk.
+			[[nodiscard]] const std::byte *end() const {
+				return _mapping ? _mapped_end : _owned_data.data() + _owned_data.size();
+			}
+			/// Returns the number of bytes in this chunk.
+			[[nodiscard]] std::size_t size() const {
+				return static_cast<std::size_t>(end() - begin());
+			}
+			/// Returns whether the contents of this chunk still reside in a memory-mapped file.
+			[[nodiscard]] bool is_mapped() const {
+				return _mapping != nullptr;
+			}
+
+			/// Returns the data of this chunk for modification, copying it out of the mapped file if necessary.
+			[[nodiscard]] byte_array &get_mutable_data() {
+				if (_mapping) {
+					_owned_data.assign(_mapped_begin, _mapped_end);
+					_mapping.reset();
+					_mapped_begin = _mapped_end = nullptr;
+				}
+				return _owned_data;
+			}
+			/// Erases the given range of bytes. Mapped chunks are only copied if the range is in the middle of it.
+			void erase(std::size_t beg, std::size_t end) {
+				if (_mapping) {
+					if (end == size()) {
+						_mapped_end = _mapped_begin + beg;
+						return;
+					}
+					if (beg == 0) {
+						_mapped_begin += end;
+						return;
+					}
+				}
+				byte_array &data = get_mutable_data();
+				data.erase(data.begin() + beg, data.begin() + end);
+			}
+			/// Appends the given bytes to this chunk.
+			void append(const std::byte *beg, const std::byte *end) {
+				byte_array &data = get_mutable_data();
+				data.insert(data.end(), beg, end);
+			}
+			/// Truncates this chunk at the given position and returns a new chunk containing all bytes after it.
+			/// Mapped chunks are split without copying.
+			[[nodiscard]] chunk_data split(std::size_t pos) {
+				if (_mapping) {
+					chunk_data result(_mapped_begin + pos, _mapped_end, _mapping);
+					_mapped_end = _mapped_begin + pos;
+					return result;
+				}
+				chunk_data result(byte_array(_owned_data.begin() + pos, _owned_data.end()));
+				_owned_data.erase(_owned_data.begin() + pos, _owned_data.end());
+				return result;
+			}
 
-			/// Returns the length of \ref data. This is only used for properties.
+			/// Returns the length of this chunk. This is only used for properties.
 			std::size_t data_length() const {
-				return data.size();
+				return size();
 			}
-		};
 
+			red_black_tree::color color = red_black_tree::color::black; ///< The color of this node.
+		protected:
+			byte_array _owned_data; ///< The data owned by this chunk.
+			/// The file mapping that this chunk points into, or \p nullptr if this chunk owns its data.
+			std::shared_ptr<const os::file_mapping> _mapping;
+			const std::byte
+				*_mapped_begin = nullptr, ///< The first byte of this chunk in the mapped file.
+				*_mapped_end = nullptr; ///< Pointer past the last byte of this chunk in the mapped file.
+		};
 		/// Stores additional data of a node in the tree.
 		struct node_data {
 		public:
@@ -86,29 +171,30 @@ namespace codepad::editors {
 		using node_type = tree_type::node;
 
 		/// An iterator over the bytes in the buffer. Declared as a template class to avoid <tt>const_cast</tt>s.
+		/// Since chunks may point into read-only file mappings, bytes can only be accessed through const pointers.
 		///
 		/// \tparam TIt The type of the tree's iterators.
-		/// \tparam SIt The type of the chunk's iterators.
+		/// \tparam SIt The type of pointers to the chunk's bytes.
 		template <typename TIt, typename SIt> struct iterator_base {
 			friend buffer;
 		public:
 			using value_type = std::byte; ///< Type of values pointed to by these iterators.
-			using pointer = typename SIt::pointer; ///< Pointers to underlying elements.
-			using reference = typename SIt::reference; ///< References to underlying elements.
+			using pointer = typename std::iterator_traits<SIt>::pointer; ///< Pointers to underlying elements.
+			using reference = typename std::iterator_traits<SIt>::reference; ///< References to underlying elements.
 
 			/// Default constructor.
 			iterator_base() = default;
 			/// Copy constructor for non-const iterators, and converting constructor for const iterators.
-			iterator_base(const iterator_base<tree_type::iterator, byte_array::iterator> &it) :
+			iterator_base(const iterator_base<tree_type::iterator, const std::byte*> &it) :
 				_it(it._it), _s(it._s), _chunkpos(it._chunkpos) {
 			}
 
 			/// Prefix increment.
 			iterator_base &operator++() {
-				if (++_s == _it->data.end()) {
-					_chunkpos += _it->data.size();
+				if (++_s == _it->end()) {
+					_chunkpos += _it->size();
 					++_it;
-					_s = (_it != _it.get_container()->end() ? _it.get_value_rawmod().data.begin() : SIt());
+					_s = (_it != _it.get_container()->end() ? _it->begin() : SIt());
 				}
 				return *this;
 			}
@@ -120,10 +206,10 @@ namespace codepad::editors {
 			}
 			/// Prefix decrement.
 			iterator_base &operator--() {
-				if (_it == _it.get_container()->end() || _s == _it->data.begin()) {
+				if (_it == _it.get_container()->end() || _s == _it->begin()) {
 					--_it;
-					_chunkpos -= _it->data.size();
-					_s = _it.get_value_rawmod().data.end();
+					_chunkpos -= _it->size();
+					_s = _it->end();
 				}
 				--_s;
 				return *this;
@@ -156,7 +242,7 @@ namespace codepad::editors {
 			/// Returns the position of the byte to which this iterator points.
 			std::size_t get_position() const {
 				if (_it != _it.get_container()->end()) {
-					return _chunkpos + (_s - _it->data.begin());
+					return _chunkpos + _get_offset_in_chunk();
 				}
 				return _chunkpos;
 			}
@@ -170,14 +256,19 @@ namespace codepad::editors {
 			iterator_base(const TIt &t, const SIt &s, std::size_t chkpos) : _it(t), _s(s), _chunkpos(chkpos) {
 			}
 
+			/// Returns the offset of \ref _s from the beginning of its chunk. \ref _it must not be the end.
+			[[nodiscard]] std::size_t _get_offset_in_chunk() const {
+				return static_cast<std::size_t>(_s - _it->begin());
+			}
+
 			TIt _it; ///< The tree's iterator.
 			SIt _s{}; ///< The chunk's iterator.
 			std::size_t _chunkpos = 0; ///< The position of the first byte of \ref _it in the \ref buffer.
 		};
 		/// Iterator type.
-		using iterator = iterator_base<tree_type::iterator, byte_array::iterator>;
+		using iterator = iterator_base<tree_type::iterator, const std::byte*>;
 		/// Const iterator type.
-		using const_iterator = iterator_base<tree_type::const_iterator, byte_array::const_iterator>;
+		using const_iterator = iterator_base<tree_type::const_iterator, const std::byte*>;
 
 		/// The position information of a modification.
 		///
@@ -452,19 +543,20 @@ namespace codepad::editors {
 		buffer(std::size_t id, buffer_manager &man) :
 			_fileid(std::in_place_type<std::size_t>, id), _buf_manager(man) {
 		}
-		/// Constructs this \ref buffer with the given file name, and loads that file's contents.
-		buffer(const std::filesystem::path&, buffer_manager&);
+		/// Constructs this \ref buffer with the given file name, and loads that file's contents using the given
+		/// \ref file_load_mode.
+		buffer(const std::filesystem::path&, buffer_manager&, file_load_mode = file_load_mode::read);
 		/// Invokes \ref buffer_manager::_on_deleting_buffer().
 		~buffer();
 
 		/// Returns an iterator to the first byte.
 		[[nodiscard]] const_iterator begin() const {
 			auto it = _t.begin();
-			return const_iterator(it, it == _t.end() ? byte_array::const_iterator() : it->data.begin(), 0);
+			return const_iterator(it, it == _t.end() ? nullptr : it->begin(), 0);
 		}
 		/// Returns an iterator past the last byte.
 		[[nodiscard]] const_iterator end() const {
-			return const_iterator(_t.end(), byte_array::const_iterator(), length());
+			return const_iterator(_t.end(), nullptr, length());
 		}
 
 		/// Returns an iterator to the first chunk of the buffer.
@@ -482,6 +574,31 @@ namespace codepad::editors {
 		/// Returns a clip of the buffer.
 		[[nodiscard]] byte_string get_clip(const const_iterator &beg, const const_iterator &end) const;
 
+		/// Reads the contents of a \ref buffer chunk by chunk without copying them. Since consecutive reads are
+		/// usually sequential, the reader remembers the chunk it last visited and only searches the tree when the
+		/// requested position is in neither that chunk nor the next one. The buffer must not be modified while a
+		/// reader is in use.
+		class chunk_reader {
+		public:
+			/// Default constructor.
+			chunk_reader() = default;
+			/// Initializes \ref _buf and starts at the first chunk.
+			explicit chunk_reader(const buffer &buf) : _buf(&buf), _it(buf._t.begin()) {
+			}
+
+			/// Returns the bytes from the given position to the end of the chunk that contains it. If the position
+			/// is at or past the end of the buffer, an empty range is returned.
+			[[nodiscard]] std::pair<const std::byte*, const std::byte*> read(std::size_t);
+			/// Returns the position of the first byte of the chunk that was last read.
+			[[nodiscard]] std::size_t get_chunk_position() const {
+				return _chunk_begin;
+			}
+		protected:
+			const buffer *_buf = nullptr; ///< The buffer.
+			tree_type::const_iterator _it; ///< The chunk that was last visited.
+			std::size_t _chunk_begin = 0; ///< The position of the first byte of \ref _it.
+		};
+
 		/// Returns the index after the last edit made to this buffer, potentially after redoing or undoing.
 		[[nodiscard]] std::size_t current_edit() const {
 			return _curedit;
@@ -552,60 +669,79 @@ namespace codepad::editors {
 		/// Invoked when the language of this buffer is changed via \ref set_language().
 		info_event<language_changed_info> language_changed;
 	protected:
+		/// A random-access iterator that slices a range of bytes into \ref chunk_data objects of at most
+		/// \ref maximum_bytes_per_chunk bytes on dereference. An optional suffix is appended to the last chunk.
+		/// This is used to build new nodes directly from the source bytes without buffering the chunks.
+		struct _chunk_slicer {
+		public:
+			/// Default constructor.
+			_chunk_slicer() = default;
+			/// Initializes all fields of this struct.
+			_chunk_slicer(
+				const std::byte *beg, const std::byte *end, std::size_t index,
+				const std::byte *suffix_beg = nullptr, const std::byte *suffix_end = nullptr
+			) : _beg(beg), _end(end), _suffix_beg(suffix_beg), _suffix_end(suffix_end), _index(index) {
+			}
+
+			/// Returns the number of chunks that the given number of bytes are sliced into.
+			[[nodiscard]] inline static std::size_t get_num_chunks(std::size_t bytes) {
+				return (bytes + maximum_bytes_per_chunk - 1) / maximum_bytes_per_chunk;
+			}
+
+			/// Creates the chunk at the current position.
+			[[nodiscard]] chunk_data operator*() const {
+				const std::byte *chunk_beg = _beg + _index * maximum_bytes_per_chunk;
+				const std::byte *chunk_end =
+					static_cast<std::size_t>(_end - chunk_beg) > maximum_bytes_per_chunk ?
+					chunk_beg + maximum_bytes_per_chunk :
+					_end;
+				byte_array data;
+				data.reserve(maximum_bytes_per_chunk);
+				data.insert(data.end(), chunk_beg, chunk_end);
+				if (chunk_end == _end) {
+					data.insert(data.end(), _suffix_beg, _suffix_end);
+				}
+				return chunk_data(std::move(data));
+			}
+
+			/// Returns an iterator that's the given number of chunks after this one.
+			[[nodiscard]] _chunk_slicer operator+(std::ptrdiff_t diff) const {
+				_chunk_slicer result = *this;
+				result._index = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(_index) + diff);
+				return result;
+			}
+			/// Returns the distance between two iterators over the same range.
+			[[nodiscard]] friend std::ptrdiff_t operator-(const _chunk_slicer &lhs, const _chunk_slicer &rhs) {
+				return static_cast<std::ptrdiff_t>(lhs._index) - static_cast<std::ptrdiff_t>(rhs._index);
+			}
+			/// Compares the positions of two iterators over the same range.
+			[[nodiscard]] friend bool operator==(const _chunk_slicer &lhs, const _chunk_slicer &rhs) {
+				return lhs._index == rhs._index;
+			}
+		protected:
+			const std::byte
+				*_beg = nullptr, ///< The beginning of the sliced range.
+				*_end = nullptr, ///< The end of the sliced range.
+				*_suffix_beg = nullptr, ///< The beginning of the suffix appended to the last chunk.
+				*_suffix_end = nullptr; ///< The end of the suffix appended to the last chunk.
+			std::size_t _index = 0; ///< The index of the current chunk.
+		};
 		/// Used to find the chunk in which the byte at the given index lies.
 		using _byte_index_finder = sum_synthesizer::index_finder<node_data::length_property>;
 
+		/// Loads the given file by mapping it into memory. Chunks point into the mapping until they're modified.
+		///
+		/// \return \p false if the file cannot be mapped, in which case the buffer is left empty.
+		bool _load_file_mapped(const std::filesystem::path&);
+		/// Loads the given file by reading all of its contents.
+		void _load_file_read(const std::filesystem::path&);
+
 		// functions that modify this buffer; these should be protected by the lock
 		/// Erases a subsequence from the buffer.
 		void _erase(const_iterator beg, const_iterator end);
-		/// Inserts an array of bytes at the given position.
-		template <typename It1, typename It2> void _insert(const_iterator pos, const It1 &beg, const It2 &end) {
-			if (beg == end) {
-				return;
-			}
-			tree_type::const_iterator insit = pos._it, updit = insit;
-			chunk_data afterstr, *curstr;
-			std::vector<chunk_data> strs; // the buffer for (not all) inserted bytes
-			if (pos == begin()) { // insert at the very beginning, no need to split or update
-				updit = _t.end();
-				chunk_data st;
-				st.data.reserve(maximum_bytes_per_chunk);
-				strs.push_back(std::move(st));
-				curstr = &strs.back();
-			} else if (pos._it == _t.end() || pos._s == pos._it->data.begin()) {
-				// insert at the beginning of a chunk, which is not the first chunk
-				--updit;
-				curstr = &updit.get_value_rawmod();
-			} else { // insert at the middle of a chunk
-				// save the second part & truncate the chunk
-				afterstr.data = byte_array(pos._s, pos._it->data.end());
-				pos._it.get_value_rawmod().data.erase(pos._s, pos._it->data.end());
-				++insit;
-				curstr = &updit.get_value_rawmod();
-			}
-			for (auto it = beg; it != end; ++it) { // insert codepoints
-				if (curstr->data.size() == maximum_bytes_per_chunk) { // curstr would be too long, add a new chunk
-					strs.emplace_back();
-					curstr = &strs.back();
-					curstr->data.reserve(maximum_bytes_per_chunk);
-				}
-				curstr->data.emplace_back(*it); // append byte to curstr
-			}
-			if (!afterstr.data.empty()) { // at the middle of a chunk, add the second part to the strings
-				if (curstr->data.size() + afterstr.data.size() <= maximum_bytes_per_chunk) {
-					curstr->data.insert(curstr->data.end(), afterstr.data.begin(), afterstr.data.end());
-				} else {
-					strs.push_back(std::move(afterstr)); // curstr is not changed
-				}
-			}
-			_t.refresh_synthesized_result(updit.get_node()); // this function checks if updit is end
-			// TODO insert without buffering
-			for (chunk_data &data : strs) {
-				_t.emplace_before(insit, std::move(data));
-			}
-			// try to merge small nodes
-			_try_merge_small_nodes(insit);
-		}
+		/// Inserts an array of bytes at the given position. New chunks are built directly into a balanced subtree,
+		/// which is then spliced into \ref _t.
+		void _insert(const_iterator pos, const std::byte *beg, const std::byte *end);
 
 		/// Merges a node with one or more of its neighboring nodes if their total length are smaller than the
 		/// maximum value. Note that this function does not ensure the validity of any iterator after this operation.
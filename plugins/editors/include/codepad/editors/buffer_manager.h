@@ -89,8 +89,8 @@ namespace codepad::editors {
 
 		/// Returns a \p std::shared_ptr<buffer> to the file specified by the given file name. If the file has not
 		/// been opened, this function opens the file; otherwise, it returns the pointer returned by previous calls
-		/// to this function. The file must exist.
-		std::shared_ptr<buffer> open_file(std::filesystem::path path) {
+		/// to this function, in which case \p mode is ignored. The file must exist.
+		std::shared_ptr<buffer> open_file(std::filesystem::path path, file_load_mode mode = file_load_mode::read) {
 			// check for existing file
 			path = std::filesystem::canonical(path);
 			auto ins = _file_map.try_emplace(path);
@@ -100,7 +100,7 @@ namespace codepad::editors {
 				return ptr;
 			}
 			// create new one
-			auto res = std::make_shared<buffer>(path, *this);
+			auto res = std::make_shared<buffer>(path, *this, mode);
 			ins.first->second.buf = res;
 			res->_tags.resize(_buffer_tag_alloc_max); // allocate space for tags
 			buffer_created.construct_info_and_invoke(*res);
@@ -0,0 +1,156 @@
+// Copyright (c) the Codepad contributors. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+/// \file
+/// An input stream for regular expressions that reads directly from a \ref codepad::editors::buffer.
+
+#include <atomic>
+
+#include <codepad/core/encodings.h>
+#include <codepad/core/unicode/common.h>
+
+#include "../buffer.h"
+#include "interpretation.h"
+
+namespace codepad::editors::code {
+	/// An input stream for \ref regex::matcher that decodes the codepoints of an \ref interpretation directly from
+	/// the chunks of its \ref buffer. This provides the same interface as \ref regex::basic_input_stream, and
+	/// positions returned by \ref codepoint_position() are positions of codepoints in the whole document. Invalid
+	/// codepoints are reported as \ref unicode::replacement_character.
+	///
+	/// Copying this stream is cheap. The buffer must not be modified while any copy of it is in use.
+	class buffer_input_stream {
+	public:
+		/// The number of codepoints between two checks of the cancellation flag.
+		constexpr static std::size_t cancellation_check_interval = 100000;
+		/// The maximum supported length of a codepoint in bytes.
+		constexpr static std::size_t maximum_codepoint_length = 8;
+
+		/// Default constructor.
+		buffer_input_stream() = default;
+		/// Creates a stream that starts at the beginning of the given \ref interpretation. If \p cancelled is not
+		/// \p nullptr, it is checked every \ref cancellation_check_interval codepoints, and the stream ends early
+		/// once it's set.
+		explicit buffer_input_stream(const interpretation&, const std::atomic_bool *cancelled = nullptr);
+		/// Creates a stream that starts at the given codepoint, whose first byte is at \p byte_pos, and ends before
+		/// the byte at \p end. The stream can still be moved backwards past its starting position.
+		buffer_input_stream(
+			const interpretation&, std::size_t codepoint_pos, std::size_t byte_pos, std::size_t end,
+			const std::atomic_bool *cancelled = nullptr
+		);
+
+		/// Returns whether the stream is at the end of the document.
+		[[nodiscard]] bool empty() const {
+			return _byte_pos >= _length;
+		}
+		/// Returns the current codepoint and moves to the next one.
+		codepoint take() {
+			assert_true_logical(!empty(), "taking from an empty stream");
+			codepoint res = _cp;
+			_prev_cp = res;
+			_prev_valid = true;
+			_byte_pos = _next_byte_pos;
+			++_pos;
+			if (_cancelled && _pos % cancellation_check_interval == 0 && _cancelled->load()) {
+				_length = _byte_pos; // end the stream here
+				return res;
+			}
+			_decode();
+			return res;
+		}
+		/// Returns the current codepoint.
+		[[nodiscard]] codepoint peek() const {
+			assert_true_logical(!empty(), "peeking an empty stream");
+			return _cp;
+		}
+
+		/// Returns whether it's possible to move to the previous codepoint.
+		[[nodiscard]] bool prev_empty() const {
+			return _pos == 0;
+		}
+		/// Moves to the previous codepoint and returns it.
+		codepoint prev();
+		/// Returns the previous codepoint without moving this stream.
+		[[nodiscard]] codepoint peek_prev() const {
+			assert_true_logical(!prev_empty(), "peeking an empty stream backwards");
+			return _prev_valid ? _prev_cp : _decode_previous().second;
+		}
+
+		/// Returns the current codepoint position.
+		[[nodiscard]] std::size_t codepoint_position() const {
+			return _pos;
+		}
+		/// Returns the current byte position.
+		[[nodiscard]] std::size_t byte_position() const {
+			return _byte_pos;
+		}
+	protected:
+		buffer::chunk_reader _reader; ///< Used to read chunks of the buffer.
+		/// Used to read \ref _back_chunk. This is separate from \ref _reader so that moving backwards does not
+		/// affect reading forward.
+		mutable buffer::chunk_reader _back_reader;
+		/// The chunk that contains the byte before \ref _byte_pos, used when moving backwards, or \p nullptr if it
+		/// hasn't been read.
+		mutable const std::byte *_back_chunk = nullptr;
+		mutable std::size_t
+			_back_chunk_pos = 0, ///< The position of the first byte of \ref _back_chunk.
+			_back_chunk_size = 0; ///< The number of bytes in \ref _back_chunk.
+		const interpretation *_interp = nullptr; ///< The associated \ref interpretation.
+		const buffer_encoding *_encoding = nullptr; ///< The encoding of \ref _interp.
+		const std::atomic_bool *_cancelled = nullptr; ///< The cancellation flag.
+		/// Points to the byte at \ref _next_byte_pos in the chunk that was last read, or \p nullptr if the chunk
+		/// needs to be read again.
+		const std::byte *_next = nullptr;
+		const std::byte *_chunk_end = nullptr; ///< The end of the chunk that \ref _next points into.
+		std::size_t
+			_pos = 0, ///< The position of \ref _cp in codepoints.
+			_byte_pos = 0, ///< The position of the first byte of \ref _cp.
+			_next_byte_pos = 0, ///< The position of the byte after \ref _cp.
+			_length = 0, ///< The length of the stream in bytes.
+			_max_codepoint_length = 0; ///< The maximum length of a codepoint in \ref _encoding.
+		codepoint
+			_cp = 0, ///< The current codepoint.
+			_prev_cp = 0; ///< The previous codepoint, valid only if \ref _prev_valid is \p true.
+		bool
+			_prev_valid = false, ///< Whether \ref _prev_cp is valid.
+			_utf8 = false; ///< Whether \ref _encoding is UTF-8, in which case codepoints are decoded directly.
+
+		/// Decodes the codepoint at \ref _byte_pos.
+		void _decode() {
+			if (empty()) {
+				return;
+			}
+			if (_next == nullptr || _next == _chunk_end) {
+				auto [beg, end] = _reader.read(_byte_pos);
+				_next = beg;
+				_chunk_end = end;
+			}
+			auto available = static_cast<std::size_t>(_chunk_end - _next);
+			if (available < _max_codepoint_length && _byte_pos + available < _interp->get_buffer().length()) {
+				_decode_across_chunks(); // the codepoint may span multiple chunks
+				return;
+			}
+			const std::byte *it = _next;
+			bool valid =
+				_utf8 ?
+				encodings::utf8::next_codepoint(it, _chunk_end, _cp) :
+				_encoding->next_codepoint(it, _chunk_end, _cp);
+			if (!valid) {
+				_cp = unicode::replacement_character;
+			}
+			_next_byte_pos = _byte_pos + static_cast<std::size_t>(it - _next);
+			_next = it;
+		}
+		/// Decodes the codepoint at \ref _byte_pos by first copying its bytes out of multiple chunks.
+		void _decode_across_chunks();
+		/// Decodes the codepoint before \ref _pos. For UTF-8, this decodes backwards within \ref _back_chunk, and
+		/// only falls back to \ref _decode_previous_using_interpretation() near the beginning of a chunk.
+		///
+		/// \return The position of its first byte, and the codepoint.
+		[[nodiscard]] std::pair<std::size_t, codepoint> _decode_previous() const;
+		/// Decodes the codepoint before \ref _pos using the codepoint boundaries recorded by \ref _interp.
+		[[nodiscard]] std::pair<std::size_t, codepoint> _decode_previous_using_interpretation() const;
+	};
+}
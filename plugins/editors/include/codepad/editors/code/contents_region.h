@@ -6,10 +6,13 @@
 /// \file
 /// The code editing component of a \ref codepad::editors::editor.
 
+#include <atomic>
+#include <map>
 #include <memory>
 
 #include <codepad/core/red_black_tree.h>
 #include <codepad/core/settings.h>
+#include <codepad/ui/async_task.h>
 #include <codepad/ui/elements/popup.h>
 #include <codepad/ui/elements/stack_panel.h>
 
@@ -19,6 +22,7 @@
 #include "caret_set.h"
 #include "view.h"
 #include "fragment_generation.h"
+#include "word_wrapping.h"
 
 namespace codepad::editors {
 	class buffer_manager;
@@ -106,6 +110,10 @@ namespace codepad::editors::code {
 		/// Sets the set of font families.
 		void set_font_families(std::vector<std::shared_ptr<ui::font_family>> fs) {
 			_font_families = std::move(fs);
+			_text_cache.clear();
+			_line_layouts.clear();
+			_wrapping_metrics.reset();
+			_start_wrapping();
 			_on_editing_visual_changed();
 		}
 		/// Returns the set of font families.
@@ -116,6 +124,9 @@ namespace codepad::editors::code {
 		/// Sets the font size.
 		void set_font_size(double size) {
 			_font_size = size;
+			_text_cache.clear();
+			_line_layouts.clear();
+			_start_wrapping();
 			_on_editing_visual_changed();
 		}
 		/// Returns the font size.
@@ -123,9 +134,16 @@ namespace codepad::editors::code {
 			return _font_size;
 		}
 
+		/// Returns the cache of shaped text used when rendering this region. Caching does not affect the state of
+		/// this region, so this can be accessed through a const reference.
+		[[nodiscard]] plain_text_cache &get_plain_text_cache() const {
+			return _text_cache;
+		}
+
 		/// Sets the height of a line.
 		void set_line_height(double val) {
 			_line_height = val;
+			_line_layouts.clear();
 			_on_editing_visual_changed();
 		}
 		/// Returns the height of a line.
@@ -141,6 +159,8 @@ namespace codepad::editors::code {
 		/// Sets the maximum width of a tab character relative to the width of spaces.
 		void set_tab_space_width(double w) {
 			_tab_space_width = w;
+			_line_layouts.clear();
+			_start_wrapping();
 			_on_editing_visual_changed();
 		}
 		/// Returns the maximum width of a tab character relative to the width of spaces.
@@ -164,6 +184,7 @@ namespace codepad::editors::code {
 		/// Sets \ref _invalid_cp_func.
 		void set_invalid_codepoint_fragment_func(invalid_codepoint_fragment_func fmt) {
 			_invalid_cp_func = std::move(fmt);
+			_line_layouts.clear();
 			_on_editing_visual_changed();
 		}
 		/// Returns \ref _invalid_cp_func.
@@ -174,10 +195,27 @@ namespace codepad::editors::code {
 		/// Sets the font size and automatically adjusts the line height.
 		void set_font_size_and_line_height(double fontsize) {
 			_font_size = fontsize;
+			_text_cache.clear();
+			_line_layouts.clear();
 			_line_height = _font_size * 1.5; // TODO magic number
+			_start_wrapping();
 			_on_editing_visual_changed();
 		}
 
+		/// Enables or disables word wrapping. Word wrapping of the whole document is computed asynchronously, and
+		/// soft linebreaks are updated as parts of the document finish.
+		void set_word_wrap(bool wrap) {
+			if (_word_wrap != wrap) {
+				_word_wrap = wrap;
+				_start_wrapping();
+				_on_editing_visual_changed();
+			}
+		}
+		/// Returns whether word wrapping is enabled.
+		[[nodiscard]] bool get_word_wrap() const {
+			return _word_wrap;
+		}
+
 		/// Returns the length of scrolling by one tick.
 		double get_vertical_scroll_delta() const override {
 			return get_line_height() * _lines_per_scroll;
@@ -604,6 +642,8 @@ namespace codepad::editors::code {
 
 		/// Retrieves the setting entry that determines the font families.
 		static settings::retriever_parser<std::vector<std::u8string>> &get_backup_fonts_setting(settings&);
+		/// Retrieves the setting entry that determines whether word wrapping is enabled.
+		static settings::retriever_parser<bool> &get_word_wrap_setting(settings&);
 
 		/// The default formatter for invalid codepoints.
 		inline static std::u8string format_invalid_codepoint(codepoint value) {
@@ -631,6 +671,87 @@ namespace codepad::editors::code {
 		}
 
 		using _base = interactive_contents_region_base<caret_set>; ///< The base type.
+		/// The cached layout of a single visual line.
+		struct _line_layout {
+			/// A fragment in the line, and where it has been placed.
+			struct placed_fragment {
+				/// Default constructor.
+				placed_fragment() = default;
+				/// Initializes all fields of this struct.
+				placed_fragment(
+					fragment_generation_result res, fragment_assembler::rendering_storage rend,
+					std::size_t end, vec2d endpos
+				) : result(std::move(res)), rendering(std::move(rend)), end_offset(end), end_position(endpos) {
+				}
+
+				fragment_generation_result result; ///< The fragment.
+				/// The rendering of \ref result. Vertical positions are relative to the top of the line.
+				fragment_assembler::rendering_storage rendering;
+				std::size_t end_offset = 0; ///< The position after this fragment relative to the start of the line.
+				/// The position of the \ref fragment_assembler after this fragment, relative to the top-left corner
+				/// of the line.
+				vec2d end_position;
+			};
+
+			std::vector<placed_fragment> fragments; ///< All fragments in this line.
+			std::size_t length = 0; ///< The number of characters between the start of this line and the next.
+			/// Indicates that this line is wider than the region, and that the fragments have been truncated.
+			bool overflow = false;
+			/// Indicates that the word wrapping of the line that contains this visual line has been checked against
+			/// its actual layout.
+			bool wrapping_checked = false;
+		};
+		/// Lines longer than this are not checked against their actual layout after being wrapped.
+		constexpr static std::size_t _maximum_wrapping_check_length = 16 * 1024;
+		/// State shared by all \ref _wrapping_task objects of a single pass of word wrapping.
+		struct _wrapping_context {
+			/// Initializes all fields of this struct.
+			_wrapping_context(
+				std::shared_ptr<const word_wrapping_metrics> m, word_wrapping_metrics::parameters p,
+				std::vector<std::pair<std::size_t, std::size_t>> partitions
+			) : metrics(std::move(m)), params(p), pending_partitions(std::move(partitions)) {
+			}
+
+			std::shared_ptr<const word_wrapping_metrics> metrics; ///< Character widths.
+			word_wrapping_metrics::parameters params; ///< Wrapping parameters.
+			/// Ranges of characters of all partitions whose results have not been applied. This is only accessed
+			/// from the main thread.
+			std::vector<std::pair<std::size_t, std::size_t>> pending_partitions;
+			std::atomic_bool cancelled = false; ///< Used to cancel all tasks.
+		};
+		/// A task that computes word wrapping for a range of lines. A document is split into multiple ranges that
+		/// are wrapped in parallel, and the results of each range are applied as soon as it finishes. The task does
+		/// not access the region that created it, so that it does not need to be waited for after cancellation
+		/// caused by edits. Its reference to the document is always released on the main thread.
+		class _wrapping_task : public ui::async_task_base {
+		public:
+			/// The minimum number of characters in a partition.
+			constexpr static std::size_t minimum_partition_length = 256 * 1024;
+			/// The maximum number of characters in a partition. Large documents are split into more partitions than
+			/// there are threads, so that results are applied frequently, and so that an edit only discards the
+			/// progress of partitions that are being wrapped.
+			constexpr static std::size_t maximum_partition_length = 4 * minimum_partition_length;
+
+			/// Initializes all fields of this task.
+			_wrapping_task(
+				std::shared_ptr<_wrapping_context> ctx, std::size_t beg, std::size_t end, contents_region &p
+			) : _context(std::move(ctx)), _doc(p._doc), _begin(beg), _end(end),
+				_scheduler(p.get_manager().get_scheduler()), _parent(&p) {
+			}
+
+			/// Computes word wrapping for the range, then sends the results to the main thread.
+			status execute() override;
+		protected:
+			std::shared_ptr<_wrapping_context> _context; ///< State shared by all tasks of this pass.
+			std::shared_ptr<interpretation> _doc; ///< The document. This is moved to the main thread by \ref execute().
+			std::size_t
+				_begin = 0, ///< The first character of this partition, which is at the beginning of a line.
+				_end = 0; ///< The character after the last character of this partition.
+			ui::scheduler &_scheduler; ///< Used to send the results to the main thread.
+			/// The region that created this task. This is only accessed from the main thread if the task has not
+			/// been cancelled.
+			contents_region *_parent = nullptr;
+		};
 
 		std::shared_ptr<interpretation> _doc; ///< The \ref interpretation bound to this contents_region.
 		info_event<buffer::begin_edit_info>::token _begin_edit_tok; ///< Used to listen to \ref buffer::begin_edit.
@@ -654,6 +775,13 @@ namespace codepad::editors::code {
 			_font_size = 12.0, ///< The font size.
 			_tab_space_width = 4.0, ///< The maximum width of a tab character as a number of spaces.
 			_line_height = 18.0; ///< The height of a line.
+		/// Caches shaped text of fragments. This is cleared when font settings are changed.
+		mutable plain_text_cache _text_cache;
+		/// Cached layouts of visual lines that have been rendered, indexed by the position of their first
+		/// characters. Entries are updated when the document is modified, and are cleared when the layout of all
+		/// lines may have changed.
+		mutable std::map<std::size_t, _line_layout> _line_layouts;
+		mutable double _line_layout_width = 0.0; ///< The width of the region that \ref _line_layouts is created for.
 		// TODO more entries from https://jkorpela.fi/chars/spaces.html ?
 		ui::generic_visual_geometry
 			_whitespace_geometry, ///< Geometry rendered for a whitespace.
@@ -663,6 +791,16 @@ namespace codepad::editors::code {
 			_lf_geometry; ///< Geometry rendered for a LF line break.
 		view_formatting _fmt; ///< The \ref view_formatting associated with this contents_region.
 		double _view_width = 0.0; ///< The width that word wrap is calculated according to.
+		/// Character widths used for word wrapping. This is created when necessary, and is reset when fonts change.
+		std::shared_ptr<const word_wrapping_metrics> _wrapping_metrics;
+		/// State of the current pass of asynchronous word wrapping.
+		std::shared_ptr<_wrapping_context> _wrapping;
+		/// Tokens for all asynchronous tasks of the current pass of word wrapping.
+		std::vector<ui::async_task_scheduler::token<_wrapping_task>> _wrapping_task_tokens;
+		/// Partitions of a pass of word wrapping that has been interrupted by an edit, which are shifted and
+		/// restarted after the edit.
+		std::vector<std::pair<std::size_t, std::size_t>> _interrupted_partitions;
+		bool _word_wrap = false; ///< Whether word wrapping is enabled.
 
 		/// Decoration providers for only this view.
 		view_decoration_provider_list _view_decorations{ contents_region_ref(*this) };
@@ -695,11 +833,13 @@ namespace codepad::editors::code {
 				_doc->appearance_changed += [this](interpretation::appearance_changed_info &info) {
 					if (info.type == interpretation::appearance_change_type::layout_and_visual) {
 						// TODO handle layout change
+						_discard_line_layouts(info.changed_range);
 					}
 					_on_content_visual_changed();
 				}
 			);
 			_fmt = view_formatting(*_doc);
+			_start_wrapping();
 			_on_content_modified();
 		}
 
@@ -782,10 +922,16 @@ namespace codepad::editors::code {
 			if (info.source_element != this) {
 				_interaction_manager.on_edit_operation();
 			}
+			// the tasks cannot continue after the document is modified; partitions that have not finished are
+			// restarted after the edit
+			if (_wrapping) {
+				_interrupted_partitions = std::move(_wrapping->pending_partitions);
+				_cancel_wrapping();
+			}
 			_fmt.prepare_for_edit(*_doc);
 		}
 		/// Called when \ref interpretation::end_modification is triggered. This function performs fixup on carets,
-		/// folded regions, and other positions that may be affected by the modification.
+		/// folded regions, cached line layouts, and other positions that may be affected by the modification.
 		void _on_end_modification(interpretation::end_modification_info&);
 		/// Called when \ref interpretation::end_edit is triggered. Performs necessary adjustments to the view, invokes
 		/// \ref content_modified, then calls \ref _on_content_visual_changed.
@@ -820,17 +966,51 @@ namespace codepad::editors::code {
 			editing_visual_changed.invoke();
 			invalidate_visual();
 		}
-		/// Called when folded regions are added or removed. Invokes \ref folding_changed and calls
-		/// \ref _on_editing_visual_changed.
+		/// Called when folded regions are added or removed. Clears \ref _line_layouts, invokes
+		/// \ref folding_changed, and calls \ref _on_editing_visual_changed.
 		void _on_folding_changed() {
+			_line_layouts.clear();
 			folding_changed.invoke();
 			_on_editing_visual_changed();
 		}
 
-		/// Recalculates word wrapping for the given lines.
-		///
-		/// \todo Currently not of too much use except for calculating word wrapping for the whole document.
-		std::vector<std::size_t> _recalculate_wrapping_region(std::size_t, std::size_t) const;
+		/// Returns whether word wrapping is enabled and can be computed.
+		[[nodiscard]] bool _is_wrapping_active() const {
+			return _word_wrap && _view_width > 0.0 && !_font_families.empty();
+		}
+		/// Returns \ref _wrapping_metrics, creating it if necessary.
+		[[nodiscard]] const std::shared_ptr<const word_wrapping_metrics> &_get_wrapping_metrics() {
+			if (!_wrapping_metrics) {
+				_wrapping_metrics = std::make_shared<word_wrapping_metrics>(_font_families);
+			}
+			return _wrapping_metrics;
+		}
+		/// Returns the parameters used for word wrapping.
+		[[nodiscard]] word_wrapping_metrics::parameters _get_wrapping_parameters() const {
+			word_wrapping_metrics::parameters result;
+			result.width = _view_width;
+			result.font_size = _font_size;
+			result.tab_width = get_tab_width();
+			return result;
+		}
+		/// Cancels the current pass of word wrapping, then starts asynchronous tasks that compute word wrapping for
+		/// the whole document. If word wrapping is disabled, clears all soft linebreaks instead.
+		void _start_wrapping();
+		/// Starts a pass of word wrapping with asynchronous tasks that compute word wrapping for the given
+		/// partitions. Word wrapping must be active, and there must be no ongoing pass.
+		void _start_wrapping_partitions(std::vector<std::pair<std::size_t, std::size_t>>);
+		/// Shifts \ref _interrupted_partitions by the given edit, then restarts word wrapping for them.
+		void _resume_wrapping(const interpretation::end_edit_info&);
+		/// Cancels all tasks of the current pass of word wrapping without waiting for them to finish. Results of
+		/// tasks that finish afterwards are discarded.
+		void _cancel_wrapping();
+		/// Cancels all tasks of the current pass of word wrapping and waits for them to finish. This is used when
+		/// the region is disposed so that no task outlives it; tasks check for cancellation frequently, so this
+		/// does not block for long.
+		void _cancel_wrapping_and_wait();
+		/// Synchronously computes word wrapping for all lines affected by the given edit, and shifts soft
+		/// linebreaks after them.
+		void _rewrap_after_edit(const interpretation::end_edit_info&);
 		/// Adjusts and recalculates caret positions from \ref caret_data::bytepos_first and
 		/// \ref caret_data::bytepos_second, after an edit has been made.
 		///
@@ -870,15 +1050,14 @@ namespace codepad::editors::code {
 		/// Checks if line wrapping needs to be calculated.
 		///
 		/// \todo Recalculate the alignment of cursors.
-		void _check_wrapping_width() { // TODO setting for whether or not word wrapping is enabled
+		void _check_wrapping_width() {
 			double cw = get_client_region().width();
 			if (std::abs(cw - _view_width) > 0.1) { // TODO magik!
 				_view_width = cw;
-				{
-					performance_monitor mon(u8"recalculate_wrapping");
-					_fmt.set_softbreaks(_recalculate_wrapping_region(0, _doc->get_linebreaks().num_chars()));
+				if (_word_wrap) {
+					_start_wrapping();
+					_on_editing_visual_changed();
 				}
-				_on_editing_visual_changed();
 			}
 		}
 		/// Calculates the horizontal position of a caret, and returns the result as a \ref caret_data.
@@ -1000,10 +1179,46 @@ namespace codepad::editors::code {
 			_check_wrapping_width();
 			_base::_on_layout_changed();
 		}
-		/// Renders all visible text.
+		/// Clears \ref _line_layouts, then calls the base class's implementation.
+		void _on_text_theme_changed() override {
+			_line_layouts.clear();
+			_base::_on_text_theme_changed();
+		}
+		/// Calls \ref _check_visible_lines_wrapping() if word wrapping is active, then calls the base class's
+		/// implementation.
+		void _on_prerender() override {
+			if (_doc && _is_wrapping_active()) {
+				_check_visible_lines_wrapping();
+			}
+			_base::_on_prerender();
+		}
+		/// Renders all visible text, using \ref _line_layouts for lines that have not been changed.
 		///
 		/// \todo Cannot deal with very long lines.
 		void _custom_render() const override;
+		/// Lays out the visual line that spans the given range of characters. The line is truncated if it's wider
+		/// than this region.
+		[[nodiscard]] _line_layout _layout_visual_line(std::size_t linebeg, std::size_t nextlinebeg) const;
+		/// Returns the cached layout of the visual line that spans the given range of characters, laying it out
+		/// again if the cached layout does not exist or has been outdated.
+		const _line_layout &_get_line_layout(std::size_t linebeg, std::size_t nextlinebeg) const;
+		/// Removes all entries in \ref _line_layouts that overlap with the given range of characters, or all
+		/// entries if the range is \p std::nullopt.
+		void _discard_line_layouts(std::optional<std::pair<std::size_t, std::size_t>>);
+		/// Clears \ref _line_layouts if the width of this region has changed, since the truncation of long lines
+		/// may have changed.
+		void _check_line_layout_width() const {
+			if (get_layout().width() != _line_layout_width) {
+				_line_layouts.clear();
+				_line_layout_width = get_layout().width();
+			}
+		}
+		/// Returns the width of each character in the given range, obtained from its actual layout.
+		[[nodiscard]] std::vector<double> _measure_characters(std::size_t beg, std::size_t end) const;
+		/// Word wrapping is computed using \ref word_wrapping_metrics, which does not take font styles or shaping
+		/// into account. This function wraps visible lines that have not been checked again using widths obtained
+		/// from their actual layout, and updates soft linebreaks of those that are wrapped differently.
+		void _check_visible_lines_wrapping();
 
 		/// Called when the horizontal or vertical positions of the editor have changed. This function calls
 		/// \ref interaction_manager::on_viewport_changed(), adjusts the position of the tooltip if necessary, and
@@ -1047,8 +1262,9 @@ namespace codepad::editors::code {
 			};
 		}
 
-		/// Unregisters from document events and dispose of \ref _tooltip if necessary.
+		/// Cancels word wrapping, unregisters from document events, and dispose of \ref _tooltip if necessary.
 		void _dispose() override {
+			_cancel_wrapping_and_wait();
 			if (_doc) {
 				_doc->get_buffer().begin_edit -= _begin_edit_tok;
 				_doc->end_modification -= _end_modification_tok;
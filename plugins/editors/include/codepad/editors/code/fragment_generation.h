@@ -7,6 +7,8 @@
 /// Structs used to generate text fragments to be rendered in a \ref codepad::editors::code::contents_region.
 
 #include <tuple>
+#include <list>
+#include <unordered_map>
 
 #include "codepad/editors/buffer.h"
 #include "interpretation.h"
@@ -137,13 +139,13 @@ namespace codepad::editors::code {
 		}
 		/// Implementation of \ref update().
 		template <std::size_t ...Indices> void _update_impl(
-			std::size_t oldpos, std::size_t steps, std::index_sequence<Indices...>
+			[[maybe_unused]] std::size_t oldpos, [[maybe_unused]] std::size_t steps, std::index_sequence<Indices...>
 		) {
 			(..., std::get<Indices>(_components).update(oldpos, steps));
 		}
 		/// Implementation of \ref reposition().
 		template <std::size_t ...Indices> void _reposition_impl(
-			std::size_t position, std::index_sequence<Indices...>
+			[[maybe_unused]] std::size_t position, std::index_sequence<Indices...>
 		) {
 			(..., std::get<Indices>(_components).reposition(position));
 		}
@@ -341,6 +343,114 @@ namespace codepad::editors::code {
 	};
 
 
+	/// A least-recently-used cache of \ref ui::plain_text objects created for \ref text_fragment "text fragments",
+	/// keyed by the text, the font, and the font size. Shaping text is expensive, while most visible text is
+	/// unchanged between frames.
+	class plain_text_cache {
+	public:
+		/// The default maximum number of cached objects.
+		constexpr static std::size_t default_capacity = 4096;
+
+		/// Initializes \ref _capacity.
+		explicit plain_text_cache(std::size_t cap = default_capacity) : _capacity(cap) {
+		}
+
+		/// Returns the \ref ui::plain_text for the given text, font, and font size. If it's not in the cache, it's
+		/// created using \ref ui::renderer_base::create_plain_text() and the least recently used entry is evicted
+		/// if the cache is full.
+		[[nodiscard]] std::shared_ptr<ui::plain_text> get(
+			ui::renderer_base&, std::basic_string_view<codepoint>, const std::shared_ptr<ui::font>&, double size
+		);
+
+		/// Removes all cached objects. This should be called when font settings are changed.
+		void clear() {
+			_lru.clear();
+			_entries.clear();
+		}
+
+		/// Returns the number of cached objects.
+		[[nodiscard]] std::size_t size() const {
+			return _entries.size();
+		}
+		/// Returns the maximum number of cached objects.
+		[[nodiscard]] std::size_t get_capacity() const {
+			return _capacity;
+		}
+	protected:
+		/// A non-owning key used to look up entries without copying the text.
+		struct _key_view {
+			std::basic_string_view<codepoint> text; ///< The text.
+			const ui::font *font = nullptr; ///< The font.
+			double size = 0.0; ///< The font size.
+
+			/// Default equality comparison.
+			friend bool operator==(const _key_view&, const _key_view&) = default;
+		};
+		/// The key of a cache entry.
+		struct _key {
+			std::basic_string<codepoint> text; ///< The text.
+			const ui::font *font = nullptr; ///< The font.
+			double size = 0.0; ///< The font size.
+
+			/// Returns a \ref _key_view that refers to this key.
+			[[nodiscard]] _key_view view() const {
+				return _key_view(text, font, size);
+			}
+		};
+		/// Hash function for \ref _key that also accepts \ref _key_view.
+		struct _key_hash {
+			/// Allows \p std::unordered_map::find() to take \ref _key_view as the key.
+			using is_transparent = void;
+
+			/// Hashes a \ref _key_view.
+			[[nodiscard]] std::size_t operator()(const _key_view &key) const {
+				std::size_t res = std::hash<const ui::font*>()(key.font);
+				res = combine_hashes(res, std::hash<double>()(key.size));
+				for (codepoint cp : key.text) {
+					res = combine_hashes(res, cp);
+				}
+				return res;
+			}
+			/// Hashes a \ref _key.
+			[[nodiscard]] std::size_t operator()(const _key &key) const {
+				return operator()(key.view());
+			}
+		};
+		/// Equality comparison for \ref _key that also accepts \ref _key_view.
+		struct _key_equal {
+			/// Allows \p std::unordered_map::find() to take \ref _key_view as the key.
+			using is_transparent = void;
+
+			/// Compares two keys that are either \ref _key or \ref _key_view.
+			template <typename Lhs, typename Rhs> [[nodiscard]] bool operator()(
+				const Lhs &lhs, const Rhs &rhs
+			) const {
+				return _as_view(lhs) == _as_view(rhs);
+			}
+		protected:
+			/// Returns the given \ref _key_view.
+			[[nodiscard]] inline static const _key_view &_as_view(const _key_view &key) {
+				return key;
+			}
+			/// Converts the given \ref _key into a \ref _key_view.
+			[[nodiscard]] inline static _key_view _as_view(const _key &key) {
+				return key.view();
+			}
+		};
+		/// A cache entry.
+		struct _entry {
+			std::shared_ptr<ui::plain_text> text; ///< The cached object.
+			/// Keeps the font alive, so that its address is not reused by another font while this entry exists.
+			std::shared_ptr<ui::font> font;
+			std::list<const _key*>::iterator lru_position; ///< The position of this entry in \ref _lru.
+		};
+
+		/// All cached entries. References to keys in this map are stable, and are stored in \ref _lru.
+		std::unordered_map<_key, _entry, _key_hash, _key_equal> _entries;
+		std::list<const _key*> _lru; ///< Keys of all entries, with the most recently used ones in the front.
+		std::size_t _capacity = default_capacity; ///< The maximum number of cached objects.
+	};
+
 	/// Used to format, measure, and assemble \ref fragment "fragments".
 	class fragment_assembler {
 	public:
@@ -383,12 +493,16 @@ namespace codepad::editors::code {
 		/// Storage for a single rendering object generated from a fragment.
 		using rendering_storage = std::variant<text_rendering, basic_rendering>;
 
-		/// Initializes the renderer, font, and spacing.
+		/// Initializes the renderer, font, and spacing. If \p cache is not \p nullptr, it's used to avoid shaping
+		/// the same text repeatedly.
 		fragment_assembler(
-			ui::renderer_base &r, const ui::font_family &ff, double sz, double lh, double base, double tabw
-		) : _renderer(&r), _font_family(ff), _font_size(sz), _line_height(lh), _baseline(base), _tab_width(tabw) {
+			ui::renderer_base &r, const ui::font_family &ff, double sz, double lh, double base, double tabw,
+			plain_text_cache *cache = nullptr
+		) :
+			_renderer(&r), _font_family(ff), _text_cache(cache),
+			_font_size(sz), _line_height(lh), _baseline(base), _tab_width(tabw) {
 		}
-		/// Initializes this struct using the given \ref contents_region.
+		/// Initializes this struct using the given \ref contents_region, including its \ref plain_text_cache.
 		fragment_assembler(const contents_region&);
 
 		/// Returns the line height set for this \ref fragment_assembler.
@@ -433,9 +547,11 @@ namespace codepad::editors::code {
 		basic_rendering append(const no_fragment&) {
 			return basic_rendering(get_position(), 0.0);
 		}
-		/// Appends a \ref text_fragment to the rendered document by calling \ref _append_text().
+		/// Appends a \ref text_fragment to the rendered document by calling \ref _append_plain_text().
 		text_rendering append(const text_fragment &frag) {
 			return _append_plain_text(
+				_text_cache ?
+				_text_cache->get(*_renderer, frag.text, frag.font, _font_size) :
 				_renderer->create_plain_text(frag.text, *frag.font, _font_size),
 				*frag.font, _font_size, frag.color
 			);
@@ -461,7 +577,8 @@ namespace codepad::editors::code {
 			return basic_rendering(get_position(), 0.0);
 		}
 
-		/// Appends a \ref text_fragment to the document, taking the fast path for laying out text.
+		/// Appends a \ref text_fragment to the document, taking the fast path for laying out text. This does not
+		/// use the \ref plain_text_cache.
 		text_rendering append_fast(const text_fragment &frag) {
 			return _append_plain_text(
 				_renderer->create_plain_text_fast(frag.text, *frag.font, _font_size),
@@ -482,6 +599,7 @@ namespace codepad::editors::code {
 	protected:
 		ui::renderer_base *_renderer = nullptr; ///< The renderer.
 		const ui::font_family &_font_family; ///< The font family.
+		plain_text_cache *_text_cache = nullptr; ///< Caches shaped text. May be \p nullptr.
 		double
 			_font_size = 0.0, ///< The font size.
 			_line_height = 0.0, ///< The height of a line.
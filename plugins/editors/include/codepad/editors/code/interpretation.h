@@ -477,9 +477,17 @@ namespace codepad::editors::code {
 			/// Initializes \ref type.
 			explicit appearance_changed_info(appearance_change_type t) : type(t) {
 			}
+			/// Initializes all fields of this struct.
+			appearance_changed_info(
+				appearance_change_type t, std::optional<std::pair<std::size_t, std::size_t>> range
+			) : type(t), changed_range(range) {
+			}
 
 			/// Indicates what aspects of this document's appearance may have been affected.
 			const appearance_change_type type = appearance_change_type::visual_only;
+			/// The range of characters whose appearance may have changed, or \p std::nullopt if the appearance of
+			/// the entire document may have changed.
+			const std::optional<std::pair<std::size_t, std::size_t>> changed_range;
 		};
 
 		/// Similar to \ref linebreak_registry::position_converter, but converts between
@@ -948,9 +956,14 @@ namespace codepad::editors::code {
 		void _on_end_edit(buffer::end_edit_info &info) {
 			buffer::edit_positions pos;
 			std::swap(pos, _mod_cache.modification_chars);
+			// modifications are made in order, so all modified characters are within this range
+			std::optional<std::pair<std::size_t, std::size_t>> changed;
+			if (!pos.empty()) {
+				changed.emplace(pos.front().position, pos.back().position + pos.back().added_range);
+			}
 			end_edit.construct_info_and_invoke(std::move(pos), info);
 
-			appearance_changed.construct_info_and_invoke(appearance_change_type::layout_and_visual);
+			appearance_changed.construct_info_and_invoke(appearance_change_type::layout_and_visual, changed);
 		}
 	};
 }
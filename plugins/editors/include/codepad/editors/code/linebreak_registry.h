@@ -344,9 +344,7 @@ namespace codepad::editors::code {
 				// the first line
 				auto it = _t.emplace_before(at, offset + lines[0].nonbreak_chars, lines[0].ending);
 				// insert all other lines
-				for (auto rest_it = lines.begin() + 1; rest_it != lines.end() - 1; ++rest_it) {
-					_t.emplace_before(at, *rest_it);
-				}
+				_t.insert_range_before_copy(at, lines.begin() + 1, lines.end() - 1);
 				result.merge_front = _try_merge_rn_linebreak(it);
 				result.merge_back = _try_merge_rn_linebreak(at);
 			}
@@ -6,10 +6,19 @@
 /// \file
 /// A panel for displaying search results.
 
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <span>
+
 #include <codepad/core/text.h>
+#include <codepad/core/regex/compiler.h>
+#include <codepad/core/regex/matcher.h>
+#include <codepad/ui/elements/button.h>
 #include <codepad/ui/elements/input_prompt.h>
 #include <codepad/ui/elements/list_viewport.h>
 
+#include "buffer_input_stream.h"
 #include "contents_region.h"
 
 namespace codepad::editors::code {
@@ -28,6 +37,21 @@ namespace codepad::editors::code {
 			get_manager().get_scheduler().mark_for_disposal(*this);
 		}
 
+		/// Returns whether the search string is treated as a regular expression.
+		[[nodiscard]] bool is_regex_mode() const {
+			return _regex_mode;
+		}
+		/// Sets whether the search string is treated as a regular expression, and restarts the search.
+		void set_regex_mode(bool enabled) {
+			if (_regex_mode != enabled) {
+				_regex_mode = enabled;
+				_update_regex_indicator();
+				if (_contents) {
+					_on_input_changed();
+				}
+			}
+		}
+
 		/// Sets \ref _contents_region. Also starts the first search.
 		void set_contents_region(contents_region &rgn) {
 			_contents = &rgn;
@@ -37,11 +61,10 @@ namespace codepad::editors::code {
 				std::make_unique<decoration_provider>()
 			);
 			_begin_edit_token = _interpretation->get_buffer().begin_edit += [this](buffer::begin_edit_info&) {
-				_cancel_task();
-				_clear_results();
+				_on_begin_edit();
 			};
-			_end_edit_token = _interpretation->get_buffer().end_edit += [this](buffer::end_edit_info&) {
-				_on_input_changed();
+			_end_edit_token = _interpretation->end_edit += [this](interpretation::end_edit_info &info) {
+				_on_end_edit(info);
 			};
 			_on_input_changed();
 		}
@@ -56,28 +79,106 @@ namespace codepad::editors::code {
 		[[nodiscard]] inline static std::u8string_view get_result_list_name() {
 			return u8"result_list";
 		}
+		/// Returns the name for \ref _regex_toggle.
+		[[nodiscard]] inline static std::u8string_view get_regex_toggle_name() {
+			return u8"regex_toggle";
+		}
+		/// Returns the name for \ref _regex_indicator.
+		[[nodiscard]] inline static std::u8string_view get_regex_indicator_name() {
+			return u8"regex_indicator";
+		}
 		/// Returns the default class of elements of this type.
 		[[nodiscard]] inline static std::u8string_view get_default_class() {
 			return u8"search_panel";
 		}
+
+		/// If the total length of the ranges that need to be searched again after an edit exceeds this value, the
+		/// whole document is searched again instead.
+		constexpr static std::size_t maximum_incremental_search_length = 64 * 1024;
 	protected:
-		/// The matching task.
+		using _regex_data_types = regex::data_types::unoptimized; ///< Data types of compiled regular expressions.
+		/// A compiled regular expression.
+		using _regex_state_machine = regex::compiled<_regex_data_types>::state_machine;
+		/// The type of regular expression matchers.
+		using _regex_matcher = regex::matcher<buffer_input_stream, _regex_data_types>;
+
+		/// State shared by all \ref _match_task objects of a single search.
+		struct _match_context {
+			/// Decodes the given pattern, and prepares for byte-level matching if possible.
+			_match_context(std::u8string_view, const interpretation&, std::size_t num_partitions);
+			/// Initializes this context for a regular expression search, which is performed by a single task.
+			_match_context(_regex_state_machine sm, std::optional<std::size_t> reach) :
+				regex(std::move(sm)), regex_reach(reach), results(1), remaining_partitions(1) {
+			}
+
+			std::basic_string<codepoint> pattern; ///< The decoded search pattern.
+			/// The pattern encoded in UTF-8. This is only used for byte-level matching, and is empty if byte-level
+			/// matching cannot be used. Bytes are stored as <tt>unsigned char</tt>s so that
+			/// \ref std::boyer_moore_horspool_searcher can use a flat table.
+			std::vector<unsigned char> pattern_bytes;
+			/// The searcher for \ref pattern_bytes, if byte-level matching is used.
+			std::optional<std::boyer_moore_horspool_searcher<const unsigned char*>> byte_searcher;
+			/// The regular expression, if this is a regular expression search. \ref pattern is not used in this case.
+			std::optional<_regex_state_machine> regex;
+			/// If this is a regular expression search, this is the maximum number of codepoints that an attempt to
+			/// match at a position may examine on either side of that position. This is \p std::nullopt if matches
+			/// may be arbitrarily long or may depend on text arbitrarily far away.
+			std::optional<std::size_t> regex_reach;
+			/// Results of all partitions, indexed by partition.
+			std::vector<std::vector<std::pair<std::size_t, std::size_t>>> results;
+			std::atomic_size_t remaining_partitions = 0; ///< The number of partitions that have not finished.
+			std::atomic_bool cancelled = false; ///< Used to cancel all tasks.
+		};
+		/// A matching task that finds all matches that start in a range of characters. A document is split into
+		/// multiple ranges that are matched in parallel, and the task that finishes last merges all results.
 		class _match_task : public ui::async_task_base {
 		public:
 			/// Interval between cancellation checks.
 			constexpr static std::size_t cancellation_check_interval = 100000;
+			/// The minimum number of characters in a partition.
+			constexpr static std::size_t minimum_partition_length = 1024 * 1024;
+			/// When matching regular expressions, results are sent to the panel when this many are found.
+			constexpr static std::size_t result_batch_size = 1000;
+			/// When matching regular expressions, results are sent to the panel when this much time has passed since
+			/// the last batch.
+			constexpr static std::chrono::milliseconds result_batch_interval{ 100 };
 
 			/// Initializes all fields of this task.
-			_match_task(std::u8string patt, search_panel &p) : _pattern(std::move(patt)), _parent(p) {
+			_match_task(
+				std::shared_ptr<_match_context> ctx, std::size_t part, std::size_t beg, std::size_t end,
+				search_panel &p
+			) : _context(std::move(ctx)), _partition(part), _begin(beg), _end(end), _parent(p) {
 			}
 
-			/// Finds all matches in the document.
+			/// Finds all matches in the partition.
 			status execute() override;
-
-			std::atomic_bool cancelled = false; ///< Used to cancel this task.
+			/// Finds all matches of \ref _match_context::pattern in the partition and appends them to the given
+			/// vector. The caller is responsible for making sure that the buffer is not modified in the meantime.
+			///
+			/// \return \p false if the task has been cancelled.
+			bool find_matches(std::vector<std::pair<std::size_t, std::size_t>> &results) {
+				return _context->byte_searcher ? _match_bytes(results) : _match_characters(results);
+			}
 		protected:
-			std::u8string _pattern; ///< The search pattern.
+			std::shared_ptr<_match_context> _context; ///< State shared by all tasks of this search.
+			std::size_t
+				_partition = 0, ///< The index of this partition.
+				_begin = 0, ///< The first character of this partition.
+				_end = 0; ///< The character after the last character of this partition.
 			search_panel &_parent; ///< The panel that created this task.
+
+			/// Finds matches by decoding all characters and feeding them to a \ref kmp_matcher.
+			///
+			/// \return \p false if the task has been cancelled.
+			bool _match_characters(std::vector<std::pair<std::size_t, std::size_t>>&);
+			/// Finds matches by searching for \ref _match_context::pattern_bytes in the raw contents of the buffer.
+			/// This is only valid for UTF-8 documents.
+			///
+			/// \return \p false if the task has been cancelled.
+			bool _match_bytes(std::vector<std::pair<std::size_t, std::size_t>>&);
+			/// Finds all matches of \ref _match_context::regex in the document, sending results to the panel in
+			/// batches as they're found.
+			status _match_regex();
 		};
 		/// An item source containing all match results.
 		class _match_result_source : public ui::virtual_list_viewport::item_source {
@@ -108,9 +209,11 @@ namespace codepad::editors::code {
 			search_panel *_parent = nullptr; ///< The associated \ref search_panel.
 		};
 
-		ui::async_task_scheduler::token<_match_task> _task_token; ///< Token for the asynchronous task.
-		/// Token of the callback function containing match results.
-		ui::scheduler::callback_token _task_result_token;
+		/// Tokens for all asynchronous tasks of the current search.
+		std::vector<ui::async_task_scheduler::token<_match_task>> _task_tokens;
+		/// State of the current search. This is kept after the search has finished so that results can be updated
+		/// after edits.
+		std::shared_ptr<_match_context> _match;
 
 		std::vector<std::pair<std::size_t, std::size_t>> _results; ///< Current results.
 		/// Token for the decoration provider.
@@ -118,10 +221,18 @@ namespace codepad::editors::code {
 		/// Used to listen to \ref interpretation::begin_edit.
 		info_event<buffer::begin_edit_info>::token _begin_edit_token;
 		/// Used to listen to \ref interpretation::end_edit.
-		info_event<buffer::end_edit_info>::token _end_edit_token;
+		info_event<interpretation::end_edit_info>::token _end_edit_token;
 
 		ui::virtual_list_viewport *_result_list = nullptr; ///< The list of results.
+		ui::button *_regex_toggle = nullptr; ///< The button used to toggle \ref _regex_mode.
+		/// An element that's only visible when \ref _regex_mode is enabled.
+		element *_regex_indicator = nullptr;
 		contents_region *_contents = nullptr; ///< The \ref contents_region associated with this panel.
+		bool
+			_regex_mode = false, ///< Whether the search string is treated as a regular expression.
+			/// Whether some results of the current search have not been received yet. If the document is modified
+			/// in the meantime, the search is restarted.
+			_searching = false;
 		/// Keeps the interpretation alive until events are properly unregistered.
 		std::shared_ptr<interpretation> _interpretation;
 
@@ -129,13 +240,41 @@ namespace codepad::editors::code {
 		void _on_input_changed() override;
 		/// Called by \ref _match_task to update the results.
 		void _update_results(std::vector<std::pair<std::size_t, std::size_t>>);
+		/// Called by \ref _match_task to append results that come after all existing results.
+		void _append_results(const std::vector<std::pair<std::size_t, std::size_t>>&);
+		/// Adds decorations for the given results.
+		void _add_decorations(std::span<const std::pair<std::size_t, std::size_t>>);
+		/// Cancels the search if it's still ongoing.
+		void _on_begin_edit();
+		/// Updates the results after an edit. Results that overlap with modified ranges are removed and others are
+		/// shifted, then only the regions around modified ranges are searched again. Regular expression searches
+		/// are only updated this way if \ref _match_context::regex_reach is known; otherwise they are restarted.
+		void _on_end_edit(interpretation::end_edit_info&);
+		/// Updates the results of a regular expression search with a known \ref _match_context::regex_reach after
+		/// an edit. Matching is resumed before each modified range, and stops once the new matches line up with
+		/// the old ones again.
+		///
+		/// \return \p false if too much text would need to be searched again, in which case nothing is modified.
+		bool _update_regex_results(interpretation::end_edit_info&);
+		/// Compiles the given regular expression and creates a \ref _match_context for it. Errors are logged.
+		///
+		/// \return The context, or \p nullptr if the expression contains errors.
+		[[nodiscard]] static std::shared_ptr<_match_context> _compile_regex(std::u8string_view);
 
+		/// Shows or hides \ref _regex_indicator depending on \ref _regex_mode.
+		void _update_regex_indicator() {
+			if (_regex_indicator) {
+				_regex_indicator->set_visibility(
+					_regex_mode ? ui::visibility::visual | ui::visibility::layout : ui::visibility::none
+				);
+			}
+		}
 		/// Clears the current match results.
 		void _clear_results();
-		/// Cancels the match task.
+		/// Cancels all match tasks. This does not reset \ref _searching.
 		void _cancel_task();
 
-		/// Handles \p result_list.
+		/// Handles \p result_list, \p regex_toggle, and \p regex_indicator.
 		bool _handle_reference(std::u8string_view name, element *e) override {
 			if (name == get_result_list_name()) {
 				if (_reference_cast_to(_result_list, e)) {
@@ -144,6 +283,19 @@ namespace codepad::editors::code {
 				}
 				return true;
 			}
+			if (name == get_regex_toggle_name()) {
+				if (_reference_cast_to(_regex_toggle, e)) {
+					_regex_toggle->click += [this]() {
+						set_regex_mode(!_regex_mode);
+					};
+				}
+				return true;
+			}
+			if (name == get_regex_indicator_name()) {
+				_regex_indicator = e;
+				_update_regex_indicator();
+				return true;
+			}
 			return input_prompt::_handle_reference(name, e);
 		}
 
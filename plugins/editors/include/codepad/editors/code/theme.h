@@ -7,6 +7,7 @@
 /// Classes used to record and manage font color, style, etc. in a \ref codepad::editors::code::interpretation.
 
 #include <deque>
+#include <optional>
 
 #include <codepad/core/red_black_tree.h>
 #include <codepad/ui/renderer.h>
@@ -81,9 +82,20 @@ namespace codepad::editors::code {
 		public:
 			/// No copy construction.
 			provider_modifier(const provider_modifier&) = delete;
-			/// Invokes \ref interpretation::appearance_changed.
+			/// Invokes \ref interpretation::appearance_changed with the range reported using \ref mark_changed().
 			~provider_modifier();
 
+			/// Reports that the theme of the given range of characters may have changed. If this is never called,
+			/// the theme of the entire document is assumed to have changed.
+			void mark_changed(std::size_t beg, std::size_t end) {
+				if (_changed_range) {
+					_changed_range->first = std::min(_changed_range->first, beg);
+					_changed_range->second = std::max(_changed_range->second, end);
+				} else {
+					_changed_range.emplace(beg, end);
+				}
+			}
+
 			/// Used to access the \ref document_theme.
 			[[nodiscard]] document_theme *operator->() const {
 				return &_data;
@@ -93,6 +105,8 @@ namespace codepad::editors::code {
 				return _data;
 			}
 		protected:
+			/// The smallest range that contains all ranges reported using \ref mark_changed().
+			std::optional<std::pair<std::size_t, std::size_t>> _changed_range;
 			interpretation &_interp; ///< The associated \ref interpretation.
 			document_theme &_data; ///< The associated \ref document_theme.
 
@@ -201,6 +201,37 @@ namespace codepad::editors::code {
 			}
 		}
 
+		/// Replaces the soft linebreaks in a range of characters. All soft linebreaks strictly between \p beg and
+		/// \p old_end are removed, and those after \p old_end are shifted by <tt>new_end - old_end</tt>. This is
+		/// used both when the range has been modified to end at \p new_end, and when the range has been wrapped
+		/// again in which case \p new_end is the same as \p old_end.
+		///
+		/// \param poss The new list of soft linebreaks' positions, sorted in increasing order. All positions must be
+		///             strictly between \p beg and \p new_end.
+		void replace_softbreaks(
+			std::size_t beg, std::size_t old_end, std::size_t new_end, const std::vector<std::size_t> &poss
+		) {
+			softbreak_info info = get_softbreak_before_or_at_char(beg);
+			std::size_t last = info.prev_chars; // position of the last soft linebreak that's kept
+			// find the first soft linebreak that's at or after old_end
+			iterator erase_end = info.entry;
+			std::size_t pos = last;
+			for (; erase_end != _t.end() && pos + erase_end->length < old_end; ++erase_end) {
+				pos += erase_end->length;
+			}
+			std::size_t next = erase_end == _t.end() ? 0 : pos + erase_end->length;
+			_t.erase(info.entry, erase_end);
+
+			for (std::size_t cp : poss) {
+				assert_true_usage(cp > last && cp > beg && cp < new_end, "invalid softbreak position");
+				_t.emplace_before(erase_end, cp - last);
+				last = cp;
+			}
+			if (erase_end != _t.end()) {
+				_t.get_modifier_for(erase_end.get_node())->length = next + new_end - old_end - last;
+			}
+		}
+
 		/// Returns the total number of soft linebreaks.
 		std::size_t num_softbreaks() const {
 			return _t.root() ? _t.root()->synth_data.total_softbreaks : 0;
@@ -829,6 +860,17 @@ namespace codepad::editors::code {
 	public:
 		using fold_region = std::pair<std::size_t, std::size_t>; ///< Contains information about a folded region.
 
+		/// A range of characters whose soft linebreaks are replaced.
+		///
+		/// \sa soft_linebreak_registry::replace_softbreaks()
+		struct softbreak_replacement {
+			std::size_t
+				begin = 0, ///< The beginning of the range.
+				old_end = 0, ///< The end of the range before replacement.
+				new_end = 0; ///< The end of the range after replacement.
+			std::vector<std::size_t> softbreaks; ///< New soft linebreaks in the range.
+		};
+
 		/// Default constructor.
 		view_formatting() = default;
 		/// Initializes \ref _lbr with the given \ref linebreak_registry.
@@ -848,6 +890,23 @@ namespace codepad::editors::code {
 			_lbr.clear_softbreaks();
 			recalc_foldreg_lines();
 		}
+		/// Replaces the soft linebreaks of this view in a range of characters.
+		///
+		/// \sa soft_linebreak_registry::replace_softbreaks()
+		void replace_softbreaks(
+			std::size_t beg, std::size_t old_end, std::size_t new_end, const std::vector<std::size_t> &breaks
+		) {
+			_lbr.replace_softbreaks(beg, old_end, new_end, breaks);
+			recalc_foldreg_lines();
+		}
+		/// Replaces the soft linebreaks of this view in multiple ranges of characters, which are processed in
+		/// order. Positions of each range should take into account the shifting caused by all previous ranges.
+		void replace_softbreaks(const std::vector<softbreak_replacement> &reps) {
+			for (const softbreak_replacement &rep : reps) {
+				_lbr.replace_softbreaks(rep.begin, rep.old_end, rep.new_end, rep.softbreaks);
+			}
+			recalc_foldreg_lines();
+		}
 
 		/// Folds the given region.
 		///
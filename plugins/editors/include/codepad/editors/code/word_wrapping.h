@@ -0,0 +1,101 @@
+// Copyright (c) the Codepad contributors. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+/// \file
+/// Computation of word wrapping.
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <codepad/core/unicode/common.h>
+#include <codepad/ui/renderer.h>
+
+#include "interpretation.h"
+
+namespace codepad::editors::code {
+	/// Character widths used to compute word wrapping. Fonts cannot be used from threads other than the main thread,
+	/// so all widths are measured when this object is created, after which it can be used from any thread. Widths
+	/// of characters are measured using fonts with the normal style and weight. Characters that have not been
+	/// measured are assumed to be as wide as \p M, or as an ideograph for East Asian wide characters, so that
+	/// the wrapped text is more likely to be narrower than the region than wider. Visible lines are wrapped again by
+	/// \ref contents_region using widths obtained from their actual layout.
+	class word_wrapping_metrics {
+	public:
+		/// The number of characters between two checks of the cancellation flag. Edits wait for cancelled tasks to
+		/// release the buffer, so this is kept small.
+		constexpr static std::size_t cancellation_check_interval = 4096;
+		/// Codepoints below this value are measured individually.
+		constexpr static codepoint measured_codepoints = 0x800;
+
+		/// Parameters that determine where lines are wrapped, apart from the character widths.
+		struct parameters {
+			double
+				width = 0.0, ///< The maximum width of a line.
+				font_size = 0.0, ///< The font size.
+				tab_width = 0.0; ///< The maximum absolute width of a tab character.
+		};
+
+		/// Measures all characters using the given font families. Font families in the back are backups for font
+		/// families in front.
+		explicit word_wrapping_metrics(const std::vector<std::shared_ptr<ui::font_family>>&);
+
+		/// Returns the width of the given codepoint in EM units.
+		[[nodiscard]] double get_character_width_em(codepoint cp) const {
+			if (cp < _widths.size()) {
+				return _widths[cp];
+			}
+			return is_wide_character(cp) ? _wide_width : _fallback_width;
+		}
+		/// Returns the width of the gizmo of the given invalid codepoint in EM units. The gizmo contains the
+		/// hexadecimal value of the codepoint, as formatted by \ref contents_region::format_invalid_codepoint().
+		[[nodiscard]] double get_invalid_codepoint_width_em(codepoint) const;
+
+		/// Computes all positions in the given range of characters where soft linebreaks should be inserted. The
+		/// caller is responsible for making sure that the buffer is not modified in the meantime. Folded regions
+		/// are not taken into account. The range should start at the beginning of a line.
+		///
+		/// \return Positions of soft linebreaks in increasing order, all of which are strictly between \p beg and
+		///         \p end, or \p std::nullopt if the computation has been cancelled.
+		[[nodiscard]] std::optional<std::vector<std::size_t>> compute_softbreaks(
+			const interpretation&, std::size_t beg, std::size_t end, const parameters&,
+			const std::atomic_bool *cancelled = nullptr
+		) const;
+		/// Similar to \ref compute_softbreaks(), but uses the given widths of characters instead of measured ones.
+		/// This is used to wrap lines according to their actual layout, which takes font styles and shaping into
+		/// account. Widths of tab characters are computed from \ref parameters::tab_width instead.
+		///
+		/// \param beg The first character of the range, which should be at the beginning of a line.
+		/// \param widths The width of each character in the range, in pixels. The range ends after the last one.
+		[[nodiscard]] static std::vector<std::size_t> compute_softbreaks_with_widths(
+			const interpretation&, std::size_t beg, const std::vector<double> &widths, const parameters&
+		);
+
+		/// Returns whether lines can be wrapped after the given character.
+		[[nodiscard]] inline static bool is_whitespace(codepoint cp) {
+			return cp == U' ' || cp == U'\t' || cp == 0x3000;
+		}
+		/// Returns whether the given character is an East Asian wide character. Lines can be wrapped before these
+		/// characters. Only the most common ranges are included.
+		[[nodiscard]] inline static bool is_wide_character(codepoint cp) {
+			return
+				(cp >= 0x1100 && cp < 0x1160) || // Hangul Jamo
+				(cp >= 0x2E80 && cp < 0xA4D0) || // CJK radicals, symbols, kana, ideographs, Yi
+				(cp >= 0xAC00 && cp < 0xD7A4) || // Hangul syllables
+				(cp >= 0xF900 && cp < 0xFB00) || // CJK compatibility ideographs
+				(cp >= 0xFE30 && cp < 0xFE50) || // CJK compatibility forms
+				(cp >= 0xFF00 && cp < 0xFF61) || // fullwidth forms
+				(cp >= 0xFFE0 && cp < 0xFFE7) || // fullwidth signs
+				(cp >= 0x20000 && cp < 0x3FFFE); // supplementary ideographic planes
+		}
+	protected:
+		std::vector<double> _widths; ///< Widths of all codepoints below \ref measured_codepoints.
+		double
+			_wide_width = 0.0, ///< The width of East Asian wide characters.
+			_fallback_width = 0.0, ///< The width of all other characters that have not been measured.
+			_hex_digit_width = 0.0; ///< The maximum width of hexadecimal digits.
+	};
+}
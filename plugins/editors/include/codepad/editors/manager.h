@@ -50,6 +50,18 @@ namespace codepad::editors {
 					return result;
 				}
 			);
+			_file_load_mode = man.get_settings().create_retriever_parser<file_load_mode>(
+				{ u8"editor", u8"file_load_mode" }, [](std::optional<json::storage::value_t> val) {
+					if (val) {
+						if (auto str = val->cast<std::u8string_view>()) {
+							if (str.value() == u8"memory_mapped") {
+								return file_load_mode::memory_mapped;
+							}
+						}
+					}
+					return file_load_mode::read;
+				}
+			);
 		}
 
 		/// Registers built-in interaction modes.
@@ -110,6 +122,10 @@ namespace codepad::editors {
 			}
 			return nullptr;
 		}
+		/// Returns the \ref file_load_mode used when opening files.
+		[[nodiscard]] file_load_mode get_file_load_mode() const {
+			return _file_load_mode->get_main_profile().get_value();
+		}
 
 
 		buffer_manager buffers; ///< Manager of all buffers.
@@ -126,5 +142,7 @@ namespace codepad::editors {
 		std::unique_ptr<settings::retriever_parser<
 			std::vector<std::pair<std::regex, std::vector<std::u8string>>>
 		>> _language_mapping;
+		/// Determines how files are loaded into \ref buffer "buffers".
+		std::unique_ptr<settings::retriever_parser<file_load_mode>> _file_load_mode;
 	};
 }
@@ -6,6 +6,8 @@
 /// \file
 /// Class used to manage a series of ranges that may overlap one another.
 
+#include <vector>
+
 #include <codepad/core/red_black_tree.h>
 
 namespace codepad::editors {
@@ -174,6 +176,77 @@ namespace codepad::editors {
 				_get_modifier_for(iter)->offset += offset;
 			}
 		}
+		/// Erases all ranges that are fully contained by the given range.
+		void erase_ranges_within(std::size_t begin, std::size_t past_end) {
+			iterator_position it = _find(_position_finder(), begin);
+			while (it._iter != _ranges.end()) {
+				std::size_t start = it.get_range_start();
+				if (start > past_end) {
+					break;
+				}
+				if (start + it._iter->length <= past_end) {
+					std::size_t offset = it._iter->offset;
+					it._iter = _ranges.erase(it._iter);
+					if (it._iter != _ranges.end()) {
+						_get_modifier_for(it._iter)->offset += offset;
+					}
+				} else {
+					it.move_next();
+				}
+			}
+		}
+		/// Erases all ranges that intersect with the given range, including those that only partially overlap it.
+		///
+		/// \return The smallest range that contains the given range and all erased ranges.
+		std::pair<std::size_t, std::size_t> erase_ranges_overlapping(std::size_t begin, std::size_t past_end) {
+			std::pair<std::size_t, std::size_t> extent(begin, past_end);
+			while (true) {
+				// all ranges before this one end at or before `begin`, and all ranges after it start at or after it
+				iterator_position it = _find(_extent_finder_exclusive(), begin);
+				if (it._iter == _ranges.end()) {
+					break;
+				}
+				std::size_t start = it.get_range_start();
+				if (start >= past_end) {
+					break;
+				}
+				extent.first = std::min(extent.first, start);
+				extent.second = std::max(extent.second, start + it._iter->length);
+				erase(it._iter);
+			}
+			return extent;
+		}
+		/// Erases the parts of all ranges that intersect with the given range. Ranges that only partially overlap
+		/// it are clipped to the parts outside of it, which keep their values.
+		///
+		/// \return The smallest range that contains the given range and all erased or clipped ranges.
+		std::pair<std::size_t, std::size_t> clip_ranges_overlapping(std::size_t begin, std::size_t past_end) {
+			std::pair<std::size_t, std::size_t> extent(begin, past_end);
+			std::vector<std::pair<std::size_t, range_data>> remaining; // parts outside of the given range
+			while (true) {
+				iterator_position it = _find(_extent_finder_exclusive(), begin);
+				if (it._iter == _ranges.end()) {
+					break;
+				}
+				std::size_t start = it.get_range_start(), end = start + it._iter->length;
+				if (start >= past_end) {
+					break;
+				}
+				if (start < begin) {
+					remaining.emplace_back(start, range_data(it._iter->value, 0, begin - start));
+				}
+				if (end > past_end) {
+					remaining.emplace_back(past_end, range_data(it._iter->value, 0, end - past_end));
+				}
+				extent.first = std::min(extent.first, start);
+				extent.second = std::max(extent.second, end);
+				erase(it._iter);
+			}
+			for (auto &[start, data] : remaining) {
+				insert_range_after(start, data.length, std::move(data.value));
+			}
+			return extent;
+		}
 		/// Erases all ranges.
 		void clear() {
 			_ranges.clear();
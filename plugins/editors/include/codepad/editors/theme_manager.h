@@ -106,25 +106,13 @@ namespace codepad::editors {
 	/// Manages theme data.
 	class theme_manager {
 	public:
-		/// Initializes \ref _setting using the given \ref ui::manager.
+		/// Initializes \ref _setting and \ref _manager using the given \ref ui::manager.
 		explicit theme_manager(ui::manager&);
 
-		/// Returns a \ref theme_configuration for the given language.
-		[[nodiscard]] const std::shared_ptr<theme_configuration> &get_theme_for_language(
-			std::u8string_view lang
-		) {
-			auto [it, inserted] = _themes.emplace(lang, nullptr);
-			if (inserted) {
-				std::vector<std::u8string_view> profile;
-				split_string(U'.', lang, [&profile](std::u8string_view s) {
-					profile.emplace_back(s);
-				});
-				it->second = std::make_shared<theme_configuration>(
-					_setting->get_value(profile.begin(), profile.end())
-				);
-			}
-			return it->second;
-		}
+		/// Returns a \ref theme_configuration for the given language. The returned object is cached and shared
+		/// until settings are changed, after which a new object is created; callers can therefore compare the
+		/// returned pointer with a previous one to check whether the theme has changed.
+		[[nodiscard]] std::shared_ptr<theme_configuration> get_theme_for_language(std::u8string_view lang);
 	protected:
 		/// All cached theme data.
 		std::unordered_map<
@@ -132,5 +120,8 @@ namespace codepad::editors {
 		> _themes;
 		/// Used to retrieve and parse configuration values.
 		std::unique_ptr<settings::retriever_parser<theme_configuration>> _setting;
+		ui::manager &_manager; ///< The associated \ref ui::manager.
+		/// The value of \ref settings::get_timestamp() when \ref _themes was last cleared.
+		std::size_t _timestamp = 0;
 	};
 }
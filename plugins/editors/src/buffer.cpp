@@ -22,7 +22,7 @@ namespace codepad::editors {
 			_buf._erase(posit, endit);
 		}
 		if (!insert.empty()) {
-			_buf._insert(_buf.at(pos), insert.begin(), insert.end());
+			_buf._insert(_buf.at(pos), insert.data(), insert.data() + insert.size());
 			mod.added_content = std::move(insert);
 		}
 		_buf.end_modify.construct_info_and_invoke(pos, mod.removed_content, mod.added_content);
@@ -38,7 +38,9 @@ namespace codepad::editors {
 			_buf._erase(_buf.at(pos), _buf.at(pos + mod.added_content.size()));
 		}
 		if (!mod.removed_content.empty()) {
-			_buf._insert(_buf.at(pos), mod.removed_content.begin(), mod.removed_content.end());
+			_buf._insert(
+				_buf.at(pos), mod.removed_content.data(), mod.removed_content.data() + mod.removed_content.size()
+			);
 		}
 		_buf.end_modify.construct_info_and_invoke(pos, mod.added_content, mod.removed_content);
 		_diff += mod.removed_content.size() - mod.added_content.size();
@@ -52,7 +54,9 @@ namespace codepad::editors {
 			_buf._erase(_buf.at(mod.position), _buf.at(mod.position + mod.removed_content.size()));
 		}
 		if (!mod.added_content.empty()) {
-			_buf._insert(_buf.at(mod.position), mod.added_content.begin(), mod.added_content.end());
+			_buf._insert(
+				_buf.at(mod.position), mod.added_content.data(), mod.added_content.data() + mod.added_content.size()
+			);
 		}
 		_buf.end_modify.construct_info_and_invoke(mod.position, mod.removed_content, mod.added_content);
 		_diff += mod.added_content.size() - mod.removed_content.size();
@@ -60,24 +64,66 @@ namespace codepad::editors {
 	}
 
 
-	buffer::buffer(const std::filesystem::path &filename, buffer_manager &man) :
+	buffer::buffer(const std::filesystem::path &filename, buffer_manager &man, file_load_mode mode) :
 		_fileid(std::in_place_type<std::filesystem::path>, filename), _buf_manager(man) {
 
 		performance_monitor mon(u8"load file", performance_monitor::log_condition::always);
 
 		logger::get().log_debug() << "opening file " << filename;
 
-		// read version
+		if (mode == file_load_mode::memory_mapped) {
+			if (_load_file_mapped(filename)) {
+				return;
+			}
+			logger::get().log_warning() << "failed to map file " << filename << ", reading it instead";
+		}
+		_load_file_read(filename);
+	}
+
+	bool buffer::_load_file_mapped(const std::filesystem::path &filename) {
+		auto f = os::file::open(filename, os::access_rights::read, os::open_mode::open);
+		if (!f) {
+			return false;
+		}
+		auto size = f->get_size();
+		if (!size) {
+			return false;
+		}
+		auto length = static_cast<std::size_t>(size.value());
+		if (length == 0) { // empty files cannot be mapped
+			return true;
+		}
+		auto mapping = f->map(os::access_rights::read);
+		if (!mapping) {
+			return false;
+		}
+		// the mapping is kept alive by the chunks that point into it
+		auto shared_mapping = std::make_shared<const os::file_mapping>(std::move(mapping.value()));
+		const auto *ptr = static_cast<const std::byte*>(shared_mapping->get_mapped_pointer());
+		const std::byte *end = ptr + length;
+		std::vector<chunk_data> chunks;
+		chunks.reserve((length + maximum_bytes_per_chunk - 1) / maximum_bytes_per_chunk);
+		for (; ptr < end; ptr += maximum_bytes_per_chunk) {
+			chunks.emplace_back(
+				ptr, ptr + std::min<std::size_t>(maximum_bytes_per_chunk, static_cast<std::size_t>(end - ptr)),
+				shared_mapping
+			);
+		}
+		_t.insert_range_before_move(_t.end(), chunks.begin(), chunks.end());
+		return true;
+	}
+
+	void buffer::_load_file_read(const std::filesystem::path &filename) {
 		if (auto f = os::file::open(filename, os::access_rights::read, os::open_mode::open)) {
 			std::vector<chunk_data> chunks;
 			while (true) {
-				auto &chk = chunks.emplace_back();
-				chk.data.resize(maximum_bytes_per_chunk);
-				if (auto res = f->read(maximum_bytes_per_chunk, chk.data.data())) {
+				byte_array &chk = chunks.emplace_back().get_mutable_data();
+				chk.resize(maximum_bytes_per_chunk);
+				if (auto res = f->read(maximum_bytes_per_chunk, chk.data())) {
 					auto bytes_read = static_cast<std::size_t>(res.value());
 					if (bytes_read < maximum_bytes_per_chunk) {
 						if (bytes_read > 0) {
-							chk.data.resize(bytes_read);
+							chk.resize(bytes_read);
 						} else {
 							chunks.pop_back();
 						}
@@ -85,10 +131,7 @@ namespace codepad::editors {
 					}
 				} // TODO read() failed
 			}
-			// TODO build the tree directly
-			for (chunk_data &cd : chunks) {
-				_t.emplace_before(_t.end(), std::move(cd));
-			}
+			_t.insert_range_before_move(_t.end(), chunks.begin(), chunks.end());
 		} // TODO failed to open file
 
 		/*// STL version
@@ -109,32 +152,6 @@ namespace codepad::editors {
 				_t.insert_range_before_move(_t.end(), chunks.begin(), chunks.end());
 			} // TODO failed to read file
 		} // TODO failed to open file*/
-
-		/*
-		// memory-mapped version
-		// about 30% faster than STL version
-		os::file f(filename, os::access_rights::read, os::open_mode::open);
-		if (f.valid()) {
-			os::file_mapping mp(f, os::access_rights::read);
-			if (mp.valid()) {
-				const std::byte
-					*ptr = static_cast<const std::byte*>(mp.get_mapped_pointer()),
-					*end = ptr + f.get_size();
-				std::vector<chunk_data> chunks;
-				for (
-					const std::byte *next = ptr + maximum_bytes_per_chunk;
-					next < end;
-					ptr = next, next += maximum_bytes_per_chunk
-					) {
-					chunks.emplace_back(ptr, next);
-				}
-				chunks.emplace_back(ptr, end);
-				_t.insert_range_before_move(_t.end(), chunks.begin(), chunks.end());
-			}
-			// TODO failed to map file
-		}
-		// TODO failed to open file
-		*/
 	}
 
 	buffer::~buffer() {
@@ -145,9 +162,9 @@ namespace codepad::editors {
 		std::size_t chkpos = bytepos;
 		auto t = _t.find(_byte_index_finder(), chkpos);
 		if (t == _t.end()) {
-			return const_iterator(t, byte_array::const_iterator(), length());
+			return const_iterator(t, nullptr, length());
 		}
-		return const_iterator(t, t->data.begin() + chkpos, bytepos - chkpos);
+		return const_iterator(t, t->begin() + chkpos, bytepos - chkpos);
 	}
 
 	byte_string buffer::get_clip(const const_iterator &beg, const const_iterator &end) const {
@@ -157,70 +174,146 @@ namespace codepad::editors {
 		if (beg._it == end._it) { // in the same chunk
 			return byte_string(beg._s, end._s);
 		}
-		byte_string result(beg._s, beg._it->data.end()); // insert the part in the first chunk
+		byte_string result(beg._s, beg._it->end()); // insert the part in the first chunk
 		tree_type::const_iterator it = beg._it;
 		for (++it; it != end._it; ++it) { // insert full chunks
-			result.append(it->data.begin(), it->data.end());
+			result.append(it->begin(), it->end());
 		}
 		if (end._it != _t.end()) {
-			result.append(end._it->data.begin(), end._s); // insert the part in the last chunk
+			result.append(end._it->begin(), end._s); // insert the part in the last chunk
 		}
 		return result;
 	}
 
+	std::pair<const std::byte*, const std::byte*> buffer::chunk_reader::read(std::size_t pos) {
+		if (_it != _buf->_t.end() && pos >= _chunk_begin + _it->size()) { // try the next chunk first
+			_chunk_begin += _it->size();
+			++_it;
+		}
+		if (_it == _buf->_t.end() || pos < _chunk_begin || pos >= _chunk_begin + _it->size()) {
+			if (pos >= _buf->length()) {
+				return { nullptr, nullptr };
+			}
+			std::size_t chkpos = pos;
+			_it = _buf->_t.find(_byte_index_finder(), chkpos);
+			_chunk_begin = pos - chkpos;
+		}
+		return { _it->begin() + (pos - _chunk_begin), _it->end() };
+	}
+
 	void buffer::_erase(const_iterator beg, const_iterator end) {
 		if (beg._it == _t.end()) {
 			return;
 		}
 		if (beg._it == end._it) { // same chunk
-			_t.get_modifier_for(beg._it.get_node())->data.erase(beg._s, end._s);
+			_t.get_modifier_for(beg._it.get_node())->erase(
+				beg._get_offset_in_chunk(), end._get_offset_in_chunk()
+			);
 			_try_merge_small_nodes(beg._it);
 			return;
 		}
 		// erase full chunks
-		if (beg._s == beg._it->data.begin()) { // the first chunk is fully deleted
+		if (beg._s == beg._it->begin()) { // the first chunk is fully deleted
 			_t.erase(beg._it, end._it);
 		} else {
 			tree_type::const_iterator erase_beg = beg._it;
 			++erase_beg;
 			_t.erase(erase_beg, end._it);
 			// erase the part in the first chunk
-			_t.get_modifier_for(beg._it.get_node())->data.erase(beg._s, beg._it->data.end());
+			_t.get_modifier_for(beg._it.get_node())->erase(beg._get_offset_in_chunk(), beg._it->size());
 		}
 		if (end._it != _t.end()) {
 			// erase the part in the last chunk
-			_t.get_modifier_for(end._it.get_node())->data.erase(end._it->data.begin(), end._s);
+			_t.get_modifier_for(end._it.get_node())->erase(0, end._get_offset_in_chunk());
 			_try_merge_small_nodes(end._it);
 		} else if (!_t.empty()) {
 			_try_merge_small_nodes(--_t.end());
 		}
 	}
 
+	void buffer::_insert(const_iterator pos, const std::byte *beg, const std::byte *end) {
+		if (beg == end) {
+			return;
+		}
+		tree_type::const_iterator insit = pos._it, updit = insit;
+		chunk_data afterstr;
+		byte_array *curstr = nullptr;
+		if (pos == begin()) { // insert at the very beginning, no need to split or update
+			updit = _t.end();
+		} else if (pos._it == _t.end() || pos._s == pos._it->begin()) {
+			// insert at the beginning of a chunk, which is not the first chunk
+			--updit;
+			// don't touch the previous chunk if it's full, as it may still be mapped
+			if (updit->size() < maximum_bytes_per_chunk) {
+				curstr = &updit.get_value_rawmod().get_mutable_data();
+			}
+		} else { // insert at the middle of a chunk
+			// save the second part & truncate the chunk
+			afterstr = pos._it.get_value_rawmod().split(pos._get_offset_in_chunk());
+			++insit;
+			curstr = &updit.get_value_rawmod().get_mutable_data();
+		}
+		if (curstr) { // fill the chunk before the insertion point
+			std::size_t count = std::min(
+				maximum_bytes_per_chunk - curstr->size(), static_cast<std::size_t>(end - beg)
+			);
+			curstr->insert(curstr->end(), beg, beg + count);
+			beg += count;
+			// all bytes fit into that chunk; try to append the second part to it as well
+			if (beg == end && curstr->size() + afterstr.size() <= maximum_bytes_per_chunk) {
+				curstr->insert(curstr->end(), afterstr.begin(), afterstr.end());
+				afterstr = chunk_data();
+			}
+		}
+		_t.refresh_synthesized_result(updit.get_node()); // this function checks if updit is end
+
+		const std::byte *suffix_beg = nullptr, *suffix_end = nullptr;
+		if (afterstr.size() > 0) {
+			std::size_t last_chunk_size = 0;
+			if (beg != end) {
+				last_chunk_size = (static_cast<std::size_t>(end - beg) - 1) % maximum_bytes_per_chunk + 1;
+			}
+			if (beg != end && last_chunk_size + afterstr.size() <= maximum_bytes_per_chunk) {
+				// append the second part to the last new chunk
+				suffix_beg = afterstr.begin();
+				suffix_end = afterstr.end();
+			} else {
+				insit = _t.emplace_before(insit, std::move(afterstr));
+			}
+		}
+		if (beg != end) { // build the remaining bytes into a subtree and splice it into the tree
+			std::size_t num_chunks = _chunk_slicer::get_num_chunks(static_cast<std::size_t>(end - beg));
+			_t.insert_range_before_copy(
+				insit,
+				_chunk_slicer(beg, end, 0, suffix_beg, suffix_end),
+				_chunk_slicer(beg, end, num_chunks, suffix_beg, suffix_end)
+			);
+		}
+		// try to merge small nodes
+		_try_merge_small_nodes(insit);
+	}
+
 	void buffer::_try_merge_small_nodes(const tree_type::const_iterator &it) {
 		if (it == _t.end()) {
 			return;
 		}
-		std::size_t nvl = it->data.size();
+		std::size_t nvl = it->size();
 		if (nvl * 2 > maximum_bytes_per_chunk) {
 			return;
 		}
 		if (it != _t.begin()) {
 			tree_type::const_iterator prev = it;
 			--prev;
-			if (prev->data.size() + nvl < maximum_bytes_per_chunk) {
-				_t.get_modifier_for(prev.get_node())->data.insert(
-					prev->data.end(), it->data.begin(), it->data.end()
-				);
+			if (prev->size() + nvl < maximum_bytes_per_chunk) {
+				_t.get_modifier_for(prev.get_node())->append(it->begin(), it->end());
 				_t.erase(it);
 				return;
 			}
 		}
 		tree_type::const_iterator next = it;
 		++next;
-		if (next != _t.end() && next->data.size() + nvl < maximum_bytes_per_chunk) {
-			_t.get_modifier_for(it.get_node())->data.insert(
-				it->data.end(), next->data.begin(), next->data.end()
-			);
+		if (next != _t.end() && next->size() + nvl < maximum_bytes_per_chunk) {
+			_t.get_modifier_for(it.get_node())->append(next->begin(), next->end());
 			_t.erase(next);
 			return;
 		}
@@ -0,0 +1,114 @@
+// Copyright (c) the Codepad contributors. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See LICENSE.txt in the project root for license information.
+
+#include "codepad/editors/code/buffer_input_stream.h"
+
+/// \file
+/// Implementation of \ref codepad::editors::code::buffer_input_stream.
+
+#include <algorithm>
+#include <array>
+
+namespace codepad::editors::code {
+	buffer_input_stream::buffer_input_stream(const interpretation &interp, const std::atomic_bool *cancelled) :
+		_reader(interp.get_buffer()), _back_reader(interp.get_buffer()), _interp(&interp),
+		_encoding(interp.get_encoding()), _cancelled(cancelled),
+		_length(interp.get_buffer().length()), _max_codepoint_length(_encoding->get_maximum_codepoint_length()),
+		_utf8(_encoding->get_name() == encodings::utf8::get_name()) {
+
+		assert_true_logical(
+			_max_codepoint_length <= maximum_codepoint_length, "codepoints of the encoding are too long"
+		);
+		_decode();
+	}
+
+	buffer_input_stream::buffer_input_stream(
+		const interpretation &interp, std::size_t codepoint_pos, std::size_t byte_pos, std::size_t end,
+		const std::atomic_bool *cancelled
+	) : buffer_input_stream(interp, cancelled) {
+		_pos = codepoint_pos;
+		_byte_pos = byte_pos;
+		_length = std::min(end, _length);
+		_next = nullptr;
+		_decode();
+	}
+
+	codepoint buffer_input_stream::prev() {
+		assert_true_logical(!prev_empty(), "cannot move stream backwards");
+		auto [pos, cp] = _decode_previous();
+		_next_byte_pos = _byte_pos;
+		_byte_pos = pos;
+		_cp = cp;
+		--_pos;
+		_next = nullptr;
+		_prev_valid = false;
+		return cp;
+	}
+
+	void buffer_input_stream::_decode_across_chunks() {
+		std::array<std::byte, maximum_codepoint_length> bytes;
+		std::size_t count = 0;
+		for (std::size_t pos = _byte_pos; count < _max_codepoint_length; ) {
+			auto [beg, end] = _reader.read(pos);
+			if (beg == end) { // end of buffer
+				break;
+			}
+			auto num_bytes = std::min(static_cast<std::size_t>(end - beg), _max_codepoint_length - count);
+			std::copy_n(beg, num_bytes, bytes.begin() + count);
+			count += num_bytes;
+			pos += num_bytes;
+		}
+
+		const std::byte *it = bytes.data(), *end = bytes.data() + count;
+		bool valid =
+			_utf8 ?
+			encodings::utf8::next_codepoint(it, end, _cp) :
+			_encoding->next_codepoint(it, end, _cp);
+		if (!valid) {
+			_cp = unicode::replacement_character;
+		}
+		_next_byte_pos = _byte_pos + static_cast<std::size_t>(it - bytes.data());
+		_next = nullptr; // the reader may no longer be at the chunk that contains the next codepoint
+	}
+
+	std::pair<std::size_t, codepoint> buffer_input_stream::_decode_previous() const {
+		if (!_utf8) {
+			return _decode_previous_using_interpretation();
+		}
+		if (_back_chunk == nullptr || _byte_pos <= _back_chunk_pos || _byte_pos > _back_chunk_pos + _back_chunk_size) {
+			auto [beg, end] = _back_reader.read(_byte_pos - 1);
+			_back_chunk_pos = _back_reader.get_chunk_position();
+			_back_chunk = beg - (_byte_pos - 1 - _back_chunk_pos);
+			_back_chunk_size = static_cast<std::size_t>(end - _back_chunk);
+		}
+		std::size_t offset = _byte_pos - _back_chunk_pos;
+		if (offset < encodings::utf8::get_maximum_codepoint_length() && _back_chunk_pos > 0) {
+			// the codepoint may start in the previous chunk
+			return _decode_previous_using_interpretation();
+		}
+		// every byte that's not a continuation byte starts a codepoint, and invalid sequences are treated as single
+		// bytes both forwards and backwards, so decoding backwards finds the same boundary as the interpretation;
+		// the codepoint is then decoded forwards so that its value is also the same as when reading forwards
+		const std::byte *end = _back_chunk + offset, *it = end;
+		encodings::utf8::previous_codepoint(it, _back_chunk);
+		std::size_t pos = _byte_pos - static_cast<std::size_t>(end - it);
+		codepoint cp;
+		if (!encodings::utf8::next_codepoint(it, end, cp)) {
+			cp = unicode::replacement_character;
+		}
+		return { pos, cp };
+	}
+
+	std::pair<std::size_t, codepoint> buffer_input_stream::_decode_previous_using_interpretation() const {
+		// decoding backwards is ambiguous for other encodings when there are invalid codepoints, so use the
+		// codepoint boundaries recorded by the interpretation instead
+		interpretation::codepoint_position_converter conv(*_interp);
+		std::size_t pos = conv.codepoint_to_byte(_pos - 1);
+		buffer::const_iterator it = conv.get_buffer_iterator();
+		codepoint cp;
+		if (!_encoding->next_codepoint(it, _interp->get_buffer().end(), cp)) {
+			cp = unicode::replacement_character;
+		}
+		return { pos, cp };
+	}
+}
@@ -26,6 +26,13 @@ namespace codepad::editors::code {
 		return _setting.get(set);
 	}
 
+	settings::retriever_parser<bool> &contents_region::get_word_wrap_setting(settings &set) {
+		static setting<bool> _setting(
+			{ u8"editor", u8"word_wrap" }, settings::basic_parsers::basic_type_with_default<bool>(false)
+		);
+		return _setting.get(set);
+	}
+
 	void contents_region::on_text_input(std::u8string_view text) {
 		_interaction_manager.on_edit_operation();
 		// encode added content
@@ -44,32 +51,204 @@ namespace codepad::editors::code {
 		_doc->on_insert(_carets, str, this);
 	}
 
-	/// \todo Word wrapping not implemented.
-	std::vector<std::size_t> contents_region::_recalculate_wrapping_region(std::size_t, std::size_t) const {
-		/*
-		vector<std::size_t> poss;
-		std::size_t last = 0;
+	ui::async_task_base::status contents_region::_wrapping_task::execute() {
+		std::optional<std::vector<std::size_t>> softbreaks;
+		if (!_context->cancelled) {
+			buffer::async_reader_lock lock(_doc->get_buffer());
+			// the lock may have been acquired after an edit that cancelled this task; in that case the range is
+			// no longer valid
+			if (!_context->cancelled) {
+				softbreaks = _context->metrics->compute_softbreaks(
+					*_doc, _begin, _end, _context->params, &_context->cancelled
+				);
+			}
+		}
+		// if the region has been disposed, this task may hold the last reference to the document, which must not
+		// be destroyed on this thread; the reference is always moved into a callback on the main thread
+		if (!softbreaks) {
+			_scheduler.execute_callback([doc = std::move(_doc)]() {
+			});
+			return status::cancelled;
+		}
+		_scheduler.execute_callback(
+			[
+				breaks = std::move(softbreaks.value()), context = _context, parent = _parent,
+				beg = _begin, end = _end, doc = std::move(_doc)
+			]() {
+				// the region may have been disposed if wrapping has been cancelled
+				if (!context->cancelled) {
+					parent->_fmt.replace_softbreaks(beg, end, end, breaks);
+					auto &pending = context->pending_partitions;
+					pending.erase(std::find(pending.begin(), pending.end(), std::make_pair(beg, end)));
+					parent->_on_editing_visual_changed();
+				}
+			}
+		);
+		return status::finished;
+	}
 
-		fragment_generator<folded_region_skipper> iter(
-			make_tuple(cref(_fmt.get_folding()), beg),
-			make_tuple(cref(*_doc), beg)
+	void contents_region::_start_wrapping() {
+		_cancel_wrapping();
+		_interrupted_partitions.clear();
+		if (!_doc) {
+			return;
+		}
+		if (!_is_wrapping_active()) {
+			if (_fmt.get_linebreaks().num_softbreaks() > 0) {
+				_fmt.clear_softbreaks();
+			}
+			return;
+		}
+
+		// split the document into partitions that start at the beginning of lines
+		const linebreak_registry &lines = _doc->get_linebreaks();
+		auto &scheduler = get_manager().get_async_task_scheduler();
+		std::size_t num_chars = lines.num_chars();
+		// use one partition per thread for smaller documents, and partitions no longer than the maximum length for
+		// larger ones
+		std::size_t num_partitions = std::max({
+			std::min(num_chars / _wrapping_task::minimum_partition_length, scheduler.get_num_threads()),
+			(num_chars + _wrapping_task::maximum_partition_length - 1) / _wrapping_task::maximum_partition_length,
+			static_cast<std::size_t>(1)
+		});
+		std::vector<std::size_t> boundaries{ 0 };
+		for (std::size_t i = 1; i < num_partitions; ++i) {
+			std::size_t pos = num_chars * i / num_partitions;
+			pos -= lines.get_line_and_column_of_char(pos).position_in_line;
+			if (pos > boundaries.back()) {
+				boundaries.emplace_back(pos);
+			}
+		}
+		boundaries.emplace_back(num_chars);
+
+		std::vector<std::pair<std::size_t, std::size_t>> partitions;
+		for (std::size_t i = 0; i + 1 < boundaries.size(); ++i) {
+			partitions.emplace_back(boundaries[i], boundaries[i + 1]);
+		}
+		_start_wrapping_partitions(std::move(partitions));
+	}
+
+	void contents_region::_start_wrapping_partitions(std::vector<std::pair<std::size_t, std::size_t>> partitions) {
+		auto &scheduler = get_manager().get_async_task_scheduler();
+		_wrapping = std::make_shared<_wrapping_context>(
+			_get_wrapping_metrics(), _get_wrapping_parameters(), std::move(partitions)
 		);
-		text_metrics_accumulator metrics(get_font(), get_line_height(), _fmt.get_tab_width());
-
-		while (iter.get_position() < end) {
-			fragment_generation_result res = iter.generate();
-			metrics.next<>(res.result);
-			if (iter.get_position() > last && metrics.get_character().char_right() > _view_width) { // wrap
-				poss.emplace_back(iter.get_position()); // TODO stalls not taken into account
-				metrics.next_line();
-				metrics.next<>(res.result); // TODO better way to re-measure the fragment
-				last = iter.get_position();
-			}
-			iter.update(res.steps);
-		}
-		return poss;
-		*/
-		return {};
+		for (auto [beg, end] : _wrapping->pending_partitions) {
+			auto &tok = _wrapping_task_tokens.emplace_back(scheduler.start_task(std::make_shared<_wrapping_task>(
+				_wrapping, beg, end, *this
+			)));
+			tok.weaken();
+		}
+	}
+
+	void contents_region::_resume_wrapping(const interpretation::end_edit_info &info) {
+		if (_interrupted_partitions.empty()) {
+			return;
+		}
+		const linebreak_registry &lines = _doc->get_linebreaks();
+		// maps a position before the edit to the position after it; positions in removed ranges are mapped to
+		// the start of the range
+		auto map_position = [&info](std::size_t pos) {
+			// the difference between new and old positions; this may overflow but will still work as intended
+			std::size_t diff = 0;
+			for (const auto &mod : info.character_edit_positions) {
+				std::size_t old_pos = mod.position - diff;
+				if (pos <= old_pos) {
+					break;
+				}
+				if (pos < old_pos + mod.removed_range) {
+					return mod.position;
+				}
+				diff += mod.added_range - mod.removed_range;
+			}
+			return pos + diff;
+		};
+		// partitions must start at the beginning of lines; lines that have been modified or merged by the edit
+		// have already been wrapped by _rewrap_after_edit()
+		auto to_line_beginning = [&lines](std::size_t pos) {
+			return pos - lines.get_line_and_column_of_char(pos).position_in_line;
+		};
+		std::vector<std::pair<std::size_t, std::size_t>> partitions;
+		for (auto [beg, end] : _interrupted_partitions) {
+			beg = to_line_beginning(map_position(beg));
+			end = map_position(end);
+			if (end < lines.num_chars()) {
+				end = to_line_beginning(end);
+			}
+			if (end > beg) {
+				partitions.emplace_back(beg, end);
+			}
+		}
+		_interrupted_partitions.clear();
+		if (!partitions.empty()) {
+			_start_wrapping_partitions(std::move(partitions));
+		}
+	}
+
+	void contents_region::_cancel_wrapping() {
+		if (!_wrapping) {
+			return;
+		}
+		_wrapping->cancelled = true;
+		_wrapping_task_tokens.clear();
+		_wrapping.reset();
+	}
+
+	void contents_region::_cancel_wrapping_and_wait() {
+		if (!_wrapping) {
+			return;
+		}
+		_wrapping->cancelled = true;
+		for (auto &tok : _wrapping_task_tokens) {
+			if (auto task = tok.get_task()) {
+				task->wait_finish();
+			}
+		}
+		_cancel_wrapping();
+	}
+
+	void contents_region::_rewrap_after_edit(const interpretation::end_edit_info &info) {
+		const linebreak_registry &lines = _doc->get_linebreaks();
+		// collect all lines that have been modified. positions of modifications are obtained after all previous
+		// modifications have been applied, and are thus the same as those after the edit
+		std::vector<view_formatting::softbreak_replacement> reps;
+		std::size_t total_length = 0;
+		// the difference between new and old positions in the current range; this may overflow but will still work
+		// as intended, similar to buffer::position_patcher
+		std::size_t diff = 0;
+		for (const auto &mod : info.character_edit_positions) {
+			std::size_t beg = mod.position, end = mod.position + mod.added_range;
+			beg -= lines.get_line_and_column_of_char(beg).position_in_line;
+			auto end_line = lines.get_line_and_column_of_char(end);
+			end += end_line.line_iterator->nonbreak_chars - end_line.position_in_line;
+			if (!reps.empty() && beg <= reps.back().new_end) { // merge with the previous range
+				total_length -= reps.back().new_end - reps.back().begin;
+				reps.back().new_end = std::max(reps.back().new_end, end);
+			} else {
+				auto &rep = reps.emplace_back();
+				rep.begin = beg;
+				rep.new_end = end;
+				diff = 0;
+			}
+			total_length += reps.back().new_end - reps.back().begin;
+			diff += mod.added_range - mod.removed_range;
+			reps.back().old_end = reps.back().new_end - diff;
+		}
+
+		if (total_length > _wrapping_task::minimum_partition_length) {
+			// too much text to wrap synchronously; remove soft linebreaks in the modified lines, and wrap the whole
+			// document asynchronously
+			_fmt.replace_softbreaks(reps);
+			_start_wrapping();
+			return;
+		}
+		performance_monitor mon(u8"rewrap_after_edit");
+		const auto &metrics = _get_wrapping_metrics();
+		word_wrapping_metrics::parameters params = _get_wrapping_parameters();
+		for (auto &rep : reps) {
+			rep.softbreaks = metrics->compute_softbreaks(*_doc, rep.begin, rep.new_end, params).value();
+		}
+		_fmt.replace_softbreaks(reps);
 	}
 
 	double contents_region::_get_caret_pos_x_at_visual_line(std::size_t line, std::size_t position) const {
@@ -169,13 +348,34 @@ namespace codepad::editors::code {
 				_tooltip_position.position = info.start_character;
 			}
 		}
+
+		// update _line_layouts: discard modified lines and shift lines after them; lines with changed boundaries
+		// due to wrapping or merged lines are detected and laid out again by _get_line_layout()
+		std::size_t erase_end = info.start_character + info.removed_characters;
+		std::map<std::size_t, _line_layout> layouts;
+		for (auto &[linebeg, layout] : _line_layouts) {
+			if (linebeg + layout.length <= info.start_character) {
+				layouts.emplace_hint(layouts.end(), linebeg, std::move(layout));
+			} else if (linebeg > info.start_character && linebeg >= erase_end) {
+				layouts.emplace_hint(
+					layouts.end(), linebeg - info.removed_characters + info.inserted_characters, std::move(layout)
+				);
+			}
+		}
+		_line_layouts = std::move(layouts);
 	}
 
 	void contents_region::_on_end_edit(interpretation::end_edit_info &info) {
 		// fixup view
 		_fmt.fixup_after_edit(info.buffer_info, *_doc);
-		// TODO improve performance
-		_fmt.set_softbreaks(_recalculate_wrapping_region(0, _doc->get_linebreaks().num_chars()));
+		if (_is_wrapping_active()) {
+			// this restarts word wrapping for the whole document if the edit is large, which also discards the
+			// interrupted partitions
+			_rewrap_after_edit(info);
+			_resume_wrapping(info);
+		} else {
+			_fmt.recalc_foldreg_lines();
+		}
 
 		// fixup carets
 		_adjust_recalculate_caret_char_positions(info);
@@ -222,12 +422,6 @@ namespace codepad::editors::code {
 				curvisline = be.first;
 
 			// rendering facilities
-			fragment_generator<fragment_generator_component_hub<soft_linebreak_inserter, folded_region_skipper>> gen(
-				get_document(), get_invalid_codepoint_fragment_func(),
-				get_font_families(), get_text_theme(), firstchar,
-				soft_linebreak_inserter(_fmt.get_linebreaks(), firstchar),
-				folded_region_skipper(_fmt.get_folding(), get_folded_fragment_function(), firstchar)
-			);
 			fragment_assembler ass(*this);
 			caret_gatherer caretrend(*used, firstchar, ass, flineinfo.second == linebreak_type::soft);
 			whitespace_gatherer whitespaces(*used, firstchar, ass);
@@ -251,44 +445,53 @@ namespace codepad::editors::code {
 				decorations.emplace_back(std::move(layout), deco_renderer);
 			};
 
-			// gather information for text and carets
+			// gather information for text and carets, using cached layouts of lines
+			_check_line_layout_width();
 			std::vector<fragment_assembler::rendering_storage> renderings;
-			while (gen.get_position() < plastchar) {
-				fragment_generation_result frag = gen.generate_and_update();
-
-				// render the fragment
-				std::visit(
-					[&, this](auto &&specfrag) {
-						auto rendering = ass.append(specfrag);
-
-						caretrend.handle_fragment(specfrag, rendering, frag.steps, gen.get_position());
-						deco_gather.handle_fragment(specfrag, rendering, frag.steps, gen.get_position());
-						whitespaces.handle_fragment(specfrag, rendering, frag.steps, gen.get_position());
-
-						renderings.emplace_back(std::move(rendering));
-					},
-					frag.result
-				);
+			std::size_t linebeg = firstchar, numlines = get_num_visual_lines();
+			for (; curvisline < be.second; ++curvisline) {
+				std::pair<std::size_t, linebreak_type> next(_doc->get_linebreaks().num_chars(), linebreak_type::hard);
+				if (curvisline + 1 < numlines) {
+					next = _fmt.get_linebreaks().get_beginning_char_of_visual_line(
+						_fmt.get_folding().folded_to_unfolded_line_number(curvisline + 1)
+					);
+				}
+				const _line_layout &layout = _get_line_layout(linebeg, next.first);
+
+				double linetop = ass.get_vertical_position();
+				for (const _line_layout::placed_fragment &frag : layout.fragments) {
+					std::size_t position = linebeg + frag.end_offset;
+					ass.set_horizontal_position(frag.end_position.x);
+					ass.set_vertical_position(linetop + frag.end_position.y);
+					std::visit(
+						[&](auto &&specfrag) {
+							auto rendering = std::get<decltype(ass.append(specfrag))>(frag.rendering);
+							rendering.topleft.y += linetop;
+
+							caretrend.handle_fragment(specfrag, rendering, frag.result.steps, position);
+							deco_gather.handle_fragment(specfrag, rendering, frag.result.steps, position);
+							whitespaces.handle_fragment(specfrag, rendering, frag.result.steps, position);
+
+							renderings.emplace_back(std::move(rendering));
+						},
+						frag.result.result
+					);
+				}
 
-				if (std::holds_alternative<linebreak_fragment>(frag.result)) {
-					++curvisline;
-				} else if (ass.get_horizontal_position() + get_padding().left > get_layout().width()) {
+				if (layout.overflow) {
 					// skip to the next line
-					++curvisline;
-					auto pos = _fmt.get_linebreaks().get_beginning_char_of_visual_line(
-						_fmt.get_folding().folded_to_unfolded_line_number(curvisline)
-					);
-					// update gatherers
-					caretrend.skip_line(pos.second == linebreak_type::soft, pos.first);
-					deco_gather.skip_line(pos.first);
-					// reposition fragment generator
-					gen.reposition(pos.first);
-					// update fragment assenbler
+					caretrend.skip_line(next.second == linebreak_type::soft, next.first);
+					deco_gather.skip_line(next.first);
 					ass.set_horizontal_position(0.0);
+					ass.set_vertical_position(linetop);
 					ass.advance_vertical_position(1);
 				}
+				linebeg = next.first;
 			}
-			caretrend.finish(gen.get_position());
+			// only keep the layouts of visible lines
+			_line_layouts.erase(_line_layouts.begin(), _line_layouts.lower_bound(firstchar));
+			_line_layouts.erase(_line_layouts.lower_bound(plastchar), _line_layouts.end());
+			caretrend.finish(linebeg);
 			deco_gather.finish();
 
 			// render carets & selections
@@ -336,6 +539,170 @@ namespace codepad::editors::code {
 		}
 	}
 
+	contents_region::_line_layout contents_region::_layout_visual_line(
+		std::size_t linebeg, std::size_t nextlinebeg
+	) const {
+		_line_layout result;
+		result.length = nextlinebeg - linebeg;
+
+		fragment_generator<fragment_generator_component_hub<soft_linebreak_inserter, folded_region_skipper>> gen(
+			get_document(), get_invalid_codepoint_fragment_func(),
+			get_font_families(), get_text_theme(), linebeg,
+			soft_linebreak_inserter(_fmt.get_linebreaks(), linebeg),
+			folded_region_skipper(_fmt.get_folding(), get_folded_fragment_function(), linebeg)
+		);
+		fragment_assembler ass(*this);
+		std::size_t numchars = _doc->get_linebreaks().num_chars();
+		while (gen.get_position() < numchars) {
+			fragment_generation_result frag = gen.generate_and_update();
+			auto rendering = std::visit([&ass](auto &&specfrag) {
+				return fragment_assembler::rendering_storage(ass.append(specfrag));
+			}, frag.result);
+			bool linebreak = std::holds_alternative<linebreak_fragment>(frag.result);
+			result.fragments.emplace_back(
+				std::move(frag), std::move(rendering), gen.get_position() - linebeg, ass.get_position()
+			);
+
+			if (linebreak) {
+				break;
+			}
+			if (ass.get_horizontal_position() + get_padding().left > get_layout().width()) {
+				result.overflow = true;
+				break;
+			}
+		}
+		return result;
+	}
+
+	const contents_region::_line_layout &contents_region::_get_line_layout(
+		std::size_t linebeg, std::size_t nextlinebeg
+	) const {
+		auto [it, inserted] = _line_layouts.try_emplace(linebeg);
+		if (inserted || it->second.length != nextlinebeg - linebeg) {
+			it->second = _layout_visual_line(linebeg, nextlinebeg);
+		}
+		return it->second;
+	}
+
+	void contents_region::_discard_line_layouts(std::optional<std::pair<std::size_t, std::size_t>> range) {
+		if (!range) {
+			_line_layouts.clear();
+			return;
+		}
+		auto [beg, end] = range.value();
+		// lines that contain the start of the range, or end right before it, may also start before it
+		auto first = _line_layouts.upper_bound(beg);
+		while (first != _line_layouts.begin()) {
+			auto prev = std::prev(first);
+			if (prev->first + prev->second.length < beg) {
+				break;
+			}
+			first = prev;
+		}
+		auto last = _line_layouts.upper_bound(end);
+		if (first != _line_layouts.end() && first->first <= end) {
+			_line_layouts.erase(first, last);
+		}
+	}
+
+	std::vector<double> contents_region::_measure_characters(std::size_t beg, std::size_t end) const {
+		std::vector<double> result(end - beg, 0.0);
+		fragment_generator<fragment_generator_component_hub<>> gen(
+			get_document(), get_invalid_codepoint_fragment_func(), get_font_families(), get_text_theme(), beg
+		);
+		fragment_assembler ass(*this);
+		while (gen.get_position() < end) {
+			std::size_t pos = gen.get_position();
+			fragment_generation_result frag = gen.generate_and_update();
+			std::visit([&](auto &&specfrag) {
+				double x = ass.get_horizontal_position();
+				auto &&rendering = ass.append(specfrag);
+				if constexpr (std::is_same_v<std::decay_t<decltype(specfrag)>, text_fragment>) {
+					if (!specfrag.is_gizmo && specfrag.text.size() == frag.steps) {
+						// use the distance between adjacent characters, which includes kerning
+						double prev = 0.0;
+						for (std::size_t i = 1; i < frag.steps; ++i) {
+							double cur = rendering.text->get_character_placement(i).xmin;
+							result[pos - beg + i - 1] = cur - prev;
+							prev = cur;
+						}
+						result[pos - beg + frag.steps - 1] = rendering.text->get_width() - prev;
+						return;
+					}
+				}
+				// otherwise, attribute the whole fragment to its first character
+				result[pos - beg] = ass.get_horizontal_position() - x;
+			}, frag.result);
+		}
+		return result;
+	}
+
+	void contents_region::_check_visible_lines_wrapping() {
+		_check_line_layout_width();
+		const linebreak_registry &lines = _doc->get_linebreaks();
+		const soft_linebreak_registry &softbreaks = _fmt.get_linebreaks();
+		auto [first, past_last] = get_visible_visual_lines();
+		std::size_t numlines = get_num_visual_lines();
+
+		// collect lines that contain visible visual lines that have not been checked
+		std::vector<std::pair<std::size_t, std::size_t>> unchecked;
+		for (std::size_t line = first; line < past_last; ++line) {
+			std::size_t
+				linebeg = softbreaks.get_beginning_char_of_visual_line(
+					_fmt.get_folding().folded_to_unfolded_line_number(line)
+				).first,
+				nextlinebeg = lines.num_chars();
+			if (line + 1 < numlines) {
+				nextlinebeg = softbreaks.get_beginning_char_of_visual_line(
+					_fmt.get_folding().folded_to_unfolded_line_number(line + 1)
+				).first;
+			}
+			if (_get_line_layout(linebeg, nextlinebeg).wrapping_checked) {
+				continue;
+			}
+			auto line_info = lines.get_line_and_column_of_char(linebeg);
+			std::size_t beg = linebeg - line_info.position_in_line;
+			if (unchecked.empty() || unchecked.back().first != beg) {
+				unchecked.emplace_back(beg, beg + line_info.line_iterator->nonbreak_chars);
+			}
+		}
+
+		word_wrapping_metrics::parameters params = _get_wrapping_parameters();
+		bool changed = false;
+		for (auto [beg, end] : unchecked) {
+			if (end - beg <= _maximum_wrapping_check_length) {
+				std::vector<std::size_t> breaks = word_wrapping_metrics::compute_softbreaks_with_widths(
+					*_doc, beg, _measure_characters(beg, end), params
+				);
+				std::vector<std::size_t> old_breaks;
+				std::size_t num_visual_lines = softbreaks.num_visual_lines();
+				for (
+					std::size_t visline = softbreaks.get_visual_line_of_char(beg) + 1;
+					visline < num_visual_lines;
+					++visline
+				) {
+					auto [pos, type] = softbreaks.get_beginning_char_of_visual_line(visline);
+					if (type != linebreak_type::soft) {
+						break;
+					}
+					old_breaks.emplace_back(pos);
+				}
+				if (breaks != old_breaks) {
+					// the new visual lines are laid out and checked again later
+					_fmt.replace_softbreaks(beg, end, end, breaks);
+					changed = true;
+					continue;
+				}
+			}
+			for (auto it = _line_layouts.lower_bound(beg); it != _line_layouts.end() && it->first <= end; ++it) {
+				it->second.wrapping_checked = true;
+			}
+		}
+		if (changed) {
+			_on_editing_visual_changed();
+		}
+	}
+
 	void contents_region::_initialize() {
 		interactive_contents_region_base::_initialize();
 
@@ -356,6 +723,7 @@ namespace codepad::editors::code {
 				logger::get().log_info() << "font family not found: " << f;
 			}
 		}
+		_word_wrap = get_word_wrap_setting(set).get_profile(profile.begin(), profile.end()).get_value();
 		set_font_families(std::move(families));
 
 		set_font_size_and_line_height(
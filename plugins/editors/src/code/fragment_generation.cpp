@@ -74,9 +74,34 @@ namespace codepad::editors::code {
 	}
 
 
+	std::shared_ptr<ui::plain_text> plain_text_cache::get(
+		ui::renderer_base &rend, std::basic_string_view<codepoint> text,
+		const std::shared_ptr<ui::font> &font, double size
+	) {
+		if (auto it = _entries.find(_key_view(text, font.get(), size)); it != _entries.end()) {
+			// move the entry to the front
+			_lru.splice(_lru.begin(), _lru, it->second.lru_position);
+			return it->second.text;
+		}
+
+		std::shared_ptr<ui::plain_text> result = rend.create_plain_text(text, *font, size);
+		auto it = _entries.emplace(
+			_key(std::basic_string<codepoint>(text), font.get(), size), _entry(result, font, _lru.end())
+		).first;
+		_lru.emplace_front(&it->first);
+		it->second.lru_position = _lru.begin();
+		if (_entries.size() > _capacity) { // evict the least recently used entry
+			auto evicted = _entries.find(*_lru.back());
+			_lru.pop_back();
+			_entries.erase(evicted);
+		}
+		return result;
+	}
+
+
 	fragment_assembler::fragment_assembler(const contents_region &rgn) : fragment_assembler(
 		rgn.get_manager().get_renderer(), *rgn.get_font_families()[0], rgn.get_font_size(),
-		rgn.get_line_height(), rgn.get_baseline(), rgn.get_tab_width()
+		rgn.get_line_height(), rgn.get_baseline(), rgn.get_tab_width(), &rgn.get_plain_text_cache()
 	) {
 	}
 }
@@ -84,6 +84,7 @@ namespace codepad::editors::code {
 				lines.emplace_back(len, ending);
 			}
 		);
+		std::vector<chunk_data> chunks;
 		std::size_t
 			chkbegbytes = 0, chkbegcps = 0, curcp = 0,
 			splitcp = maximum_codepoints_per_chunk; // where to split the next chunk
@@ -91,7 +92,7 @@ namespace codepad::editors::code {
 			if (curcp >= splitcp) {
 				// break chunk before this codepoint
 				std::size_t bytepos = cur.get_position();
-				_chunks.emplace_before(_chunks.end(), chunk_data(bytepos - chkbegbytes, curcp - chkbegcps));
+				chunks.emplace_back(bytepos - chkbegbytes, curcp - chkbegcps);
 				chkbegbytes = bytepos;
 				chkbegcps = curcp;
 				splitcp = curcp + maximum_codepoints_per_chunk;
@@ -106,10 +107,9 @@ namespace codepad::editors::code {
 		// process the last chunk
 		line_analyzer.finish();
 		if (get_buffer().length() > chkbegbytes) {
-			_chunks.emplace_before(
-				_chunks.end(), chunk_data(get_buffer().length() - chkbegbytes, curcp - chkbegcps)
-			);
+			chunks.emplace_back(get_buffer().length() - chkbegbytes, curcp - chkbegcps);
 		}
+		_chunks.insert_range_before_copy(_chunks.end(), chunks.begin(), chunks.end());
 		_linebreaks.insert_codepoints(_linebreaks.begin(), 0, lines);
 	}
 
@@ -440,9 +440,7 @@ namespace codepad::editors::code {
 			++end_chunk;
 		}
 		_chunks.erase(_mod_cache.start_decoding_chunk, end_chunk);
-		for (chunk_data chk : chunks) {
-			_chunks.emplace_before(end_chunk, chk);
-		}
+		_chunks.insert_range_before_copy(end_chunk, chunks.begin(), chunks.end());
 
 		// compute character ranges that are affected
 		if (new_content_chars == 0) {
@@ -6,80 +6,301 @@
 /// \file
 /// Implementation of search panels.
 
+#include <cstring>
+
+#include <codepad/core/regex/parser.h>
+#include <codepad/core/regex/parser.inl>
+#include <codepad/core/regex/matcher.inl>
+
 #include "../details.h"
 
+namespace codepad::editors::_details {
+	/// The number of codepoints on either side of the current position that a simple assertion may examine,
+	/// e.g., \p \\Z before a trailing CRLF.
+	constexpr std::size_t regex_assertion_context = 2;
+
+	/// Checks whether an attempt to match the given node only examines the text that it matches and at most
+	/// \ref regex_assertion_context codepoints around it. Lookarounds, backreferences and subroutines are
+	/// rejected, as are assertions and verbs that depend on where the search or the match starts.
+	[[nodiscard]] bool is_regex_node_local(const regex::ast &ast, regex::ast_nodes::node_ref ref) {
+		using namespace regex::ast_nodes;
+
+		auto all_local = [&ast](const std::vector<node_ref> &nodes) {
+			return std::all_of(nodes.begin(), nodes.end(), [&ast](node_ref n) {
+				return is_regex_node_local(ast, n);
+			});
+		};
+
+		const regex::ast::node &node = ast.get_node(ref);
+		if (auto *assertion = std::get_if<simple_assertion>(&node.value)) {
+			return assertion->assertion_type != simple_assertion::type::range_start;
+		}
+		if (auto *subexpr = std::get_if<subexpression>(&node.value)) {
+			return all_local(subexpr->nodes);
+		}
+		if (auto *alt = std::get_if<alternative>(&node.value)) {
+			return all_local(alt->alternatives);
+		}
+		if (auto *rep = std::get_if<repetition>(&node.value)) {
+			return is_regex_node_local(ast, rep->expression);
+		}
+		if (auto *cond = std::get_if<conditional_expression>(&node.value)) {
+			if (std::holds_alternative<conditional_expression::complex_assertion>(cond->condition)) {
+				return false;
+			}
+			return
+				is_regex_node_local(ast, cond->if_true) &&
+				(!cond->if_false || is_regex_node_local(ast, cond->if_false.value()));
+		}
+		return !(
+			node.is<match_start_override>() ||
+			node.is<numbered_backreference>() || node.is<named_backreference>() ||
+			node.is<numbered_subroutine>() || node.is<named_subroutine>() ||
+			node.is<complex_assertion>()
+		);
+	}
+}
+
 namespace codepad::editors::code {
+	search_panel::_match_context::_match_context(
+		std::u8string_view patt, const interpretation &interp, std::size_t num_partitions
+	) : results(num_partitions), remaining_partitions(num_partitions) {
+		bool byte_matchable = interp.get_encoding()->get_name() == encodings::utf8::get_name();
+		for (auto it = patt.begin(); it != patt.end(); ) {
+			codepoint cp;
+			if (!encodings::utf8::next_codepoint(it, patt.end(), cp)) {
+				logger::get().log_error() << "invalid codepoint in search string: " << cp;
+				cp = unicode::replacement_character;
+			}
+			// linebreaks match all kinds of line endings, and the replacement character matches invalid
+			// codepoints; these can only be handled after decoding
+			if (cp == U'\r' || cp == U'\n' || cp == unicode::replacement_character) {
+				byte_matchable = false;
+			}
+			pattern.push_back(cp);
+		}
+		if (byte_matchable) {
+			pattern_bytes.resize(patt.size());
+			std::memcpy(pattern_bytes.data(), patt.data(), patt.size());
+			byte_searcher.emplace(pattern_bytes.data(), pattern_bytes.data() + pattern_bytes.size());
+		}
+	}
+
+
 	ui::async_task_base::status search_panel::_match_task::execute() {
-		using _codepoint_str = std::basic_string<codepoint>;
+		if (_context->cancelled) {
+			return status::cancelled;
+		}
+		if (_context->regex) {
+			return _match_regex();
+		}
 
 		std::vector<std::pair<std::size_t, std::size_t>> results;
+		{
+			buffer::async_reader_lock lock(_parent._contents->get_document().get_buffer());
+			if (!find_matches(results)) {
+				return status::cancelled;
+			}
+		}
+		_context->results[_partition] = std::move(results);
+
+		if (--_context->remaining_partitions > 0) {
+			return status::finished;
+		}
+		// this is the last task to finish; merge the results of all partitions, which are already sorted
+		if (_context->cancelled) {
+			return status::cancelled;
+		}
+		std::size_t total = 0;
+		for (const auto &part : _context->results) {
+			total += part.size();
+		}
+		std::vector<std::pair<std::size_t, std::size_t>> merged;
+		merged.reserve(total);
+		for (auto &part : _context->results) {
+			merged.insert(merged.end(), part.begin(), part.end());
+			part = {};
+		}
 
-		std::size_t pattern_length = 0;
-		if (!_pattern.empty()) {
-			// decode search string
-			_codepoint_str pattern;
-			for (auto it = _pattern.begin(); it != _pattern.end(); ) {
-				codepoint cp;
-				if (!encodings::utf8::next_codepoint(it, _pattern.end(), cp)) {
-					logger::get().log_error() << "invalid codepoint in search string: " << cp;
-					cp = unicode::replacement_character;
+		_parent.get_manager().get_scheduler().execute_callback(
+			[results = std::move(merged), context = _context, parent = &_parent]() {
+				// the panel may have been disposed if the search has been cancelled
+				if (!context->cancelled) {
+					parent->_update_results(std::move(results));
+					parent->_searching = false;
 				}
-				pattern.push_back(cp);
 			}
-			pattern_length = pattern.size();
+		);
 
-			if (cancelled) {
-				return status::cancelled;
+		return status::finished;
+	}
+
+	bool search_panel::_match_task::_match_characters(std::vector<std::pair<std::size_t, std::size_t>> &results) {
+		using _codepoint_str = std::basic_string<codepoint>;
+
+		const interpretation &doc = _parent._contents->get_document();
+		std::size_t pattern_length = _context->pattern.size();
+		// matches starting in this partition may extend into the next one
+		std::size_t scan_end = std::min(_end + pattern_length - 1, doc.get_linebreaks().num_chars());
+
+		kmp_matcher<_codepoint_str> matcher(_context->pattern);
+		kmp_matcher<_codepoint_str>::state st;
+		std::size_t position = _begin;
+		auto it = doc.character_at(position);
+		std::size_t counter = 0;
+		while (position < scan_end) {
+			codepoint cp;
+			if (it.is_linebreak()) {
+				cp = U'\n';
+			} else {
+				cp =
+					it.codepoint().is_codepoint_valid() ?
+					it.codepoint().get_codepoint() :
+					unicode::replacement_character;
 			}
+			auto [new_st, match] = matcher.put(cp, st);
 
-			{ // match
-				buffer::async_reader_lock lock(_parent._contents->get_document().get_buffer());
-
-				kmp_matcher<_codepoint_str> matcher(std::move(pattern));
-				kmp_matcher<_codepoint_str>::state st;
-				std::size_t position = 0;
-				auto it = _parent._contents->get_document().character_at(position);
-				std::size_t counter = 0;
-				while (!it.codepoint().ended()) {
-					codepoint cp;
-					if (it.is_linebreak()) {
-						cp = U'\n';
-					} else {
-						cp =
-							it.codepoint().is_codepoint_valid() ?
-							it.codepoint().get_codepoint() :
-							unicode::replacement_character;
-					}
-					auto [new_st, match] = matcher.put(cp, st);
+			st = new_st;
+			++position;
+			it.next();
+			if (match) {
+				results.emplace_back(position - pattern_length, position);
+			}
 
-					st = new_st;
-					++position;
-					it.next();
-					if (match) {
-						results.emplace_back(position - pattern_length, position);
-					}
+			// check for cancellation
+			if (++counter == cancellation_check_interval) {
+				if (_context->cancelled) {
+					return false;
+				}
+				counter = 0;
+			}
+		}
+		return true;
+	}
+
+	bool search_panel::_match_task::_match_bytes(std::vector<std::pair<std::size_t, std::size_t>> &results) {
+		const interpretation &doc = _parent._contents->get_document();
+		const auto &searcher = _context->byte_searcher.value();
+		std::size_t pattern_length = _context->pattern.size(), pattern_bytes = _context->pattern_bytes.size();
+
+		interpretation::character_position_converter conv(doc);
+		std::size_t
+			byte_begin = conv.character_to_byte(_begin),
+			byte_end = conv.character_to_byte(_end),
+			byte_scan_end = conv.character_to_byte(
+				std::min(_end + pattern_length - 1, doc.get_linebreaks().num_chars())
+			);
+		conv.reset();
+
+		// finds all matches in the given range of bytes starting at the given position in the buffer, that also
+		// start before the given limit. since the pattern contains no linebreaks, the number of characters in a
+		// match is the same as the number of codepoints
+		auto find_all = [&](
+			const unsigned char *first, const unsigned char *last, std::size_t first_pos, std::size_t limit
+		) {
+			for (const unsigned char *cur = first; ; ) {
+				const unsigned char *match = searcher(cur, last).first;
+				if (match == last) {
+					break;
+				}
+				std::size_t match_pos = first_pos + static_cast<std::size_t>(match - first);
+				if (match_pos >= limit) {
+					break;
+				}
+				std::size_t char_pos = conv.byte_to_character(match_pos);
+				results.emplace_back(char_pos, char_pos + pattern_length);
+				cur = match + 1;
+			}
+		};
+
+		buffer::chunk_reader reader(doc.get_buffer());
+		// the last few bytes before the current chunk, used to find matches that cross chunk boundaries
+		std::vector<unsigned char> seam;
+		for (std::size_t pos = byte_begin; pos < byte_scan_end; ) {
+			if (_context->cancelled) {
+				return false;
+			}
+			auto [chunk_first, chunk_last] = reader.read(pos);
+			if (chunk_first == chunk_last) {
+				break;
+			}
+			const auto *chunk_begin = reinterpret_cast<const unsigned char*>(chunk_first);
+			const auto *chunk_end = reinterpret_cast<const unsigned char*>(chunk_last);
+			chunk_end = std::min(chunk_end, chunk_begin + (byte_scan_end - pos));
+			auto chunk_length = static_cast<std::size_t>(chunk_end - chunk_begin);
+
+			// matches that start in the seam and end in this chunk
+			std::size_t carry = seam.size();
+			seam.insert(seam.end(), chunk_begin, chunk_begin + std::min(chunk_length, pattern_bytes - 1));
+			if (carry > 0) {
+				find_all(seam.data(), seam.data() + seam.size(), pos - carry, std::min(pos, byte_end));
+			}
+			// matches inside this chunk
+			find_all(chunk_begin, chunk_end, pos, byte_end);
+
+			// keep the last few bytes
+			if (chunk_length >= pattern_bytes - 1) {
+				seam.assign(chunk_end - (pattern_bytes - 1), chunk_end);
+			} else if (seam.size() > pattern_bytes - 1) { // the seam now contains the whole chunk
+				seam.erase(seam.begin(), seam.end() - static_cast<std::ptrdiff_t>(pattern_bytes - 1));
+			}
+			pos += chunk_length;
+		}
+		return true;
+	}
 
-					// check for cancellation
-					if (++counter == cancellation_check_interval) {
-						if (cancelled) {
-							return status::cancelled;
+	ui::async_task_base::status search_panel::_match_task::_match_regex() {
+		std::vector<std::pair<std::size_t, std::size_t>> batch;
+		auto last_batch_time = std::chrono::steady_clock::now();
+		auto send_batch = [&](bool last) {
+			_parent.get_manager().get_scheduler().execute_callback(
+				[results = std::move(batch), context = _context, parent = &_parent, last]() {
+					// the panel may have been disposed if the search has been cancelled
+					if (!context->cancelled) {
+						parent->_append_results(results);
+						if (last) {
+							parent->_searching = false;
 						}
-						counter = 0;
 					}
 				}
-			}
+			);
+			batch = {};
+			last_batch_time = std::chrono::steady_clock::now();
+		};
+
+		{
+			const interpretation &doc = _parent._contents->get_document();
+			buffer::async_reader_lock lock(doc.get_buffer());
+
+			// matches are found in order, so two converters are used for the beginnings and ends of matches
+			linebreak_registry::position_converter
+				begin_converter(doc.get_linebreaks()), end_converter(doc.get_linebreaks());
+			buffer_input_stream stream(doc, &_context->cancelled);
+			_regex_matcher matcher;
+			matcher.find_all(stream, _context->regex.value(), [&](_regex_matcher::result res) {
+				const auto &match = res.captures[0];
+				std::size_t
+					begin = res.overriden_match_begin ?
+						res.overriden_match_begin->codepoint_position() :
+						match.begin.codepoint_position(),
+					end = match.begin.codepoint_position() + match.length;
+				batch.emplace_back(
+					begin_converter.codepoint_to_character(begin), end_converter.codepoint_to_character(end)
+				);
+				if (
+					batch.size() >= result_batch_size ||
+					std::chrono::steady_clock::now() - last_batch_time >= result_batch_interval
+				) {
+					send_batch(false);
+				}
+				return !_context->cancelled;
+			});
 		}
 
-		if (cancelled) {
+		if (_context->cancelled) {
 			return status::cancelled;
 		}
-
-		_parent._task_result_token = _parent.get_manager().get_scheduler().execute_callback(
-			[results = std::move(results), parent = &_parent]() {
-				parent->_update_results(std::move(results));
-			}
-		);
-
+		send_batch(true);
 		return status::finished;
 	}
 
@@ -99,35 +320,358 @@ namespace codepad::editors::code {
 	void search_panel::_on_input_changed() {
 		_clear_results();
 		_cancel_task();
+		_match.reset();
+		_searching = false;
+
+		std::u8string pattern = _input->get_text();
+		if (pattern.empty()) {
+			return;
+		}
 
-		// start new task
-		_task_token = get_manager().get_async_task_scheduler().start_task(
-			std::make_shared<_match_task>(_input->get_text(), *this)
+		const interpretation &doc = _contents->get_document();
+		auto &scheduler = get_manager().get_async_task_scheduler();
+		if (_regex_mode) {
+			_match = _compile_regex(pattern);
+			if (!_match) {
+				return;
+			}
+			_searching = true;
+			auto &tok = _task_tokens.emplace_back(scheduler.start_task(std::make_shared<_match_task>(
+				_match, 0, 0, doc.get_linebreaks().num_chars(), *this
+			)));
+			tok.weaken();
+			return;
+		}
+
+		// split the document into partitions and start a task for each of them
+		std::size_t num_chars = doc.get_linebreaks().num_chars();
+		std::size_t num_partitions = std::clamp<std::size_t>(
+			num_chars / _match_task::minimum_partition_length, 1, std::max<std::size_t>(scheduler.get_num_threads(), 1)
 		);
-		_task_token.weaken();
+		_match = std::make_shared<_match_context>(pattern, doc, num_partitions);
+		_searching = true;
+		for (std::size_t i = 0; i < num_partitions; ++i) {
+			auto &tok = _task_tokens.emplace_back(scheduler.start_task(std::make_shared<_match_task>(
+				_match, i, num_chars * i / num_partitions, num_chars * (i + 1) / num_partitions, *this
+			)));
+			tok.weaken();
+		}
 	}
 
 	void search_panel::_update_results(std::vector<std::pair<std::size_t, std::size_t>> results) {
-		_results = std::move(results);
+		_results.clear();
+		_decoration_token.modify()->decorations.clear();
+		_append_results(results);
+	}
+
+	void search_panel::_append_results(const std::vector<std::pair<std::size_t, std::size_t>> &results) {
+		_results.insert(_results.end(), results.begin(), results.end());
 		// update result list box source
 		if (_result_list) {
 			static_cast<_match_result_source*>(_result_list->get_source())->on_items_changed();
 		}
-		// update decorations
+		_add_decorations(results);
+	}
+
+	void search_panel::_add_decorations(std::span<const std::pair<std::size_t, std::size_t>> results) {
+		auto mod = _decoration_token.modify();
+		if (mod->renderers.empty()) {
+			auto &lang = _contents->get_document().get_buffer().get_language();
+			mod->renderers.emplace_back(get_decoration_renderer_setting(
+				*_details::get_plugin_context().sett
+			).get_value(lang.begin(), lang.end()));
+		}
+		decoration_renderer *rend = mod->renderers.front().get();
+		for (auto [beg, end] : results) {
+			mod->decorations.insert_range_after(beg, end - beg, { .renderer = rend });
+		}
+	}
+
+	void search_panel::_on_begin_edit() {
+		if (_searching) {
+			// the tasks cannot continue after the document is modified; the search is restarted after the edit
+			_cancel_task();
+		}
+	}
+
+	void search_panel::_on_end_edit(interpretation::end_edit_info &info) {
+		if (!_match) { // no active search
+			return;
+		}
+		if (_searching) {
+			_on_input_changed();
+			return;
+		}
+		if (_match->regex) {
+			if (!_match->regex_reach || !_update_regex_results(info)) {
+				_on_input_changed();
+			}
+			return;
+		}
+
+		const auto &positions = info.character_edit_positions;
+		std::size_t pattern_length = _match->pattern.size();
+		std::size_t num_chars = _contents->get_document().get_linebreaks().num_chars();
+
+		// new matches must overlap with inserted text, or contain the position of removed text; such matches start
+		// in the window before the end of the inserted text
+		std::vector<std::pair<std::size_t, std::size_t>> windows;
+		std::size_t total_length = 0;
+		for (const auto &mod : positions) {
+			std::size_t
+				beg = mod.position - std::min(mod.position, pattern_length - 1),
+				end = std::min(mod.position + mod.added_range, num_chars);
+			if (beg >= end) {
+				continue;
+			}
+			if (!windows.empty() && beg <= windows.back().second) { // merge overlapping windows
+				total_length -= windows.back().second - windows.back().first;
+				windows.back().first = std::min(windows.back().first, beg);
+				windows.back().second = std::max(windows.back().second, end);
+			} else {
+				windows.emplace_back(beg, end);
+			}
+			total_length += windows.back().second - windows.back().first;
+		}
+		if (total_length > maximum_incremental_search_length) {
+			_on_input_changed();
+			return;
+		}
+
+		// remove results that overlap with modified ranges, and shift the remaining ones. since all results of a
+		// non-regex search have the same length, both their beginnings and ends are sorted
+		std::size_t num_kept = 0;
 		{
-			auto mod = _decoration_token.modify();
-			if (mod->renderers.empty()) {
-				auto &lang = _contents->get_document().get_buffer().get_language();
-				mod->renderers.emplace_back(get_decoration_renderer_setting(
-					*_details::get_plugin_context().sett
-				).get_value(lang.begin(), lang.end()));
+			auto mod = positions.begin();
+			// the difference between new and old positions before the next modification; this may overflow but
+			// will still work as intended, similar to buffer::position_patcher
+			std::size_t diff = 0;
+			for (auto [beg, end] : _results) {
+				for (; mod != positions.end() && mod->position - diff + mod->removed_range <= beg; ++mod) {
+					diff += mod->added_range - mod->removed_range;
+				}
+				if (mod != positions.end() && mod->position - diff < end) {
+					continue;
+				}
+				_results[num_kept] = { beg + diff, end + diff };
+				++num_kept;
 			}
-			decoration_renderer *rend = mod->renderers.front().get();
-			mod->decorations.clear();
+		}
+		_results.resize(num_kept);
+
+		// search the windows again and merge the results
+		std::vector<std::pair<std::size_t, std::size_t>> found;
+		for (auto [beg, end] : windows) {
+			_match_task(_match, 0, beg, end, *this).find_matches(found);
+		}
+		auto mid = static_cast<std::ptrdiff_t>(_results.size());
+		_results.insert(_results.end(), found.begin(), found.end());
+		std::inplace_merge(_results.begin(), _results.begin() + mid, _results.end());
+		if (_result_list) {
+			static_cast<_match_result_source*>(_result_list->get_source())->on_items_changed();
+		}
+
+		// decorations have already been adjusted by the contents_region, and those of removed matches have been
+		// truncated or extended to lie within these regions. decorations in these regions are recreated
+		std::vector<std::pair<std::size_t, std::size_t>> regions;
+		for (const auto &mod : positions) {
+			std::size_t
+				beg = mod.position - std::min(mod.position, pattern_length - 1),
+				end = mod.position + mod.added_range + pattern_length - 1;
+			if (!regions.empty() && beg <= regions.back().second) {
+				regions.back().first = std::min(regions.back().first, beg);
+				regions.back().second = std::max(regions.back().second, end);
+			} else {
+				regions.emplace_back(beg, end);
+			}
+		}
+		for (auto [beg, end] : regions) {
+			_decoration_token.modify()->decorations.erase_ranges_within(beg, end);
+			auto first = std::lower_bound(
+				_results.begin(), _results.end(), std::pair<std::size_t, std::size_t>(beg, 0)
+			);
+			auto last = first;
+			for (; last != _results.end() && last->second <= end; ++last) {
+			}
+			_add_decorations({ first, last });
+		}
+	}
+
+	bool search_panel::_update_regex_results(interpretation::end_edit_info &info) {
+		const interpretation &doc = _contents->get_document();
+		const auto &positions = info.character_edit_positions;
+		// a character contains at least one codepoint, so this many characters cover the reach of the expression
+		std::size_t reach = _match->regex_reach.value();
+		std::size_t num_chars = doc.get_linebreaks().num_chars();
+
+		// an attempt to match at a position outside of these windows only examines unmodified text, so its result
+		// is unchanged. the windows may extend one character past the end so that they cover empty matches there
+		std::vector<std::pair<std::size_t, std::size_t>> windows;
+		for (const auto &mod : positions) {
+			std::size_t
+				beg = mod.position - std::min(mod.position, reach),
+				end = std::min(mod.position + mod.added_range + reach, num_chars + 1);
+			if (!windows.empty() && beg <= windows.back().second) {
+				windows.back().second = std::max(windows.back().second, end);
+			} else {
+				windows.emplace_back(beg, end);
+			}
+		}
+
+		// shift old results; positions inside removed ranges are moved to the end of the corresponding inserted
+		// text. the ends of results are used to determine where the old and new results line up again, and moving
+		// them to the right only makes that position more conservative
+		std::vector<std::pair<std::size_t, std::size_t>> old_results;
+		old_results.reserve(_results.size());
+		{
+			auto map_position = [&positions](std::size_t pos, auto &mod, std::size_t &diff) {
+				for (; mod != positions.end() && mod->position - diff + mod->removed_range <= pos; ++mod) {
+					diff += mod->added_range - mod->removed_range;
+				}
+				if (mod != positions.end() && mod->position - diff < pos) {
+					return mod->position + mod->added_range;
+				}
+				return pos + diff;
+			};
+			// the differences may overflow, similar to the non-regex case
+			auto begin_mod = positions.begin(), end_mod = positions.begin();
+			std::size_t begin_diff = 0, end_diff = 0;
 			for (auto [beg, end] : _results) {
-				mod->decorations.insert_range_after(beg, end - beg, { .renderer = rend });
+				old_results.emplace_back(
+					map_position(beg, begin_mod, begin_diff), map_position(end, end_mod, end_diff)
+				);
+			}
+		}
+
+		// the old search was looking for the next match at positions that are not strictly inside an old result.
+		// if the new search is also looking for a match at such a position, and no attempt after it is affected
+		// by the edits, all old results after it are still valid. this function finds the first such position
+		// starting from the given position, discarding all old results and windows before it
+		auto old_result = old_results.begin();
+		auto window = windows.begin();
+		auto find_resync_position = [&](std::size_t pos) {
+			while (true) {
+				if (old_result != old_results.end() && old_result->first < pos) {
+					pos = std::max(pos, old_result->second);
+					++old_result;
+				} else if (window != windows.end() && window->first <= pos) {
+					pos = std::max(pos, window->second);
+					++window;
+				} else {
+					return pos;
+				}
+			}
+		};
+
+		std::vector<std::pair<std::size_t, std::size_t>> results;
+		std::vector<std::pair<std::size_t, std::size_t>> regions; // regions where results may have changed
+		_regex_matcher matcher;
+		while (window != windows.end()) {
+			std::size_t region_begin = window->first;
+			for (; old_result != old_results.end() && old_result->first < region_begin; ++old_result) {
+				results.emplace_back(*old_result);
+			}
+			// resume matching after the last result before this region
+			std::size_t resume = region_begin;
+			bool reject_empty = false;
+			if (!results.empty() && results.back().second >= resume) {
+				resume = results.back().second;
+				reject_empty = results.back().first == results.back().second;
+			}
+			std::size_t resync = find_resync_position(region_begin);
+
+			std::optional<std::size_t> resume_codepoint;
+			while (true) {
+				// matches that start before the resync position never examine text past this limit
+				std::size_t limit = resync + reach;
+				if (limit - region_begin > maximum_incremental_search_length) {
+					return false;
+				}
+
+				linebreak_registry::position_converter
+					begin_converter(doc.get_linebreaks()), end_converter(doc.get_linebreaks());
+				std::size_t begin_cp = resume_codepoint.value_or(begin_converter.character_to_codepoint(resume));
+				interpretation::codepoint_position_converter byte_converter(doc);
+				std::size_t begin_byte = byte_converter.codepoint_to_byte(begin_cp);
+				std::size_t end_byte =
+					limit < num_chars ?
+					byte_converter.codepoint_to_byte(end_converter.character_to_codepoint(limit)) :
+					doc.get_buffer().length();
+				begin_converter.reset();
+				end_converter.reset();
+
+				buffer_input_stream stream(doc, begin_cp, begin_byte, end_byte);
+				resume_codepoint.reset();
+				while (auto res = matcher.find_next(stream, _match->regex.value(), reject_empty)) {
+					const auto &match = res->captures[0];
+					std::size_t
+						begin = begin_converter.codepoint_to_character(match.begin.codepoint_position()),
+						end = end_converter.codepoint_to_character(match.begin.codepoint_position() + match.length);
+					if (begin >= resync) { // the results line up again
+						break;
+					}
+					results.emplace_back(begin, end);
+					if (end > resync) {
+						resync = find_resync_position(end);
+						if (resync + reach > limit) { // continue with a longer stream
+							resume_codepoint.emplace(stream.codepoint_position());
+							break;
+						}
+					}
+				}
+				if (!resume_codepoint) {
+					break;
+				}
+			}
+			regions.emplace_back(region_begin, resync);
+		}
+		results.insert(results.end(), old_result, old_results.end());
+
+		_results = std::move(results);
+		if (_result_list) {
+			static_cast<_match_result_source*>(_result_list->get_source())->on_items_changed();
+		}
+		// decorations of removed results have been adjusted by the contents_region to lie within these regions
+		for (auto [beg, end] : regions) {
+			_decoration_token.modify()->decorations.erase_ranges_within(beg, end);
+			auto first = std::lower_bound(
+				_results.begin(), _results.end(), std::pair<std::size_t, std::size_t>(beg, 0)
+			);
+			auto last = first;
+			for (; last != _results.end() && last->second <= end; ++last) {
 			}
+			_add_decorations({ first, last });
+		}
+		return true;
+	}
+
+	std::shared_ptr<search_panel::_match_context> search_panel::_compile_regex(std::u8string_view pattern) {
+		using _stream_t = regex::basic_input_stream<encodings::utf8, const std::byte*>;
+
+		bool error = false;
+		regex::parser<_stream_t> parser([&error](const _stream_t &s, std::u8string_view msg) {
+			logger::get().log_warning() <<
+				"error in search regex at codepoint " << s.codepoint_position() << ": " << msg;
+			error = true;
+		});
+		auto *data = reinterpret_cast<const std::byte*>(pattern.data());
+		regex::ast ast = parser.parse(_stream_t(data, data + pattern.size()), regex::options());
+		if (error) {
+			return nullptr;
+		}
+		regex::ast::analysis analysis = ast.analyze();
+		std::optional<std::size_t> reach;
+		std::size_t max_length = analysis.get_for(ast.root()).maximum_length;
+		if (
+			max_length <= std::numeric_limits<std::size_t>::max() - _details::regex_assertion_context &&
+			_details::is_regex_node_local(ast, ast.root())
+		) {
+			reach = max_length + _details::regex_assertion_context;
 		}
+		regex::compiler compiler;
+		return std::make_shared<_match_context>(
+			compiler.compile(ast, analysis).finalize<_regex_data_types>(), reach
+		);
 	}
 
 	void search_panel::_clear_results() {
@@ -142,20 +686,22 @@ namespace codepad::editors::code {
 	}
 
 	void search_panel::_cancel_task() {
-		if (auto task = _task_token.get_task()) {
-			task->cancelled = true;
-			task->wait_finish();
+		if (_match) {
+			_match->cancelled = true;
 		}
-		if (_task_result_token) {
-			_task_result_token.cancel();
+		for (auto &tok : _task_tokens) {
+			if (auto task = tok.get_task()) {
+				task->wait_finish();
+			}
 		}
+		_task_tokens.clear();
 	}
 
 	void search_panel::_dispose() {
 		_cancel_task();
 		if (_interpretation) {
 			_interpretation->get_buffer().begin_edit -= _begin_edit_token;
-			_interpretation->get_buffer().end_edit -= _end_edit_token;
+			_interpretation->end_edit -= _end_edit_token;
 			_interpretation.reset();
 		}
 		ui::input_prompt::_dispose();
@@ -10,7 +10,9 @@
 
 namespace codepad::editors::code {
 	document_theme_provider_registry::provider_modifier::~provider_modifier() {
-		_interp.appearance_changed.construct_info_and_invoke(interpretation::appearance_change_type::layout_and_visual);
+		_interp.appearance_changed.construct_info_and_invoke(
+			interpretation::appearance_change_type::layout_and_visual, _changed_range
+		);
 	}
 
 
@@ -0,0 +1,153 @@
+// Copyright (c) the Codepad contributors. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See LICENSE.txt in the project root for license information.
+
+#include "codepad/editors/code/word_wrapping.h"
+
+/// \file
+/// Implementation of word wrapping.
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string_view>
+
+namespace codepad::editors::code {
+	word_wrapping_metrics::word_wrapping_metrics(const std::vector<std::shared_ptr<ui::font_family>> &families) {
+		std::vector<std::shared_ptr<ui::font>> fonts;
+		for (const auto &family : families) {
+			fonts.emplace_back(family->get_matching_font(
+				ui::font_style::normal, ui::font_weight::normal, ui::font_stretch::normal
+			));
+		}
+		// same as fragment_generator::_select_font()
+		auto measure = [&fonts](codepoint cp) {
+			for (const auto &font : fonts) {
+				if (font->has_character(cp)) {
+					return font->get_character_width_em(cp);
+				}
+			}
+			return fonts.empty() ? 0.0 : fonts[0]->get_character_width_em(cp);
+		};
+
+		_widths.resize(measured_codepoints);
+		for (codepoint cp = 0; cp < measured_codepoints; ++cp) {
+			_widths[cp] = measure(cp);
+		}
+		_wide_width = measure(0x4E00);
+		_fallback_width = _widths[U'M'];
+		for (char32_t digit : std::u32string_view(U"0123456789ABCDEF")) {
+			_hex_digit_width = std::max(_hex_digit_width, _widths[digit]);
+		}
+	}
+
+	double word_wrapping_metrics::get_invalid_codepoint_width_em(codepoint cp) const {
+		std::size_t digits = 1;
+		for (codepoint v = cp >> 4; v != 0; v >>= 4) {
+			++digits;
+		}
+		return
+			_widths[U'['] + _widths[U'0'] + _widths[U'x'] + _widths[U']'] +
+			static_cast<double>(digits) * _hex_digit_width;
+	}
+
+	namespace _details {
+		/// Computes soft linebreaks in the given range. \p width_of is called with the position and the codepoint
+		/// of each character that's not a tab or a linebreak, and returns its width.
+		template <typename WidthFunc> std::optional<std::vector<std::size_t>> compute_softbreaks(
+			const interpretation &interp, std::size_t beg, std::size_t end,
+			const word_wrapping_metrics::parameters &params, const std::atomic_bool *cancelled, WidthFunc &&width_of
+		) {
+			constexpr std::size_t _no_break = std::numeric_limits<std::size_t>::max();
+
+			std::vector<std::size_t> result;
+			double x = 0.0;
+			std::size_t
+				line_begin = beg, // the beginning of the current visual line
+				last_break = _no_break; // the last position on this visual line where it can be wrapped
+			double break_x = 0.0; // the horizontal position of last_break
+			std::size_t counter = 0;
+			auto it = interp.character_at(beg);
+			for (std::size_t pos = beg; pos < end; ++pos, it.next()) {
+				if (cancelled && ++counter == word_wrapping_metrics::cancellation_check_interval) {
+					if (*cancelled) {
+						return std::nullopt;
+					}
+					counter = 0;
+				}
+
+				if (it.is_linebreak()) {
+					x = 0.0;
+					line_begin = pos + 1;
+					last_break = _no_break;
+					continue;
+				}
+
+				double width;
+				bool whitespace = false;
+				if (!it.codepoint().is_codepoint_valid()) {
+					width = width_of(pos, it.codepoint());
+				} else {
+					codepoint cp = it.codepoint().get_codepoint();
+					if (cp == U'\t') {
+						width =
+							params.tab_width > 0.0 ?
+							(std::floor(x / params.tab_width) + 1.0) * params.tab_width - x :
+							0.0;
+					} else {
+						width = width_of(pos, it.codepoint());
+					}
+					whitespace = word_wrapping_metrics::is_whitespace(cp);
+					if (!whitespace && word_wrapping_metrics::is_wide_character(cp) && pos > line_begin) {
+						last_break = pos;
+						break_x = x;
+					}
+				}
+
+				// whitespace is allowed to extend past the right boundary
+				while (!whitespace && x + width > params.width && pos > line_begin) {
+					if (last_break == _no_break) { // no suitable position; break before this character
+						last_break = pos;
+						break_x = x;
+					}
+					result.emplace_back(last_break);
+					line_begin = last_break;
+					x -= break_x;
+					last_break = _no_break;
+				}
+
+				x += width;
+				if (whitespace) {
+					last_break = pos + 1;
+					break_x = x;
+				}
+			}
+			return result;
+		}
+	}
+
+	std::optional<std::vector<std::size_t>> word_wrapping_metrics::compute_softbreaks(
+		const interpretation &interp, std::size_t beg, std::size_t end, const parameters &params,
+		const std::atomic_bool *cancelled
+	) const {
+		return _details::compute_softbreaks(
+			interp, beg, end, params, cancelled,
+			[this, &params](std::size_t, const interpretation::codepoint_iterator &cp) {
+				if (!cp.is_codepoint_valid()) {
+					return get_invalid_codepoint_width_em(cp.get_codepoint()) * params.font_size;
+				}
+				return get_character_width_em(cp.get_codepoint()) * params.font_size;
+			}
+		);
+	}
+
+	std::vector<std::size_t> word_wrapping_metrics::compute_softbreaks_with_widths(
+		const interpretation &interp, std::size_t beg, const std::vector<double> &widths, const parameters &params
+	) {
+		return _details::compute_softbreaks(
+			interp, beg, beg + widths.size(), params, nullptr,
+			[beg, &widths](std::size_t pos, const interpretation::codepoint_iterator&) {
+				return widths[pos - beg];
+			}
+		).value();
+	}
+}
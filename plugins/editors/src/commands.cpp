@@ -21,7 +21,7 @@ namespace codepad::editors::_details {
 	ui::tabs::tab *_open_file_with_encoding(
 		const std::filesystem::path &file, ui::tabs::host &host, std::u8string_view encoding
 	) {
-		auto ctx = get_manager().buffers.open_file(file);
+		auto ctx = get_manager().buffers.open_file(file, get_manager().get_file_load_mode());
 		if (auto *lang = get_manager().get_language_for_file(file)) {
 			ctx->set_language(*lang);
 		}
@@ -49,7 +49,7 @@ namespace codepad::editors::_details {
 	}
 	/// Opens the specified file as binary in a tab, and adds the tab to the given \ref ui::tabs::host.
 	ui::tabs::tab *_open_binary_file(const std::filesystem::path &file, ui::tabs::host &host) {
-		auto ctx = get_manager().buffers.open_file(file);
+		auto ctx = get_manager().buffers.open_file(file, get_manager().get_file_load_mode());
 		if (auto *lang = get_manager().get_language_for_file(file)) {
 			ctx->set_language(*lang);
 		}
@@ -248,6 +248,14 @@ namespace codepad::editors::_details {
 				}
 				)
 		);
+		result.emplace_back(
+			u8"code_search_panel.toggle_regex",
+			ui::command_registry::convert_type<code::search_panel>(
+				[&](code::search_panel &p, const json::value_storage&) {
+					p.set_regex_mode(!p.is_regex_mode());
+				}
+				)
+		);
 
 
 		// TODO options to not use the default encoding
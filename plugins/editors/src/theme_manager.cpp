@@ -111,6 +111,25 @@ namespace codepad::editors {
 			settings::basic_parsers::basic_type_with_default<theme_configuration>(
 				theme_configuration(), ui::managed_json_parser<theme_configuration>(man)
 			)
-		)) {
+		)), _manager(man) {
+	}
+
+	std::shared_ptr<theme_configuration> theme_manager::get_theme_for_language(std::u8string_view lang) {
+		std::size_t timestamp = _manager.get_settings().get_timestamp();
+		if (timestamp != _timestamp) { // settings have changed, discard all cached themes
+			_themes.clear();
+			_timestamp = timestamp;
+		}
+		auto [it, inserted] = _themes.emplace(lang, nullptr);
+		if (inserted) {
+			std::vector<std::u8string_view> profile;
+			split_string(U'.', lang, [&profile](std::u8string_view s) {
+				profile.emplace_back(s);
+			});
+			it->second = std::make_shared<theme_configuration>(
+				_setting->get_value(profile.begin(), profile.end())
+			);
+		}
+		return it->second;
 	}
 }
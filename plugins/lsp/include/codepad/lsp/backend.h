@@ -6,14 +6,80 @@
 /// \file
 /// Declaration of a general LSP backend used for sending and receiving messages.
 
+#include <array>
 #include <sstream>
 #include <deque>
 
-#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
 
 #include "types/serialization.h"
 
 namespace codepad::lsp {
+	/// A RapidJSON writer that can also write strings that are produced piece by piece, so that large strings such
+	/// as the contents of a document never need to be held in memory as a whole.
+	template <typename Stream> class json_writer : public rapidjson::Writer<Stream> {
+	public:
+		using rapidjson::Writer<Stream>::Writer;
+
+		/// Writes a string value. \p produce is called with a function that it should call with every piece of the
+		/// string in order; each piece is escaped and written to the stream directly. This can only be used for
+		/// values inside objects or arrays.
+		template <typename Producer> bool StringPieces(Producer &&produce) {
+			this->Prefix(rapidjson::kStringType);
+			this->os_->Put('"');
+			produce([this](std::u8string_view piece) {
+				_put_escaped(piece);
+			});
+			this->os_->Put('"');
+			return true;
+		}
+	protected:
+		/// Writes the given string to the stream, escaping characters the same way RapidJSON does.
+		void _put_escaped(std::u8string_view str) {
+			constexpr static char _hex_digits[] = "0123456789ABCDEF";
+			for (char8_t c : str) {
+				char escaped = 0;
+				switch (c) {
+				case u8'"':
+					escaped = '"';
+					break;
+				case u8'\\':
+					escaped = '\\';
+					break;
+				case u8'\b':
+					escaped = 'b';
+					break;
+				case u8'\f':
+					escaped = 'f';
+					break;
+				case u8'\n':
+					escaped = 'n';
+					break;
+				case u8'\r':
+					escaped = 'r';
+					break;
+				case u8'\t':
+					escaped = 't';
+					break;
+				default:
+					if (c < 0x20) {
+						this->os_->Put('\\');
+						this->os_->Put('u');
+						this->os_->Put('0');
+						this->os_->Put('0');
+						this->os_->Put(_hex_digits[c >> 4]);
+						this->os_->Put(_hex_digits[c & 0xF]);
+					} else {
+						this->os_->Put(static_cast<char>(c));
+					}
+					continue;
+				}
+				this->os_->Put('\\');
+				this->os_->Put(escaped);
+			}
+		}
+	};
+
 	/// A backend used to communicate with LSP servers.
 	class backend {
 	public:
@@ -22,11 +88,7 @@ namespace codepad::lsp {
 
 		/// Prepends a header to the JSON message and sends it to the server.
 		void send_message(std::u8string_view json_data) {
-			std::ostringstream ss;
-			ss << "Content-Length: " << json_data.size() << "\r\n\r\n";
-			std::string s = ss.str();
-
-			_send_bytes(s.data(), s.size());
+			_send_header(json_data.size());
 			_send_bytes(json_data.data(), json_data.size());
 		}
 		/// Receives a message. This function blocks until a message has been received.
@@ -69,44 +131,71 @@ namespace codepad::lsp {
 
 
 		/// Sends a request or a notification. Whether it's a request or a notification depends on the \p id
-		/// parameter.
+		/// parameter. \p send is either a struct that's serialized as the parameters, or a function that writes
+		/// the parameters using the \ref json_writer it's given. The message is written twice: once to a stream
+		/// that only counts its length, and once more to stream it directly to the server, so that the full message
+		/// is never held in memory.
 		template <typename Id, typename Send> void send_message(
 			std::u8string_view method, Send &send, Id &&id
 		) {
-			// compose message
-			rapidjson::StringBuffer stream;
-			rapidjson::Writer<rapidjson::StringBuffer> writer(stream);
-			writer.StartObject();
+			_counting_stream counter;
 			{
-				writer.Key("jsonrpc");
-				writer.String("2.0");
+				json_writer<_counting_stream> writer(counter);
+				_write_message(writer, method, send, id);
+			}
+			_send_header(counter.length);
 
-				if constexpr (!std::is_same_v<std::decay_t<Id>, std::nullopt_t>) {
-					writer.Key("id");
-					if constexpr (std::is_integral_v<std::decay_t<Id>>) {
-						writer.Int(id);
-					} else {
-						writer.String(reinterpret_cast<const char*>(id.data()), id.size());
-					}
-				}
+			_sending_stream stream(*this);
+			{
+				json_writer<_sending_stream> writer(stream);
+				_write_message(writer, method, send, id);
+			}
+			stream.Flush();
+		}
+	protected:
+		/// A RapidJSON output stream that only counts the number of bytes written to it.
+		struct _counting_stream {
+			using Ch = char; ///< Character type.
 
-				writer.Key("method");
-				writer.String(
-					reinterpret_cast<const char*>(method.data()),
-					static_cast<rapidjson::SizeType>(method.size())
-				);
+			/// Increments \ref length.
+			void Put(Ch) {
+				++length;
+			}
+			/// Does nothing.
+			void Flush() {
+			}
 
-				if constexpr (!std::is_same_v<std::remove_cv_t<Send>, std::nullopt_t>) {
-					writer.Key("params");
-					types::serializer<rapidjson::StringBuffer> sr(writer);
-					sr.visit(send);
+			std::size_t length = 0; ///< The number of bytes written to this stream.
+		};
+		/// A RapidJSON output stream that accumulates bytes in a small buffer and sends them to the server using
+		/// \ref _send_bytes() whenever the buffer is full.
+		struct _sending_stream {
+			using Ch = char; ///< Character type.
+
+			/// Initializes \ref target.
+			explicit _sending_stream(backend &b) : target(b) {
+			}
+
+			/// Appends a byte to the buffer, sending the buffer if it's full.
+			void Put(Ch c) {
+				if (size == buffer.size()) {
+					Flush();
 				}
+				buffer[size++] = c;
 			}
-			writer.EndObject();
-			// send message
-			send_message(std::u8string_view(reinterpret_cast<const char8_t*>(stream.GetString()), stream.GetSize()));
-		}
-	protected:
+			/// Sends all buffered bytes.
+			void Flush() {
+				if (size > 0) {
+					target._send_bytes(buffer.data(), size);
+					size = 0;
+				}
+			}
+
+			std::array<char, 8192> buffer; ///< Bytes that have not been sent.
+			std::size_t size = 0; ///< The number of bytes in \ref buffer.
+			backend &target; ///< The backend.
+		};
+
 		std::vector<char> _read_buffer; ///< Caches bytes that have been read.
 		std::size_t _offset = 0; /// Offset of the current position in \ref _read_buffer.
 
@@ -152,6 +241,49 @@ namespace codepad::lsp {
 			return result;
 		}
 
+		/// Sends the \p Content-Length header for a message with the given length.
+		void _send_header(std::size_t length) {
+			std::ostringstream ss;
+			ss << "Content-Length: " << length << "\r\n\r\n";
+			std::string s = ss.str();
+			_send_bytes(s.data(), s.size());
+		}
+		/// Writes a request or a notification using the given writer.
+		template <typename Stream, typename Id, typename Send> inline static void _write_message(
+			json_writer<Stream> &writer, std::u8string_view method, Send &send, Id &id
+		) {
+			writer.StartObject();
+			{
+				writer.Key("jsonrpc");
+				writer.String("2.0");
+
+				if constexpr (!std::is_same_v<std::decay_t<Id>, std::nullopt_t>) {
+					writer.Key("id");
+					if constexpr (std::is_integral_v<std::decay_t<Id>>) {
+						writer.Int(id);
+					} else {
+						writer.String(reinterpret_cast<const char*>(id.data()), id.size());
+					}
+				}
+
+				writer.Key("method");
+				writer.String(
+					reinterpret_cast<const char*>(method.data()),
+					static_cast<rapidjson::SizeType>(method.size())
+				);
+
+				if constexpr (std::is_invocable_v<Send&, json_writer<Stream>&>) {
+					writer.Key("params");
+					send(writer);
+				} else if constexpr (!std::is_same_v<std::remove_cv_t<Send>, std::nullopt_t>) {
+					writer.Key("params");
+					types::serializer<Stream> sr(writer);
+					sr.visit(send);
+				}
+			}
+			writer.EndObject();
+		}
+
 		/// Sends the given bytes to the server.
 		virtual void _send_bytes(const void*, std::size_t) = 0;
 		/// Receives bytes from the server. Blocks until any bytes are received. This function may be called from
@@ -18,6 +18,7 @@
 #include "types/workspace.h"
 #include "backend.h"
 #include "manager.h"
+#include "semantic_tokens.h"
 #include "uri.h"
 
 namespace codepad::lsp {
@@ -206,6 +207,13 @@ namespace codepad::lsp {
 			return _manager;
 		}
 
+		/// Returns the cached \ref semantic_token_theme_mapping for the given language. The mapping is recreated
+		/// if it has not been created for the given legend and theme, i.e., when the theme has been changed.
+		[[nodiscard]] semantic_token_theme_mapping &get_semantic_token_theme_mapping(
+			std::u8string_view language, const types::SemanticTokensLegend&,
+			std::shared_ptr<editors::theme_configuration>
+		);
+
 
 		/// The default error handler that simply prints the error code and message. Simly logs the error.
 		inline static void default_error_handler(
@@ -226,6 +234,11 @@ namespace codepad::lsp {
 		/// Request index of the \p shutdown message, used by the receiver thread to determine when to exit.
 		std::atomic<types::integer> _shutdown_message_id = -1;
 
+		/// Cached semantic token theme mappings for all languages.
+		std::unordered_map<
+			std::u8string, semantic_token_theme_mapping, string_hash<>, std::equal_to<>
+		> _semantic_token_themes;
+
 		manager &_manager; ///< The \ref manager that contains settings for the LSP plugin.
 
 
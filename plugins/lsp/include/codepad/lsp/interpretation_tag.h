@@ -11,6 +11,7 @@
 #include <codepad/editors/buffer.h>
 #include <codepad/editors/manager.h>
 #include <codepad/editors/code/interpretation.h>
+#include <codepad/editors/code/contents_region.h>
 
 #include "client.h"
 #include "types/diagnostics.h"
@@ -142,26 +143,26 @@ namespace codepad::lsp {
 				tokenType = 0, ///< Token type.
 				tokenModifiers = 0; ///< Token modifiers.
 
-			/// Iterates over the range of numbers and generates \ref semantic_token objects. If the array length is
-			/// not a multiple of 5, an error message will be logged and the excess part is discarded.
-			template <typename Callback> static void iterate_over_range(
-				const std::vector<types::uinteger> &arr, Callback &&cb
-			) {
+			/// Returns the number of tokens in the given array. If the array length is not a multiple of 5, an error
+			/// message will be logged and the excess part is discarded.
+			[[nodiscard]] static std::size_t count(const std::vector<types::uinteger> &arr) {
 				if (arr.size() % 5 != 0) {
 					logger::get().log_error() << "semantic token array size is not a multiple of 5";
 				}
-				for (std::size_t i = 0; i + 4 < arr.size(); i += 5) {
-					_semantic_token tok;
-					tok.deltaLine = arr[i];
-					tok.deltaStart = arr[i + 1];
-					tok.length = arr[i + 2];
-					tok.tokenType = arr[i + 3];
-					tok.tokenModifiers = arr[i + 4];
-					cb(tok);
-				}
+				return arr.size() / 5;
+			}
+			/// Returns the token at the given index in the array.
+			[[nodiscard]] static _semantic_token at(const std::vector<types::uinteger> &arr, std::size_t index) {
+				_semantic_token tok;
+				std::size_t i = index * 5;
+				tok.deltaLine = arr[i];
+				tok.deltaStart = arr[i + 1];
+				tok.length = arr[i + 2];
+				tok.tokenType = arr[i + 3];
+				tok.tokenModifiers = arr[i + 4];
+				return tok;
 			}
 		};
-
 		/// Token used to listen to \ref editors::buffer::begin_edit.
 		info_event<editors::buffer::begin_edit_info>::token _begin_edit_token;
 		/// Token used to listen to \ref editors::code::interpretation::end_modification.
@@ -186,6 +187,14 @@ namespace codepad::lsp {
 		/// Number of versions of this interpretation that has been queued for highlighting. Highlights should only
 		/// be applied when it'll be applied to the newest version.
 		std::size_t _queued_highlight_version = 0;
+		/// Similar to \ref _queued_highlight_version, but for \p semanticTokens/range requests.
+		std::size_t _queued_range_highlight_version = 0;
+		/// The semantic tokens in the last \p semanticTokens/full or \p semanticTokens/full/delta result that has
+		/// been applied. This is used to apply later deltas.
+		std::vector<types::uinteger> _semantic_tokens;
+		/// The \p resultId of the last applied semantic tokens result. Deltas are only requested when this is not
+		/// empty.
+		types::string _semantic_tokens_result_id;
 		editors::code::interpretation *_interp = nullptr; ///< The \ref interpretation this tag is associated with.
 		client *_client = nullptr; ///< The client responsible for this document.
 
@@ -197,6 +206,25 @@ namespace codepad::lsp {
 		}
 
 
+		/// Calls the given function with consecutive pieces of the contents of the document between the two
+		/// iterators, which must be on codepoint boundaries, encoded as UTF-8. Invalid codepoints are replaced by
+		/// \ref unicode::replacement_character. If the document is encoded in UTF-8, valid sequences are passed
+		/// directly from the chunks of the buffer and only invalid sequences are re-encoded.
+		void _for_each_utf8_piece(
+			editors::buffer::const_iterator, const editors::buffer::const_iterator&,
+			const std::function<void(std::u8string_view)>&
+		) const;
+		/// Appends the contents of the document between the two iterators to the string as UTF-8 using
+		/// \ref _for_each_utf8_piece().
+		void _append_text_utf8(
+			types::string &text, editors::buffer::const_iterator beg, const editors::buffer::const_iterator &end
+		) const {
+			_for_each_utf8_piece(std::move(beg), end, [&text](std::u8string_view piece) {
+				text.append(piece);
+			});
+		}
+
+
 		// handles for document events
 		/// Handler for \ref editors::buffer::begin_edit.
 		void _on_begin_edit(editors::buffer::begin_edit_info&) {
@@ -220,11 +248,40 @@ namespace codepad::lsp {
 			params.textDocument.uri = _change_params.textDocument.uri;
 			_client->send_notification(u8"textDocument/didClose", params);
 		}
-		/// Sends the \p textDocument/semanticTokens/full request.
-		void _send_semanticTokens_full();
+		/// Sends the \p textDocument/semanticTokens/full/delta request if the server supports it and a previous
+		/// result is available, and the \p textDocument/semanticTokens/full request otherwise.
+		void _send_semanticTokens();
+		/// Sends the \p textDocument/semanticTokens/range request for all lines visible in the given
+		/// \ref editors::code::contents_region.
+		void _send_semanticTokens_range(const editors::code::contents_region&);
 
 		// handlers for LSP messages
-		/// Handler for the response of \p semanticTokens.
+		/// Handler for the response of \p semanticTokens/full. Replaces all highlights.
 		void _on_semanticTokens(types::SemanticTokensResponse);
+		/// Handler for the response of \p semanticTokens/full/delta. Only updates highlights of tokens that have
+		/// changed.
+		void _on_semanticTokens_delta(types::SemanticTokensDeltaResponse);
+		/// Handler for the response of \p semanticTokens/range. Replaces highlights between the given characters.
+		void _on_semanticTokens_range(types::SemanticTokensResponse, std::size_t begin, std::size_t end);
+
+		/// Replaces all highlights using the given \ref types::SemanticTokens, and stores it for later deltas.
+		void _apply_full_semantic_tokens(types::SemanticTokens);
+		/// Decodes tokens in the given array and invokes the callback for each token from the token at
+		/// \p first to the token before \p past_last. The callback receives the index of the token, the range
+		/// of characters it spans, and its type and modifiers.
+		template <typename Callback> void _decode_semantic_tokens(
+			const std::vector<types::uinteger>&, std::size_t first, std::size_t past_last, Callback&&
+		) const;
+
+		/// Returns the \ref types::SemanticTokensOptions of the server, or \p nullptr if the server does not
+		/// support semantic tokens.
+		[[nodiscard]] const types::SemanticTokensOptions *_get_semantic_tokens_options() const;
+		/// Returns whether the server supports \p semanticTokens/full/delta requests.
+		[[nodiscard]] bool _supports_semantic_tokens_delta() const;
+		/// Returns whether the server supports \p semanticTokens/range requests.
+		[[nodiscard]] bool _supports_semantic_tokens_range() const;
+		/// Returns the cached \ref semantic_token_theme_mapping for this document from \ref _client. The server must
+		/// support semantic tokens.
+		[[nodiscard]] semantic_token_theme_mapping &_get_semantic_token_theme_mapping() const;
 	};
 }
@@ -0,0 +1,71 @@
+// Copyright (c) the Codepad contributors. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+/// \file
+/// Utilities for semantic tokens.
+
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <codepad/editors/theme_manager.h>
+
+#include "types/language_features.h"
+
+namespace codepad::lsp {
+	/// Maps combinations of semantic token types and modifiers to \ref editors::text_theme objects. Results are
+	/// cached since only a few combinations are used in practice. Tokens without modifiers, which are by far the
+	/// most common, are looked up in a flat array indexed by the token type.
+	class semantic_token_theme_mapping {
+	public:
+		/// Initializes \ref _legend and \ref _theme.
+		semantic_token_theme_mapping(
+			const types::SemanticTokensLegend &legend, std::shared_ptr<editors::theme_configuration> theme
+		) : _legend(&legend), _theme(std::move(theme)) {
+			_plain.resize(_legend->tokenTypes.value.size());
+		}
+
+		/// Returns the theme for the given token type and modifiers, or \p std::nullopt if there's none.
+		[[nodiscard]] const std::optional<editors::text_theme> &get(types::uinteger type, types::uinteger mods) {
+			if (mods == 0 && type < _plain.size()) {
+				_entry &ent = _plain[type];
+				if (!ent.resolved) {
+					ent.theme = _compute(type, mods);
+					ent.resolved = true;
+				}
+				return ent.theme;
+			}
+			std::uint64_t key = (static_cast<std::uint64_t>(type) << 32) | mods;
+			auto [it, inserted] = _combined.try_emplace(key, std::nullopt);
+			if (inserted) {
+				it->second = _compute(type, mods);
+			}
+			return it->second;
+		}
+
+		/// Returns whether this mapping has been created for the given legend and theme.
+		[[nodiscard]] bool is_for(
+			const types::SemanticTokensLegend &legend, const std::shared_ptr<editors::theme_configuration> &theme
+		) const {
+			return _legend == &legend && _theme == theme;
+		}
+	protected:
+		/// A cached entry for a token type without modifiers.
+		struct _entry {
+			std::optional<editors::text_theme> theme; ///< The theme.
+			bool resolved = false; ///< Whether \ref theme has been computed.
+		};
+
+		std::vector<_entry> _plain; ///< Cached results for tokens without modifiers, indexed by token type.
+		/// Cached results for tokens with modifiers, indexed by the type and the modifiers.
+		std::unordered_map<std::uint64_t, std::optional<editors::text_theme>> _combined;
+		const types::SemanticTokensLegend *_legend = nullptr; ///< The legend of the server.
+		std::shared_ptr<editors::theme_configuration> _theme; ///< The theme of the document's language.
+
+		/// Looks up the theme for the given token type and modifiers.
+		[[nodiscard]] std::optional<editors::text_theme> _compute(types::uinteger type, types::uinteger mods) const;
+	};
+}
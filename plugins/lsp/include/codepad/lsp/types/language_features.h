@@ -609,9 +609,13 @@ namespace codepad::lsp::types {
 
 		void visit_fields(visitor_base&) override;
 	};
+	/// Used by \ref SemanticTokensRequestsClientCapabilities. This object has no fields.
+	struct SemanticTokensRangeRequestsClientCapabilities : public virtual object {
+		void visit_fields(visitor_base&) override;
+	};
 	/// Used by \ref SemanticTokensClientCapabilities.
 	struct SemanticTokensRequestsClientCapabilities : public virtual object {
-		// TODO range
+		optional<primitive_variant<boolean, SemanticTokensRangeRequestsClientCapabilities>> range;
 		optional<primitive_variant<boolean, SemanticTokensFullRequestsClientCapabilities>> full;
 
 		void visit_fields(visitor_base&) override;
@@ -630,7 +634,7 @@ namespace codepad::lsp::types {
 
 	struct SemanticTokensOptions : public virtual WorkDoneProgressOptions {
 		SemanticTokensLegend legend;
-		// TODO range
+		optional<primitive_variant<boolean, SemanticTokensRangeRequestsClientCapabilities>> range;
 		optional<primitive_variant<boolean, SemanticTokensFullRequestsClientCapabilities>> full;
 
 		void visit_fields(visitor_base&) override;
@@ -690,6 +694,36 @@ namespace codepad::lsp::types {
 		void visit_fields(visitor_base&) override;
 	};
 
+	/// Response of the \p textDocument/semanticTokens/full/delta request. The server may reply with either a full
+	/// \ref SemanticTokens object or a \ref SemanticTokensDelta.
+	struct SemanticTokensDeltaResponse : public custom_variant_base {
+		/// Deduces the type of this variant. If it's an object, this function checks for the field \p edits which
+		/// indicates that this should be a \ref SemanticTokensDelta.
+		void deduce_type_and_visit(visitor_base &v, const json::value_t &json_val) override {
+			if (auto obj = json_val.try_cast<json::object_t>()) {
+				if (auto edits = obj->find_member(u8"edits"); edits != obj->member_end()) {
+					v.visit(value.emplace<SemanticTokensDelta>());
+				} else {
+					v.visit(value.emplace<SemanticTokens>());
+				}
+			} else if (json_val.is<json::null_t>()) {
+				v.visit(value.emplace<null>());
+			} else { // error
+				logger::get().log_error() << "invalid JSON for semanticTokens/full/delta response";
+			}
+		}
+		/// Calls \p std::visit().
+		void visit_value(visitor_base &v) override {
+			std::visit(
+				[&v](auto &&val) {
+					v.visit(val);
+				}, value
+			);
+		}
+
+		std::variant<null, SemanticTokens, SemanticTokensDelta> value; ///< The value of this variant.
+	};
+
 	struct SemanticTokensDeltaPartialResult : public virtual object {
 		array<SemanticTokensEdit> edits;
 
@@ -37,6 +37,21 @@ namespace codepad::lsp {
 		}
 	}
 
+	semantic_token_theme_mapping &client::get_semantic_token_theme_mapping(
+		std::u8string_view language, const types::SemanticTokensLegend &legend,
+		std::shared_ptr<editors::theme_configuration> theme
+	) {
+		auto it = _semantic_token_themes.find(language);
+		if (it == _semantic_token_themes.end()) {
+			it = _semantic_token_themes.emplace(
+				std::u8string(language), semantic_token_theme_mapping(legend, std::move(theme))
+			).first;
+		} else if (!it->second.is_for(legend, theme)) {
+			it->second = semantic_token_theme_mapping(legend, std::move(theme));
+		}
+		return it->second;
+	}
+
 	void client::_receiver_thread(client &c, ui::scheduler &sched) {
 		while (true) {
 			// receive & parse message
@@ -6,6 +6,8 @@
 /// \file
 /// Implementation of \ref codepad::lsp::interpretation_tag.
 
+#include <algorithm>
+
 #include <codepad/ui/elements/label.h>
 #include <codepad/ui/elements/stack_panel.h>
 #include <codepad/ui/elements/text_edit.h>
@@ -161,7 +163,7 @@ namespace codepad::lsp {
 		// send the requests if the client is ready
 		if (_client->get_state() == client::state::ready) {
 			_send_didOpen();
-			_send_semanticTokens_full();
+			_send_semanticTokens();
 		}
 	}
 
@@ -188,29 +190,89 @@ namespace codepad::lsp {
 		range.start = types::Position(start_pos.line, start_pos.position_in_line);
 		// end of range
 		range.end = types::Position(info.erase_end_line, info.erase_end_column);
-		// decode new text
-		std::size_t current_codepoint = start_cp;
-		for (
-			auto iter = _interp->codepoint_at(start_cp);
-			current_codepoint < end_cp;
-			iter.next(), ++current_codepoint
-		) {
-			codepoint cp =
-				iter.is_codepoint_valid() ?
-				iter.get_codepoint() :
-				unicode::replacement_character;
-			change.text += encodings::utf8::encode_codepoint_u8(cp);
+		// new text
+		editors::code::interpretation::codepoint_position_converter conv(*_interp);
+		const editors::buffer &buf = _interp->get_buffer();
+		std::size_t start_byte = conv.codepoint_to_byte(start_cp), end_byte = conv.codepoint_to_byte(end_cp);
+		_append_text_utf8(change.text, buf.at(start_byte), buf.at(end_byte));
+	}
+
+	void interpretation_tag::_for_each_utf8_piece(
+		editors::buffer::const_iterator beg, const editors::buffer::const_iterator &end,
+		const std::function<void(std::u8string_view)> &callback
+	) const {
+		const editors::code::buffer_encoding &encoding = *_interp->get_encoding();
+		if (encoding.get_name() != encodings::utf8::get_name()) { // decode & re-encode all codepoints
+			constexpr static std::size_t _piece_size = 4096;
+			types::string piece;
+			while (beg != end) {
+				codepoint cp;
+				if (!encoding.next_codepoint(beg, end, cp)) {
+					cp = unicode::replacement_character;
+				}
+				piece += encodings::utf8::encode_codepoint_u8(cp);
+				if (piece.size() >= _piece_size) {
+					callback(piece);
+					piece.clear();
+				}
+			}
+			if (!piece.empty()) {
+				callback(piece);
+			}
+			return;
+		}
+
+		// pass valid sequences directly from the chunks, and only re-encode invalid ones
+		editors::buffer::chunk_reader reader(_interp->get_buffer());
+		const std::size_t end_pos = end.get_position();
+		std::size_t pos = beg.get_position();
+		while (pos < end_pos) {
+			auto [chunk_beg, chunk_end] = reader.read(pos);
+			chunk_end = chunk_beg + std::min(static_cast<std::size_t>(chunk_end - chunk_beg), end_pos - pos);
+			const std::byte *it = chunk_beg;
+			while (it != chunk_end) {
+				const std::byte *cp_beg = it;
+				if (*it < std::byte(0x80)) {
+					++it;
+				} else if (!encodings::utf8::next_codepoint(it, chunk_end)) {
+					it = cp_beg;
+					break;
+				}
+			}
+			if (it != chunk_beg) {
+				callback(std::u8string_view(
+					reinterpret_cast<const char8_t*>(chunk_beg), static_cast<std::size_t>(it - chunk_beg)
+				));
+				pos += static_cast<std::size_t>(it - chunk_beg);
+			}
+			if (it != chunk_end) {
+				// an invalid sequence, or one that continues in the next chunk
+				editors::buffer::const_iterator cp_it = _interp->get_buffer().at(pos);
+				codepoint cp;
+				if (!encoding.next_codepoint(cp_it, end, cp)) {
+					cp = unicode::replacement_character;
+				}
+				callback(encodings::utf8::encode_codepoint_u8(cp));
+				pos = cp_it.get_position();
+			}
 		}
 	}
 
-	void interpretation_tag::_on_end_edit(editors::buffer::end_edit_info&) {
+	void interpretation_tag::_on_end_edit(editors::buffer::end_edit_info &info) {
 		if (_client->get_state() == client::state::ready) {
 			// "The version number points to the version after all provided content changes have been applied."
 			++_change_params.textDocument.version;
 			_client->send_notification(u8"textDocument/didChange", _change_params);
 			_change_params.contentChanges.value.clear();
 
-			_send_semanticTokens_full();
+			// if the server can't send deltas, quickly highlight the part of the document visible in the editor
+			// that made the edit before highlighting the entire document
+			if (_supports_semantic_tokens_range() && !_supports_semantic_tokens_delta()) {
+				if (auto *region = dynamic_cast<editors::code::contents_region*>(info.source_element)) {
+					_send_semanticTokens_range(*region);
+				}
+			}
+			_send_semanticTokens();
 		}
 	}
 
@@ -225,39 +287,111 @@ namespace codepad::lsp {
 	}
 
 	void interpretation_tag::_send_didOpen() {
-		// send didOpen
-		types::DidOpenTextDocumentParams didopen;
-		didopen.textDocument.version = _change_params.textDocument.version;
-		didopen.textDocument.uri = _change_params.textDocument.uri;
-		didopen.textDocument.languageId = _interp->get_buffer().get_language().back();
-		// encode document as utf8
-		types::string text;
-		text.reserve(_interp->get_buffer().length());
-		for (auto iter = _interp->codepoint_begin(); !iter.ended(); iter.next()) {
-			codepoint cp = iter.is_codepoint_valid() ? iter.get_codepoint() : unicode::replacement_character;
-			text += encodings::utf8::encode_codepoint_u8(cp);
-		}
-		didopen.textDocument.text = std::move(text);
-		_client->send_notification(u8"textDocument/didOpen", didopen);
+		// send didOpen; the text is written directly from the buffer instead of through a DidOpenTextDocumentParams
+		// so that the document is never copied as a whole
+		const editors::buffer &buf = _interp->get_buffer();
+		auto write_string = [](auto &writer, std::u8string_view str) {
+			writer.String(
+				reinterpret_cast<const char*>(str.data()), static_cast<rapidjson::SizeType>(str.size()), true
+			);
+		};
+		auto write_params = [&](auto &writer) {
+			writer.StartObject();
+			writer.Key("textDocument");
+			writer.StartObject();
+			{
+				writer.Key("uri");
+				write_string(writer, _change_params.textDocument.uri);
+				writer.Key("languageId");
+				write_string(writer, buf.get_language().back());
+				writer.Key("version");
+				writer.Int(_change_params.textDocument.version);
+				writer.Key("text");
+				writer.StringPieces([&](const auto &append) {
+					_for_each_utf8_piece(buf.begin(), buf.end(), append);
+				});
+			}
+			writer.EndObject();
+			writer.EndObject();
+		};
+		_client->send_notification(u8"textDocument/didOpen", write_params);
+	}
+
+	void interpretation_tag::_send_semanticTokens() {
+		bool delta = !_semantic_tokens_result_id.empty() && _supports_semantic_tokens_delta();
+		auto on_error = [this](types::integer code, std::u8string_view msg, const json::value_t &data) {
+			--_queued_highlight_version;
+			// ignore errors caused by content modifications
+			if (code != static_cast<types::integer>(types::ErrorCodesEnum::ContentModified)) {
+				client::default_error_handler(code, msg, data);
+			}
+		};
+		if (delta) {
+			types::SemanticTokensDeltaParams params;
+			params.textDocument.uri = _change_params.textDocument.uri;
+			params.previousResultId = _semantic_tokens_result_id;
+			_client->send_request<types::SemanticTokensDeltaResponse>(
+				u8"textDocument/semanticTokens/full/delta", params,
+				[this](types::SemanticTokensDeltaResponse params) {
+					_on_semanticTokens_delta(std::move(params));
+				},
+				std::move(on_error)
+			);
+		} else {
+			types::SemanticTokensParams params;
+			params.textDocument.uri = _change_params.textDocument.uri;
+			_client->send_request<types::SemanticTokensResponse>(
+				u8"textDocument/semanticTokens/full", params,
+				[this](types::SemanticTokensResponse params) {
+					_on_semanticTokens(std::move(params));
+				},
+				std::move(on_error)
+			);
+		}
+		++_queued_highlight_version;
 	}
 
-	void interpretation_tag::_send_semanticTokens_full() {
-		types::SemanticTokensParams params;
+	void interpretation_tag::_send_semanticTokens_range(const editors::code::contents_region &region) {
+		// request highlights for all lines that are (partially) visible
+		auto [first_visual, past_last_visual] = region.get_visible_visual_lines();
+		if (first_visual >= past_last_visual) {
+			return;
+		}
+		const editors::code::view_formatting &fmt = region.get_formatting();
+		const editors::code::linebreak_registry &linebreaks = _interp->get_linebreaks();
+		std::size_t
+			begin_char = fmt.get_linebreaks().get_beginning_char_of_visual_line(
+				fmt.get_folding().folded_to_unfolded_line_number(first_visual)
+			).first,
+			end_char = fmt.get_linebreaks().get_past_ending_char_of_visual_line(
+				fmt.get_folding().folded_to_unfolded_line_number(past_last_visual - 1)
+			).first;
+		std::size_t
+			first_line = linebreaks.get_line_and_column_of_char(begin_char).line,
+			past_last_line = linebreaks.get_line_and_column_of_char(end_char).line + 1;
+		begin_char = linebreaks.get_line_info(first_line).first_char;
+		end_char =
+			past_last_line < linebreaks.num_linebreaks() + 1 ?
+			linebreaks.get_line_info(past_last_line).first_char :
+			linebreaks.num_chars();
+
+		types::SemanticTokensRangeParams params;
 		params.textDocument.uri = _change_params.textDocument.uri;
+		params.range.start = types::Position(first_line, 0);
+		params.range.end = types::Position(past_last_line, 0);
 		_client->send_request<types::SemanticTokensResponse>(
-			u8"textDocument/semanticTokens/full", params,
-			[this](types::SemanticTokensResponse params) {
-				_on_semanticTokens(std::move(params));
+			u8"textDocument/semanticTokens/range", params,
+			[this, begin_char, end_char](types::SemanticTokensResponse params) {
+				_on_semanticTokens_range(std::move(params), begin_char, end_char);
 			},
 			[this](types::integer code, std::u8string_view msg, const json::value_t &data) {
-				--_queued_highlight_version;
-				// ignore errors caused by content modifications
+				--_queued_range_highlight_version;
 				if (code != static_cast<types::integer>(types::ErrorCodesEnum::ContentModified)) {
 					client::default_error_handler(code, msg, data);
 				}
 			}
 		);
-		++_queued_highlight_version;
+		++_queued_range_highlight_version;
 	}
 
 	void interpretation_tag::_on_semanticTokens(types::SemanticTokensResponse response) {
@@ -270,79 +404,156 @@ namespace codepad::lsp {
 			// TODO handle null response
 			return;
 		};
+		_apply_full_semantic_tokens(std::move(std::get<types::SemanticTokens>(response.value)));
+	}
 
-		auto &semantic_tokens = _client->get_initialize_result().capabilities.semanticTokensProvider.value;
-		if (!semantic_tokens.has_value()) {
+	void interpretation_tag::_on_semanticTokens_delta(types::SemanticTokensDeltaResponse response) {
+		performance_monitor mon(u8"semanticTokens/delta", std::chrono::milliseconds(40));
+		if (--_queued_highlight_version != 0) {
+			// skip; highlight is not for the latest document. since the stored result is not updated, the next
+			// request will still be based on it
+			return;
+		}
+		if (auto *full = std::get_if<types::SemanticTokens>(&response.value)) {
+			_apply_full_semantic_tokens(std::move(*full));
+			return;
+		}
+		auto *delta = std::get_if<types::SemanticTokensDelta>(&response.value);
+		if (!delta || !_get_semantic_tokens_options()) {
 			return;
 		}
-		const std::vector<std::u8string> *types = nullptr, *modifiers = nullptr;
-		std::visit(
-			[&](const types::SemanticTokensOptions &opt) {
-				types = &opt.legend.tokenTypes.value;
-				modifiers = &opt.legend.tokenModifiers.value;
-			},
-			semantic_tokens->value
-		);
 
-		// TODO theme caching
-		// this is really ugly
-		std::unordered_map<std::uint64_t, std::optional<editors::text_theme>> theme_mapping;
-		auto theme = _interp->get_buffer().get_buffer_manager().get_manager()->themes.get_theme_for_language(
-			_interp->get_buffer().get_language().back()
+		// apply the edits to the stored array. edits are relative to the original array and don't overlap
+		auto &edits = delta->edits.value;
+		if (edits.empty()) {
+			_semantic_tokens_result_id = delta->resultId.value.value_or(types::string());
+			return;
+		}
+		std::sort(
+			edits.begin(), edits.end(),
+			[](const types::SemanticTokensEdit &lhs, const types::SemanticTokensEdit &rhs) {
+				return lhs.start < rhs.start;
+			}
 		);
-		auto get_theme_for = [&](types::uinteger type, types::uinteger mods) {
-			std::uint64_t key = (static_cast<std::uint64_t>(type) << 32) | mods;
-			auto [it, inserted] = theme_mapping.try_emplace(key, std::nullopt);
-			if (inserted) {
-				std::vector<std::u8string_view> strings{ { types->at(type) } };
-				std::size_t i = 0;
-				while (mods > 0) {
-					while ((mods & 1) == 0) {
-						mods >>= 1;
-						++i;
-					}
-					strings.emplace_back(modifiers->at(i));
-					mods >>= 1;
-					++i;
+		std::size_t changed_begin = edits.front().start, changed_end = 0;
+		std::ptrdiff_t shift = 0; // difference between indices in the new array and in the old array
+		std::vector<types::uinteger> tokens;
+		tokens.reserve(_semantic_tokens.size());
+		std::size_t copied = 0;
+		for (auto &edit : edits) {
+			if (edit.start < copied || edit.start + edit.deleteCount > _semantic_tokens.size()) {
+				logger::get().log_error() << "invalid semantic token edit";
+				// start over with a full request next time
+				_semantic_tokens_result_id.clear();
+				return;
+			}
+			tokens.insert(tokens.end(), _semantic_tokens.begin() + copied, _semantic_tokens.begin() + edit.start);
+			std::size_t inserted = 0;
+			if (edit.data.value) {
+				inserted = edit.data.value->value.size();
+				tokens.insert(tokens.end(), edit.data.value->value.begin(), edit.data.value->value.end());
+			}
+			copied = edit.start + edit.deleteCount;
+			changed_end = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(edit.start) + shift) + inserted;
+			shift += static_cast<std::ptrdiff_t>(inserted) - static_cast<std::ptrdiff_t>(edit.deleteCount);
+		}
+		tokens.insert(tokens.end(), _semantic_tokens.begin() + copied, _semantic_tokens.end());
+		_semantic_tokens = std::move(tokens);
+		_semantic_tokens_result_id = delta->resultId.value.value_or(types::string());
+
+		// find the range of tokens that have changed. tokens are relative to the previous one, so the token before
+		// the first changed token is used as the start of the range, along with all tokens starting at the same
+		// position as it
+		std::size_t num_tokens = _semantic_token::count(_semantic_tokens);
+		std::size_t first_token = changed_begin / 5, past_last_token = std::min((changed_end + 4) / 5, num_tokens);
+		if (first_token > 0) {
+			--first_token;
+			while (first_token > 0) {
+				_semantic_token tok = _semantic_token::at(_semantic_tokens, first_token);
+				if (tok.deltaLine != 0 || tok.deltaStart != 0) {
+					break;
 				}
-				std::size_t v = theme->get_index_for(std::move(strings));
-				if (v == editors::theme_configuration::no_associated_theme) {
-					logger::get().log_warning() << "no associated theme";
-				} else {
-					it->second = theme->entries[v].theme;
+				--first_token;
+			}
+		}
+		// the range of characters ends at the first unchanged token after the edits
+		std::size_t range_begin = 0, range_end = _interp->get_linebreaks().num_chars();
+		editors::code::document_theme new_tokens;
+		semantic_token_theme_mapping &mapping = _get_semantic_token_theme_mapping();
+		_decode_semantic_tokens(
+			_semantic_tokens, first_token, std::min(past_last_token + 1, num_tokens),
+			[&](std::size_t index, std::size_t beg, std::size_t end, types::uinteger type, types::uinteger mods) {
+				if (index == first_token && first_token > 0) {
+					range_begin = beg;
+				}
+				if (index == past_last_token) {
+					range_end = beg;
+					return;
+				}
+				if (const auto &cur_theme = mapping.get(type, mods)) {
+					new_tokens.add_range(beg, end, cur_theme.value());
 				}
 			}
-			return it->second;
-		};
+		);
 
-		auto &tokens = std::get<types::SemanticTokens>(response.value);
-		std::size_t line = 0, character_offset = 0;
-		editors::code::document_theme data;
-		auto &linebreaks = _interp->get_linebreaks();
-		editors::code::linebreak_registry::linebreak_info line_info = linebreaks.get_line_info(0);
-		_semantic_token::iterate_over_range(
-			tokens.data.value, [&](const _semantic_token &tok) {
-				// update current position
-				if (tok.deltaLine > 0) {
-					line += tok.deltaLine;
-					character_offset = tok.deltaStart;
-					line_info = linebreaks.get_line_info(line);
-				} else {
-					character_offset += tok.deltaStart;
-				}
-				// check if the token spans multiple lines
-				std::size_t token_end = line_info.first_char + character_offset + tok.length;
-				std::size_t line_end =
-					line_info.first_char + line_info.entry->nonbreak_chars +
-					(line_info.entry->ending != line_ending::none ? 1 : 0);
-				if (token_end > line_end) {
-					std::size_t codepoint =
-						linebreaks.get_beginning_codepoint_of(line_info.entry) +
-						character_offset + tok.length;
-					token_end = linebreaks.get_line_and_column_and_char_of_codepoint(codepoint).second;
+		auto theme_modifier = _theme_token.get_modifier();
+		// tokens that straddle the boundaries are clipped so that they do not overlap with the new tokens
+		auto [clipped_begin, clipped_end] = theme_modifier->ranges.clip_ranges_overlapping(range_begin, range_end);
+		theme_modifier.mark_changed(clipped_begin, clipped_end);
+		for (
+			auto it = new_tokens.ranges.begin_position();
+			it.get_iterator() != new_tokens.ranges.end();
+			it.move_next()
+		) {
+			std::size_t start = it.get_range_start(), end = start + it.get_iterator()->length;
+			theme_modifier->add_range(start, end, it.get_iterator()->value);
+			theme_modifier.mark_changed(start, end);
+		}
+	}
+
+	void interpretation_tag::_on_semanticTokens_range(
+		types::SemanticTokensResponse response, std::size_t begin, std::size_t end
+	) {
+		performance_monitor mon(u8"semanticTokens/range", std::chrono::milliseconds(40));
+		if (--_queued_range_highlight_version != 0) {
+			// skip; highlight is not for the latest document
+			return;
+		}
+		auto *tokens = std::get_if<types::SemanticTokens>(&response.value);
+		if (!tokens || !_get_semantic_tokens_options()) {
+			return;
+		}
+
+		semantic_token_theme_mapping &mapping = _get_semantic_token_theme_mapping();
+		auto theme_modifier = _theme_token.get_modifier();
+		// tokens that straddle the viewport are clipped so that they do not overlap with the new tokens
+		auto [clipped_begin, clipped_end] = theme_modifier->ranges.clip_ranges_overlapping(begin, end);
+		theme_modifier.mark_changed(clipped_begin, clipped_end);
+		_decode_semantic_tokens(
+			tokens->data.value, 0, _semantic_token::count(tokens->data.value),
+			[&](std::size_t, std::size_t tok_beg, std::size_t tok_end, types::uinteger type, types::uinteger mods) {
+				if (const auto &cur_theme = mapping.get(type, mods)) {
+					theme_modifier->add_range(tok_beg, tok_end, cur_theme.value());
+					theme_modifier.mark_changed(tok_beg, tok_end);
 				}
-				if (auto cur_theme = get_theme_for(tok.tokenType, tok.tokenModifiers)) {
-					data.add_range(line_info.first_char + character_offset, token_end, cur_theme.value());
+			}
+		);
+	}
+
+	void interpretation_tag::_apply_full_semantic_tokens(types::SemanticTokens tokens) {
+		if (!_get_semantic_tokens_options()) {
+			return;
+		}
+		_semantic_tokens = std::move(tokens.data.value);
+		_semantic_tokens_result_id = tokens.resultId.value.value_or(types::string());
+
+		semantic_token_theme_mapping &mapping = _get_semantic_token_theme_mapping();
+		editors::code::document_theme data;
+		_decode_semantic_tokens(
+			_semantic_tokens, 0, _semantic_token::count(_semantic_tokens),
+			[&](std::size_t, std::size_t beg, std::size_t end, types::uinteger type, types::uinteger mods) {
+				if (const auto &cur_theme = mapping.get(type, mods)) {
+					data.add_range(beg, end, cur_theme.value());
 				}
 			}
 		);
@@ -350,6 +561,96 @@ namespace codepad::lsp {
 		*theme_modifier = std::move(data);
 	}
 
+	template <typename Callback> void interpretation_tag::_decode_semantic_tokens(
+		const std::vector<types::uinteger> &arr, std::size_t first, std::size_t past_last, Callback &&cb
+	) const {
+		// skip to the first token without looking up any line information
+		std::size_t line = 0, character_offset = 0;
+		for (std::size_t i = 0; i < first; ++i) {
+			_semantic_token tok = _semantic_token::at(arr, i);
+			if (tok.deltaLine > 0) {
+				line += tok.deltaLine;
+				character_offset = tok.deltaStart;
+			} else {
+				character_offset += tok.deltaStart;
+			}
+		}
+
+		auto &linebreaks = _interp->get_linebreaks();
+		editors::code::linebreak_registry::linebreak_info line_info;
+		std::size_t line_end = 0;
+		auto update_line = [&]() {
+			line_info = linebreaks.get_line_info(line);
+			line_end =
+				line_info.first_char + line_info.entry->nonbreak_chars +
+				(line_info.entry->ending != line_ending::none ? 1 : 0);
+		};
+		update_line();
+		for (std::size_t i = first; i < past_last; ++i) {
+			_semantic_token tok = _semantic_token::at(arr, i);
+			// update current position
+			if (tok.deltaLine > 0) {
+				line += tok.deltaLine;
+				character_offset = tok.deltaStart;
+				update_line();
+			} else {
+				character_offset += tok.deltaStart;
+			}
+			// check if the token spans multiple lines
+			std::size_t token_end = line_info.first_char + character_offset + tok.length;
+			if (token_end > line_end) {
+				std::size_t codepoint =
+					linebreaks.get_beginning_codepoint_of(line_info.entry) +
+					character_offset + tok.length;
+				token_end = linebreaks.get_line_and_column_and_char_of_codepoint(codepoint).second;
+			}
+			cb(i, line_info.first_char + character_offset, token_end, tok.tokenType, tok.tokenModifiers);
+		}
+	}
+
+	const types::SemanticTokensOptions *interpretation_tag::_get_semantic_tokens_options() const {
+		auto &semantic_tokens = _client->get_initialize_result().capabilities.semanticTokensProvider.value;
+		if (!semantic_tokens.has_value()) {
+			return nullptr;
+		}
+		const types::SemanticTokensOptions *result = nullptr;
+		std::visit(
+			[&](const types::SemanticTokensOptions &opt) {
+				result = &opt;
+			},
+			semantic_tokens->value
+		);
+		return result;
+	}
+
+	bool interpretation_tag::_supports_semantic_tokens_delta() const {
+		const types::SemanticTokensOptions *options = _get_semantic_tokens_options();
+		if (!options || !options->full.value) {
+			return false;
+		}
+		auto *full = std::get_if<types::SemanticTokensFullRequestsClientCapabilities>(&options->full.value->value);
+		return full && full->delta.value.value_or(false);
+	}
+
+	bool interpretation_tag::_supports_semantic_tokens_range() const {
+		const types::SemanticTokensOptions *options = _get_semantic_tokens_options();
+		if (!options || !options->range.value) {
+			return false;
+		}
+		if (auto *b = std::get_if<types::boolean>(&options->range.value->value)) {
+			return *b;
+		}
+		return true;
+	}
+
+	semantic_token_theme_mapping &interpretation_tag::_get_semantic_token_theme_mapping() const {
+		const std::u8string &lang = _interp->get_buffer().get_language().back();
+		return _client->get_semantic_token_theme_mapping(
+			lang, _get_semantic_tokens_options()->legend,
+			_interp->get_buffer().get_buffer_manager().get_manager()->themes.get_theme_for_language(lang)
+		);
+	}
+
 	void interpretation_tag::on_publishDiagnostics(types::PublishDiagnosticsParams params) {
 		if (
 			params.version.value.has_value() &&
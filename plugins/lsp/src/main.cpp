@@ -128,6 +128,7 @@ extern "C" {
 				semantic_tokens.requests.full.value.emplace()
 					.value.emplace<cp::lsp::types::SemanticTokensFullRequestsClientCapabilities>()
 					.delta.value.emplace(true);
+				semantic_tokens.requests.range.value.emplace().value.emplace<cp::lsp::types::boolean>(true);
 
 				auto &token_types = cp::lsp::types::SemanticTokenTypes::get_strings();
 				semantic_tokens.tokenTypes.value.reserve(token_types.size());
@@ -0,0 +1,31 @@
+// Copyright (c) the Codepad contributors. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See LICENSE.txt in the project root for license information.
+
+#include "codepad/lsp/semantic_tokens.h"
+
+/// \file
+/// Implementation of semantic token utilities.
+
+namespace codepad::lsp {
+	std::optional<editors::text_theme> semantic_token_theme_mapping::_compute(
+		types::uinteger type, types::uinteger mods
+	) const {
+		std::vector<std::u8string_view> strings{ { _legend->tokenTypes.value.at(type) } };
+		std::size_t i = 0;
+		while (mods > 0) {
+			while ((mods & 1) == 0) {
+				mods >>= 1;
+				++i;
+			}
+			strings.emplace_back(_legend->tokenModifiers.value.at(i));
+			mods >>= 1;
+			++i;
+		}
+		std::size_t v = _theme->get_index_for(std::move(strings));
+		if (v == editors::theme_configuration::no_associated_theme) {
+			logger::get().log_warning() << "no associated theme";
+			return std::nullopt;
+		}
+		return _theme->entries[v].theme;
+	}
+}
@@ -386,8 +386,12 @@ namespace codepad::lsp::types {
 	}
 
 
+	CP_LSP_VISIT_FUNC(, SemanticTokensRangeRequestsClientCapabilities) {
+	}
+
+
 	CP_LSP_VISIT_FUNC(v, SemanticTokensRequestsClientCapabilities) {
-		// TODO range
+		CP_LSP_VISIT_FIELD(v, range);
 		CP_LSP_VISIT_FIELD(v, full);
 	}
 
@@ -406,7 +410,7 @@ namespace codepad::lsp::types {
 	CP_LSP_VISIT_FUNC(v, SemanticTokensOptions) {
 		CP_LSP_VISIT_BASE(v, WorkDoneProgressOptions);
 		CP_LSP_VISIT_FIELD(v, legend);
-		// TODO range
+		CP_LSP_VISIT_FIELD(v, range);
 		CP_LSP_VISIT_FIELD(v, full);
 	}
 
@@ -30,17 +30,27 @@ namespace codepad::tree_sitter {
 		};
 
 		/// Creates a new iterator for the given interpretation.
+		///
+		/// \param yield Called whenever the cancellation token is checked, so that the caller can temporarily
+		///              release the locks it holds. If this returns \p false, the operation is cancelled. This can
+		///              be empty.
+		/// \param root_tree The parsed syntax tree of the entire document.
+		/// \param query_begin Only highlights of nodes that intersect with this byte range are collected.
+		/// \param query_end \sa query_begin
 		highlight_collector(
 			const TSInput &input, const editors::code::interpretation &interp,
 			const parser_ptr &parser, const language_configuration &lang,
 			std::function<const language_configuration*(std::u8string_view)> lang_callback,
-			std::size_t *cancellation_token
+			std::size_t *cancellation_token, std::function<bool()> yield, tree_ptr root_tree,
+			uint32_t query_begin = 0, uint32_t query_end = std::numeric_limits<uint32_t>::max()
 		) :
-			_lang_callback(std::move(lang_callback)),
-			_input(input), _interp(interp), _cancellation_token(cancellation_token) {
+			_lang_callback(std::move(lang_callback)), _yield(std::move(yield)),
+			_input(input), _interp(interp), _cancellation_token(cancellation_token),
+			_query_begin(query_begin), _query_end(query_end) {
 
 			_layers = highlight_layer_iterator::process_layers(
-				{}, input, _interp, parser, lang, _lang_callback, cancellation_token
+				{}, input, _interp, parser, lang, _lang_callback, cancellation_token,
+				std::move(root_tree), _query_begin, _query_end
 			);
 		}
 
@@ -54,24 +64,33 @@ namespace codepad::tree_sitter {
 		std::deque<highlight_layer_iterator> _layers; ///< Queue of highlight layers to be handled next.
 		/// A function that returns the \ref language_configuration that corresponds to a given language name.
 		std::function<const language_configuration*(std::u8string_view)> _lang_callback;
+		std::function<bool()> _yield; ///< Called when checking for cancellation.
 		TSInput _input; ///< Input associated with \ref _interp.
 		/// The interpretation associated with this iterator.
 		const editors::code::interpretation &_interp;
 		std::size_t _iterations = 0; ///< The number of iterations. Used when checking whether to cancel the operation.
 		std::size_t *_cancellation_token = nullptr; ///< Cancellation token.
+		uint32_t
+			_query_begin = 0, ///< The first byte of the range in which highlights are collected.
+			_query_end = 0; ///< The byte past the end of the range in which highlights are collected.
 
-		/// Checks if the cancellation token is set. This function only really checks every
+		/// Returns whether the cancellation token is set.
+		[[nodiscard]] bool _is_cancelled() const {
+			if (_cancellation_token) {
+				std::atomic_ref<std::size_t> cancel(*_cancellation_token);
+				return cancel != 0;
+			}
+			return false;
+		}
+		/// Checks if the cancellation token is set, and invokes \ref _yield. This function only really checks every
 		/// \ref cancellation_check_interval calls.
 		///
-		/// \return \p true if \ref _cancellation_token is set.
+		/// \return \p true if \ref _cancellation_token is set or if \ref _yield returns \p false.
 		[[nodiscard]] bool _check_cancel() {
-			if (_cancellation_token) {
-				if (++_iterations >= cancellation_check_interval) {
-					_iterations = 0;
-					std::atomic_ref<std::size_t> cancel(*_cancellation_token);
-					if (cancel != 0) {
-						return true;
-					}
+			if (++_iterations >= cancellation_check_interval) {
+				_iterations = 0;
+				if (_is_cancelled() || (_yield && !_yield())) {
+					return true;
 				}
 			}
 			return false;
@@ -175,13 +175,28 @@ namespace codepad::tree_sitter {
 			const std::vector<TSRange> parent_ranges, const std::vector<TSNode> &nodes, bool include_children
 		);
 
+		/// Parses the given ranges of the document using the given language. If \p old_tree is not \p nullptr, it
+		/// must have been edited using \p ts_tree_edit() to match the current contents of the document, and parts
+		/// of it that are not affected by the edits are reused.
+		///
+		/// \return The new tree, or an empty pointer if parsing failed or has been cancelled.
+		[[nodiscard]] static tree_ptr parse(
+			const std::vector<TSRange> &ranges, const TSInput&, const parser_ptr&, const language_configuration&,
+			const TSTree *old_tree, const std::size_t *cancellation_token
+		);
 		/// Processes the given source code. If there are any combined injections in the source code, this function
 		/// eagerly produces layer iterators for them as well. Normal injections are not handled here.
+		///
+		/// \param first_tree If not empty, this is used as the parsed tree of the first layer.
+		/// \param query_begin Only captures of nodes that intersect with this byte range are produced by the
+		///                    returned layers.
+		/// \param query_end \sa query_begin
 		[[nodiscard]] static std::deque<highlight_layer_iterator> process_layers(
 			std::vector<TSRange> ranges, const TSInput&, const editors::code::interpretation&,
 			const parser_ptr&, const language_configuration&,
 			const std::function<const language_configuration*(std::u8string_view)> &lang_callback,
-			const std::size_t *cancellation_token
+			const std::size_t *cancellation_token, tree_ptr first_tree = tree_ptr(),
+			uint32_t query_begin = 0, uint32_t query_end = std::numeric_limits<uint32_t>::max()
 		);
 
 		/// Returns the ranges of this layer.
@@ -200,13 +215,15 @@ namespace codepad::tree_sitter {
 		tree_ptr _tree; ///< The syntax tree of this layer.
 		const language_configuration *_language = nullptr; ///< The language configuration.
 
-		/// Initializes all fields of this class, and sets up \ref _cursor to iterate through all captures.
+		/// Initializes all fields of this class, and sets up \ref _cursor to iterate through all captures that
+		/// intersect with the given byte range.
 		highlight_layer_iterator(
 			std::vector<TSRange> ranges, query_cursor_ptr cursor, tree_ptr tree,
-			const language_configuration *lang
+			const language_configuration *lang, uint32_t query_begin, uint32_t query_end
 		) :
 			_ranges(std::move(ranges)), _cursor(std::move(cursor)), _tree(std::move(tree)), _language(lang) {
 
+			ts_query_cursor_set_byte_range(_cursor.get(), query_begin, query_end);
 			ts_query_cursor_exec(
 				_cursor.get(), _language->get_query().get_query().get(), ts_tree_root_node(_tree.get())
 			);
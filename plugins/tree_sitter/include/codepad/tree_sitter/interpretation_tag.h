@@ -6,6 +6,9 @@
 /// \file
 /// Implementation of the \ref codepad::tree_sitter::interpretation_tag class.
 
+#include <optional>
+#include <unordered_map>
+
 #include <tree_sitter/api.h>
 
 #include <codepad/ui/async_task.h>
@@ -34,6 +37,19 @@ namespace codepad::tree_sitter {
 	/// Interface between the editor and \p tree-sitter.
 	class interpretation_tag {
 	public:
+		/// The result of a highlight task.
+		struct highlight_update {
+			highlight_collector::document_highlight_data data; ///< The highlight data.
+			/// The range of characters that has been re-highlighted. Only valid if \ref full is \p false.
+			std::size_t
+				range_begin = 0,
+				range_end = 0;
+			/// Indicates whether the entire document has been highlighted. If this is \p false, \ref data only
+			/// contains highlights within the range between \ref range_begin and \ref range_end.
+			bool full = true;
+			tree_ptr tree; ///< The new syntax tree of the document.
+		};
+
 		/// Creates a new parser, registers to events, and starts highlighting for this interpretation.
 		interpretation_tag(editors::code::interpretation&, const language_configuration*, manager&);
 		/// Assert during copy construction.
@@ -47,39 +63,37 @@ namespace codepad::tree_sitter {
 		}
 		/// Unregisters from events.
 		~interpretation_tag() {
-			if (auto task = _task_token.get_task()) {
-				// this happens when the plugin is disabled manually, in which case we just cancel the task and wait
-				// for it to finish
-				task->cancel();
-				task->wait_finish();
-			}
+			// this happens when the plugin is disabled manually, in which case we just cancel all tasks and wait for
+			// them to finish
+			cancel_highlight_task();
+			wait_for_highlight_task();
 
 			_interp->get_buffer().begin_edit -= _begin_edit_token;
+			_interp->get_buffer().end_modify -= _end_modify_token;
 			_interp->get_buffer().end_edit -= _end_edit_token;
 			_interp->get_buffer().language_changed -= _lang_changed_token;
 			_interp->get_theme_providers().remove_provider(_theme_token);
 			_interp->remove_tooltip_provider(_debug_tooltip_provider_token);
 		}
 
-		/// Computes and returns the new highlight for the document. This function does not create a
-		/// \ref editors::buffer::async_reader_lock - it is the responsibility of the caller to do so when necessary.
-		[[nodiscard]] highlight_collector::document_highlight_data compute_highlight(
-			std::size_t *cancellation_token
-		);
-
-		/// Starts a new highlight task and updates \ref _task_token.
+		/// Starts a new highlight task and adds it to \ref _task_tokens.
 		void start_highlight_task();
-		/// Cancels the ongoing highlight task, if there is one, and returns immediately.
+		/// Cancels all ongoing highlight tasks and returns immediately.
 		void cancel_highlight_task() {
-			if (auto task = _task_token.get_task()) {
-				task->cancel();
+			for (auto &tok : _task_tokens) {
+				if (auto task = tok.get_task()) {
+					task->cancel();
+				}
 			}
 		}
-		/// Waits for the currently ongoing highlight task to finish, if there is one.
+		/// Waits for all ongoing highlight tasks to finish.
 		void wait_for_highlight_task() {
-			if (auto task = _task_token.get_task()) {
-				task->wait_finish();
+			for (auto &tok : _task_tokens) {
+				if (auto task = tok.get_task()) {
+					task->wait_finish();
+				}
 			}
+			_task_tokens.clear();
 		}
 
 		/// Returns \ref _capture_names.
@@ -104,19 +118,22 @@ namespace codepad::tree_sitter {
 			return *_manager;
 		}
 	protected:
+		class _highlight_task;
 		/// Contains information used in a \p TSInput.
 		struct _payload {
-			byte_string read_buffer; ///< Intermediate buffer.
-			const editors::code::interpretation &interpretation; ///< Used to read the buffer.
+			editors::buffer::chunk_reader reader; ///< Used to read the buffer without copying its contents.
+			_highlight_task *task = nullptr; ///< The task, used to release the buffer lock between chunks.
 		};
 
-		/// A task used for highlighting an \ref editors::code::interpretation.
+		/// A task used for highlighting an \ref editors::code::interpretation. The task takes a snapshot of all the
+		/// state it needs from the \ref interpretation_tag when it's created, and never accesses the tag on the
+		/// worker thread. This way the main thread never needs to wait for a task: outdated tasks are simply
+		/// cancelled, and their results are discarded using \ref _edit_version.
 		class _highlight_task : public ui::async_task_base {
 		public:
-			/// Initializes \ref _interp and \ref _tag.
-			_highlight_task(interpretation_tag &tag) : _tag(tag) {
-				_interp = _tag.get_interpretation().shared_from_this();
-			}
+			/// Takes a snapshot of the state of the given \ref interpretation_tag. The tag's idle parser is taken
+			/// over by this task if there is one.
+			explicit _highlight_task(interpretation_tag&);
 
 			/// Highlights the given interpretation.
 			status execute() override;
@@ -126,24 +143,70 @@ namespace codepad::tree_sitter {
 				cancel = 1;
 			}
 		protected:
-			/// The \ref editors::code::interpretation. This is here so that the interpretation (and consequently
-			/// `_tag`) will not be destroyed while this task is running.
+			/// The result of a task that is transferred back to the main thread.
+			struct _result {
+				highlight_update update; ///< The highlight update.
+				parser_ptr parser; ///< The parser used by the task, returned so that it can be reused.
+				std::size_t edit_version = 0; ///< The value of \ref _edit_version.
+			};
+
+			/// The \ref editors::code::interpretation. This is here so that the interpretation will not be destroyed
+			/// while this task is running.
 			std::shared_ptr<editors::code::interpretation> _interp;
-			interpretation_tag &_tag; ///< The tag associated with \ref _interp.
+			manager &_manager; ///< The \ref manager, used to find the tag when the task finishes.
+			const language_configuration *_lang = nullptr; ///< The language configuration.
+			parser_ptr _parser; ///< The parser owned by this task.
+			tree_ptr _old_tree; ///< A copy of \ref interpretation_tag::_tree.
+			/// A copy of \ref interpretation_tag::_invalidated_range.
+			std::optional<std::pair<std::size_t, std::size_t>> _invalidated_range;
+			/// The value of \ref interpretation_tag::_edit_version when this task is created.
+			std::size_t _edit_version = 0;
+			bool _full_highlight = true; ///< A copy of \ref interpretation_tag::_full_highlight.
 			/// The cancellation token for this task. This should be accessed through a \p std::atomic_ref.
 			alignas(std::atomic_ref<std::size_t>::required_alignment) std::size_t _cancellation_token = 0;
+			/// The lock on the buffer. This is released periodically by \ref _yield_lock() so that modifications
+			/// made on the main thread do not need to wait for the entire parse.
+			std::optional<editors::buffer::async_reader_lock> _lock;
+
+			/// Releases \ref _lock so that pending modifications can proceed, then acquires it again. Since the
+			/// task is cancelled before the buffer is locked for a modification, if this function returns \p true,
+			/// the lock is held and the buffer has not been modified since the task started. Otherwise, the task
+			/// has been cancelled, the lock is not held, and the buffer must no longer be accessed.
+			[[nodiscard]] bool _yield_lock();
+			/// Incrementally re-parses the document and computes the new highlight for the parts of the document
+			/// that have changed since the last highlight has been applied. \ref _lock must be held when this is
+			/// called; it may be released between chunks of work.
+			///
+			/// \return The highlight update, or \p std::nullopt if the task has been cancelled or if parsing has
+			///         failed, in which case the current highlight should be kept.
+			[[nodiscard]] std::optional<highlight_update> _compute_highlight();
 		};
 
 
 		std::vector<std::u8string> _capture_names; ///< Highlight names used for debugging.
-
-		parser_ptr _parser; ///< The parser.
+		/// Indices of all entries in \ref _capture_names, used to keep cookies consistent across partial updates.
+		std::unordered_map<std::u8string, std::int32_t> _capture_name_indices;
+
+		/// A parser that's not used by any task. New tasks take this parser, and finished tasks return theirs, so
+		/// that a new parser is only created when multiple tasks are running at the same time.
+		parser_ptr _parser;
+		/// The syntax tree of the document produced by the last applied parse, with all subsequent modifications
+		/// applied using \p ts_tree_edit(). This is only accessed on the main thread; tasks work on copies.
+		tree_ptr _tree;
+		/// The range of bytes whose highlights are out-of-date because of modifications or changes in the syntax
+		/// tree. This is cleared when an update is applied.
+		std::optional<std::pair<std::size_t, std::size_t>> _invalidated_range;
+		/// Incremented whenever the document or the language changes. Used to discard outdated highlight results.
+		std::size_t _edit_version = 0;
+		bool _full_highlight = true; ///< Whether the entire document needs to be highlighted again.
 		const language_configuration *_lang = nullptr; ///< The language configuration.
 		editors::code::interpretation *_interp = nullptr; ///< The associated interpretation.
 		manager *_manager = nullptr; ///< The \ref manager that holds pointers to the \ref ui::manager.
 
 		/// Token for \ref editors::buffer::begin_edit.
 		info_event<editors::buffer::begin_edit_info>::token _begin_edit_token;
+		/// Token for \ref editors::buffer::end_modify.
+		info_event<editors::buffer::end_modification_info>::token _end_modify_token;
 		/// Token for \ref editors::buffer::end_edit.
 		info_event<editors::buffer::end_edit_info>::token _end_edit_token;
 		/// Token for \ref editors::buffer::language_changed.
@@ -152,6 +215,16 @@ namespace codepad::tree_sitter {
 		editors::code::document_theme_provider_registry::token _theme_token; ///< Token for the theme provider.
 		/// Token for the tooltip provider.
 		editors::code::interpretation::tooltip_provider_token _debug_tooltip_provider_token;
-		ui::async_task_scheduler::token<_highlight_task> _task_token; ///< Token for the highlight task.
+		/// Tokens for all highlight tasks that may still be running. Outdated tasks are cancelled without waiting
+		/// for them, so there may be more than one.
+		std::vector<ui::async_task_scheduler::token<_highlight_task>> _task_tokens;
+
+		/// Returns the position of the given byte as a \p TSPoint, using the linebreak registry of \ref _interp to
+		/// avoid scanning the document from the beginning.
+		[[nodiscard]] TSPoint _get_point_of_byte(std::size_t) const;
+		/// Applies a single modification to \ref _tree and \ref _invalidated_range.
+		void _on_modification(const editors::buffer::end_modification_info&);
+		/// Applies the result of a highlight task, unless the document has changed since the task was started.
+		void _apply_highlight_update(highlight_update, std::size_t edit_version);
 	};
 }
@@ -71,8 +71,13 @@ namespace codepad::tree_sitter {
 						if (!ranges.empty()) {
 							auto new_layers = highlight_layer_iterator::process_layers(
 								std::move(ranges), _input, _interp, parser,
-								*new_lang, _lang_callback, _cancellation_token
+								*new_lang, _lang_callback, _cancellation_token,
+								tree_ptr(), _query_begin, _query_end
 							);
+							// parsing the injection may have released the locks held by the caller
+							if (_is_cancelled()) {
+								return;
+							}
 							for (auto &l : new_layers) {
 								_layers.emplace_back(std::move(l));
 							}
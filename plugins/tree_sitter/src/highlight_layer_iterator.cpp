@@ -143,15 +143,47 @@ namespace codepad::tree_sitter {
 		return result;
 	}
 
+	tree_ptr highlight_layer_iterator::parse(
+		const std::vector<TSRange> &ranges, const TSInput &input, const parser_ptr &parser,
+		const language_configuration &lang_config, const TSTree *old_tree, const std::size_t *cancellation_token
+	) {
+		// for ts_parser_set_included_ranges, if length == 0, the entire document is parsed
+		if (!ts_parser_set_included_ranges(parser.get(), ranges.data(), static_cast<uint32_t>(ranges.size()))) {
+			logger::get().log_error() << "failed to parse document: invalid ranges";
+			return tree_ptr();
+		}
+		if (!ts_parser_set_language(parser.get(), lang_config.get_language())) {
+			logger::get().log_error() <<
+				"failed to parse document: language version mismatch";
+			return tree_ptr();
+		}
+		ts_parser_set_cancellation_flag(parser.get(), cancellation_token);
+		tree_ptr tree(ts_parser_parse(parser.get(), old_tree, input));
+		ts_parser_set_cancellation_flag(parser.get(), nullptr);
+		if (tree && cancellation_token) {
+			// the input may have been cut short because of the cancellation, in which case the parser can finish
+			// without noticing the flag
+			std::atomic_ref<std::size_t> cancel(const_cast<std::size_t&>(*cancellation_token));
+			if (cancel != 0) {
+				tree.reset();
+			}
+		}
+		if (!tree) {
+			// the operation was cancelled; the document will have changed by the time the parser is used again,
+			// so discard the partial state instead of resuming from it
+			ts_parser_reset(parser.get());
+		}
+		return tree;
+	}
+
 	std::deque<highlight_layer_iterator> highlight_layer_iterator::process_layers(
 		std::vector<TSRange> ranges, const TSInput &input, const editors::code::interpretation &interp,
 		const parser_ptr &parser, const language_configuration &lang_config,
 		const std::function<const language_configuration*(std::u8string_view)> &lang_callback,
-		const std::size_t *cancellation_token
+		const std::size_t *cancellation_token, tree_ptr first_tree, uint32_t query_begin, uint32_t query_end
 	) {
 		std::deque<highlight_layer_iterator> result;
 		std::deque<_layer_info> queue;
-		// for ts_parser_set_included_ranges, if length == 0, the entire document is parsed
 		queue.emplace_back(_layer_info{
 			.ranges = std::move(ranges), .lang_config = &lang_config
 			});
@@ -159,23 +191,12 @@ namespace codepad::tree_sitter {
 			_layer_info cur_layer = std::move(queue.front());
 			queue.pop_front();
 
-			if (!ts_parser_set_included_ranges(
-				parser.get(), cur_layer.ranges.data(), static_cast<uint32_t>(cur_layer.ranges.size())
-			)) {
-				logger::get().log_error() << "failed to parse document: invalid ranges";
-				break;
-			}
-			if (!ts_parser_set_language(parser.get(), cur_layer.lang_config->get_language())) {
-				logger::get().log_error() <<
-					"failed to parse document: language version mismatch";
-				break;
-			}
-			// TODO maybe reuse the old tree
-			ts_parser_set_cancellation_flag(parser.get(), cancellation_token);
-			tree_ptr tree(ts_parser_parse(parser.get(), nullptr, input));
-			ts_parser_set_cancellation_flag(parser.get(), nullptr);
+			tree_ptr tree = std::move(first_tree);
 			if (!tree) {
-				break; // operation was cancelled
+				tree = parse(cur_layer.ranges, input, parser, *cur_layer.lang_config, nullptr, cancellation_token);
+				if (!tree) {
+					break; // operation was cancelled
+				}
 			}
 
 			// process combined injections
@@ -211,7 +232,8 @@ namespace codepad::tree_sitter {
 			}
 
 			result.emplace_back(highlight_layer_iterator(
-				std::move(cur_layer.ranges), std::move(cursor), std::move(tree), cur_layer.lang_config
+				std::move(cur_layer.ranges), std::move(cursor), std::move(tree), cur_layer.lang_config,
+				query_begin, query_end
 			));
 		}
 		return result;
@@ -6,6 +6,8 @@
 /// \file
 /// Implementation of \ref codepad::tree_sitter::interpretation_tag.
 
+#include <cstdlib>
+
 #include <codepad/ui/elements/label.h>
 
 #include "details.h"
@@ -33,24 +35,51 @@ namespace codepad::tree_sitter {
 	}
 
 
+	interpretation_tag::_highlight_task::_highlight_task(interpretation_tag &tag) :
+		_interp(tag.get_interpretation().shared_from_this()), _manager(tag.get_manager()), _lang(tag._lang),
+		_parser(std::move(tag._parser)), _invalidated_range(tag._invalidated_range),
+		_edit_version(tag._edit_version), _full_highlight(tag._full_highlight) {
+
+		if (!_parser) {
+			_parser.set(ts_parser_new());
+		}
+		if (tag._tree) {
+			_old_tree.set(ts_tree_copy(tag._tree.get()));
+		}
+	}
+
 	ui::async_task_base::status interpretation_tag::_highlight_task::execute() {
-		highlight_collector::document_highlight_data theme;
-		{
-			editors::buffer::async_reader_lock lock(_interp->get_buffer());
-			theme = _tag.compute_highlight(&_cancellation_token);
+		std::atomic_ref<std::size_t> cancel(_cancellation_token);
+		if (cancel != 0) { // don't bother locking the buffer if the task has been cancelled while it's queued
+			return status::cancelled;
+		}
+		_lock.emplace(_interp->get_buffer());
+		// the buffer may have been modified while waiting for the lock, in which case the task is cancelled
+		if (cancel != 0) {
+			_lock.reset();
+			return status::cancelled;
+		}
+		std::optional<highlight_update> update = _compute_highlight();
+		_lock.reset();
+		if (!update) {
+			// either the task has been cancelled, or parsing has failed; in the latter case, the current highlight
+			// is kept instead of being replaced by an empty one
+			return cancel != 0 ? status::cancelled : status::finished;
 		}
+		auto result = std::make_shared<_result>();
+		result->update = std::move(update.value());
 		// transfer the highlight results back to the main thread
-		std::atomic_ref<std::size_t> cancel(_cancellation_token);
 		if (cancel == 0) {
-			manager *man = &_tag.get_manager();
-			_tag.get_manager().get_manager().get_scheduler().execute_callback(
-				[t = std::move(theme), target = std::move(_interp), man]() mutable {
+			result->parser = std::move(_parser);
+			result->edit_version = _edit_version;
+			manager *man = &_manager;
+			_manager.get_manager().get_scheduler().execute_callback(
+				[res = std::move(result), target = std::move(_interp), man]() {
 					if (auto *tag = man->get_tag_for(*target)) {
-						{
-							auto mod = tag->_theme_token.get_modifier();
-							*mod = std::move(t.theme);
+						if (!tag->_parser) {
+							tag->_parser = std::move(res->parser);
 						}
-						tag->_capture_names = std::move(t.capture_names);
+						tag->_apply_highlight_update(std::move(res->update), res->edit_version);
 					}
 					// the interpretation_tag can be empty if the plugin is disabled after this task has finished,
 					// but before the callback is executed
@@ -61,6 +90,119 @@ namespace codepad::tree_sitter {
 		return status::cancelled;
 	}
 
+	bool interpretation_tag::_highlight_task::_yield_lock() {
+		_lock.reset();
+		std::atomic_ref<std::size_t> cancel(_cancellation_token);
+		if (cancel != 0) {
+			return false;
+		}
+		_lock.emplace(_interp->get_buffer());
+		if (cancel != 0) {
+			_lock.reset();
+			return false;
+		}
+		return true;
+	}
+
+	std::optional<interpretation_tag::highlight_update> interpretation_tag::_highlight_task::_compute_highlight() {
+		highlight_update result;
+		if (!_lang) {
+			return result;
+		}
+
+		_payload payload{ .reader = editors::buffer::chunk_reader(_interp->get_buffer()), .task = this };
+		TSInput input;
+		input.payload = &payload;
+		input.read = [](void *payload_void, uint32_t byte_index, TSPoint, uint32_t *bytes_read) {
+			_payload *payload = static_cast<_payload*>(payload_void);
+			// the parser has finished with the previous chunk, so the lock can be released here; if the task has
+			// been cancelled, the input ends here and the parse is discarded
+			if (!payload->task->_yield_lock()) {
+				*bytes_read = 0;
+				return "";
+			}
+			auto [beg, end] = payload->reader.read(byte_index);
+			if (beg == end) {
+				*bytes_read = 0;
+				return "";
+			}
+			*bytes_read = static_cast<uint32_t>(end - beg);
+			return reinterpret_cast<const char*>(beg);
+		};
+		input.encoding = TSInputEncodingUTF8;
+
+		// reparse the document, reusing the old tree
+		tree_ptr tree = highlight_layer_iterator::parse(
+			{}, input, _parser, *_lang, _old_tree.get(), &_cancellation_token
+		);
+		if (!tree) {
+			return std::nullopt;
+		}
+		if (_old_tree && !_full_highlight) {
+			uint32_t num_changed = 0;
+			TSRange *changed = ts_tree_get_changed_ranges(_old_tree.get(), tree.get(), &num_changed);
+			for (uint32_t i = 0; i < num_changed; ++i) {
+				std::size_t beg = changed[i].start_byte, end = changed[i].end_byte;
+				if (_invalidated_range) {
+					beg = std::min(beg, _invalidated_range->first);
+					end = std::max(end, _invalidated_range->second);
+				}
+				_invalidated_range.emplace(beg, end);
+			}
+			std::free(changed);
+		}
+		// the new tree is kept by the tag and used as the old tree of the next task
+		result.tree.set(ts_tree_copy(tree.get()));
+
+		uint32_t query_begin = 0, query_end = std::numeric_limits<uint32_t>::max();
+		if (!_full_highlight) {
+			result.full = false;
+			if (!_invalidated_range) {
+				return result; // nothing has changed
+			}
+			// expand the range to the top-level nodes it intersects with, so that local scopes are processed as a
+			// whole
+			query_begin = static_cast<uint32_t>(_invalidated_range->first);
+			query_end = static_cast<uint32_t>(_invalidated_range->second);
+			TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree.get()));
+			if (ts_tree_cursor_goto_first_child(&cursor)) {
+				do {
+					TSNode node = ts_tree_cursor_current_node(&cursor);
+					uint32_t node_begin = ts_node_start_byte(node), node_end = ts_node_end_byte(node);
+					if (node_begin > query_end) {
+						break;
+					}
+					if (node_end >= query_begin) {
+						query_begin = std::min(query_begin, node_begin);
+						query_end = std::max(query_end, node_end);
+					}
+				} while (ts_tree_cursor_goto_next_sibling(&cursor));
+			}
+			ts_tree_cursor_delete(&cursor);
+		}
+
+		highlight_collector collector(
+			input, *_interp, _parser, *_lang, [](std::u8string_view name) {
+				return _details::get_manager().find_lanaguage(std::u8string(name));
+			},
+			&_cancellation_token, [this]() {
+				return _yield_lock();
+			},
+			std::move(tree), query_begin, query_end
+		);
+		result.data = collector.compute(_parser);
+		std::atomic_ref<std::size_t> cancel(_cancellation_token);
+		if (cancel != 0) { // the lock may have been released
+			return std::nullopt;
+		}
+		if (!result.full) {
+			editors::code::interpretation::character_position_converter conv(*_interp);
+			result.range_begin = conv.byte_to_character(query_begin);
+			result.range_end = conv.byte_to_character(query_end);
+		}
+		return result;
+	}
+
 
 	interpretation_tag::interpretation_tag(
 		editors::code::interpretation &interp, const language_configuration *config, manager &man
@@ -69,23 +211,27 @@ namespace codepad::tree_sitter {
 		_parser.set(ts_parser_new());
 
 		_begin_edit_token = _interp->get_buffer().begin_edit += [this](editors::buffer::begin_edit_info&) {
-			if (auto task = _task_token.get_task()) {
-				task->cancel();
-				// ensure that there's only one instance of the task running at any given time, so that when this tag
-				// is removed, there won't be a task that still uses this tag and the language
-				task->wait_finish();
-			}
+			// don't wait for the tasks; they release the buffer lock between chunks of work and stop once they notice
+			// the cancellation, and their results will be discarded because of the new edit version
+			cancel_highlight_task();
+			++_edit_version;
 		};
+		_end_modify_token = _interp->get_buffer().end_modify +=
+			[this](editors::buffer::end_modification_info &info) {
+				_on_modification(info);
+			};
 		_end_edit_token = _interp->get_buffer().end_edit += [this](editors::buffer::end_edit_info&) {
 			start_highlight_task();
 		};
 		_lang_changed_token = _interp->get_buffer().language_changed +=
 			[this](editors::buffer::language_changed_info&) {
-				if (auto task = _task_token.get_task()) {
-					task->cancel();
-					task->wait_finish();
-				}
+				cancel_highlight_task();
 				_lang = _manager->find_lanaguage(_interp->get_buffer().get_language().back());
+				// the old tree is useless for the new language
+				_tree.reset();
+				_invalidated_range.reset();
+				_full_highlight = true;
+				++_edit_version;
 				start_highlight_task();
 			};
 
@@ -99,40 +245,118 @@ namespace codepad::tree_sitter {
 		start_highlight_task();
 	}
 
-	highlight_collector::document_highlight_data interpretation_tag::compute_highlight(std::size_t *cancel_tok) {
-		if (!_lang) {
-			return highlight_collector::document_highlight_data();
-		}
-
-		_payload payload{ .interpretation = *_interp };
-		TSInput input;
-		input.payload = &payload;
-		input.read = [](void *payload_void, uint32_t byte_index, TSPoint, uint32_t *bytes_read) {
-			_payload *payload = static_cast<_payload*>(payload_void);
+	void interpretation_tag::start_highlight_task() {
+		// forget about tasks that have finished
+		std::erase_if(_task_tokens, [](const ui::async_task_scheduler::token<_highlight_task> &tok) {
+			return tok.get_task() == nullptr;
+		});
+		auto task = std::make_shared<_highlight_task>(*this);
+		auto &tok = _task_tokens.emplace_back(
+			get_manager().get_manager().get_async_task_scheduler().start_task(std::move(task))
+		);
+		tok.weaken(); // so that there's no cyclic dependency
+	}
 
-			auto byte_end =
-				std::min<std::size_t>(byte_index + 1024, payload->interpretation.get_buffer().length());
-			*bytes_read = byte_end - byte_index;
-			payload->read_buffer = payload->interpretation.get_buffer().get_clip(
-				payload->interpretation.get_buffer().at(byte_index),
-				payload->interpretation.get_buffer().at(byte_end)
-			);
-			return reinterpret_cast<const char*>(payload->read_buffer.data());
+	TSPoint interpretation_tag::_get_point_of_byte(std::size_t pos) const {
+		// bytes before the modified position are the same before and after the modification, so this works
+		// regardless of whether the interpretation has handled the modification. lines ending with a single CR are
+		// counted as lines here, but not by tree-sitter; this only affects the points of nodes and not parsing
+		editors::code::interpretation::codepoint_position_converter conv(*_interp);
+		std::size_t cp = conv.byte_to_codepoint(pos).first;
+		auto line_col = _interp->get_linebreaks().get_line_and_column_of_codepoint(cp);
+		conv.reset();
+		std::size_t line_begin = conv.codepoint_to_byte(cp - line_col.position_in_line);
+		return TSPoint{
+			.row = static_cast<uint32_t>(line_col.line),
+			.column = static_cast<uint32_t>(pos - line_begin)
 		};
-		input.encoding = TSInputEncodingUTF8;
+	}
 
-		highlight_collector collector(
-			input, *_interp, _parser, *_lang, [](std::u8string_view name) {
-				return _details::get_manager().find_lanaguage(std::u8string(name));
-			},
-			cancel_tok
-		);
-		return collector.compute(_parser);
+	void interpretation_tag::_on_modification(const editors::buffer::end_modification_info &info) {
+		std::size_t
+			pos = info.position,
+			erase_end = pos + info.bytes_erased.size(),
+			insert_end = pos + info.bytes_inserted.size();
+		if (_tree) {
+			auto advance = [](TSPoint pt, const byte_string &bytes) {
+				for (std::byte b : bytes) {
+					if (b == static_cast<std::byte>('\n')) {
+						++pt.row;
+						pt.column = 0;
+					} else {
+						++pt.column;
+					}
+				}
+				return pt;
+			};
+
+			TSInputEdit edit;
+			edit.start_byte = static_cast<uint32_t>(pos);
+			edit.old_end_byte = static_cast<uint32_t>(erase_end);
+			edit.new_end_byte = static_cast<uint32_t>(insert_end);
+			edit.start_point = _get_point_of_byte(pos);
+			edit.old_end_point = advance(edit.start_point, info.bytes_erased);
+			edit.new_end_point = advance(edit.start_point, info.bytes_inserted);
+			ts_tree_edit(_tree.get(), &edit);
+		}
+		if (!_full_highlight) {
+			std::size_t beg = pos, end = insert_end;
+			if (_invalidated_range) {
+				auto map_position = [&](std::size_t p) {
+					if (p <= pos) {
+						return p;
+					}
+					return p >= erase_end ? p - erase_end + insert_end : insert_end;
+				};
+				beg = std::min(beg, map_position(_invalidated_range->first));
+				end = std::max(end, map_position(_invalidated_range->second));
+			}
+			_invalidated_range.emplace(beg, end);
+		}
 	}
 
-	void interpretation_tag::start_highlight_task() {
-		auto task = std::make_shared<_highlight_task>(*this);
-		_task_token = get_manager().get_manager().get_async_task_scheduler().start_task(std::move(task));
-		_task_token.weaken(); // so that there's no cyclic dependency
+	void interpretation_tag::_apply_highlight_update(highlight_update update, std::size_t edit_version) {
+		if (edit_version != _edit_version) {
+			// the document has been modified after the task was started; the results are outdated, but the
+			// invalidated range and the edited tree are kept and will be handled by the task started for that
+			// modification
+			return;
+		}
+		_tree = std::move(update.tree);
+		auto mod = _theme_token.get_modifier();
+		if (update.full) {
+			*mod = std::move(update.data.theme);
+			_capture_names = std::move(update.data.capture_names);
+			_capture_name_indices.clear();
+			for (std::size_t i = 0; i < _capture_names.size(); ++i) {
+				_capture_name_indices.emplace(_capture_names[i], static_cast<std::int32_t>(i));
+			}
+		} else {
+			// map cookies to indices in _capture_names
+			std::vector<std::int32_t> cookies;
+			for (std::u8string &name : update.data.capture_names) {
+				auto [it, inserted] = _capture_name_indices.emplace(
+					name, static_cast<std::int32_t>(_capture_names.size())
+				);
+				if (inserted) {
+					_capture_names.emplace_back(std::move(name));
+				}
+				cookies.emplace_back(it->second);
+			}
+
+			auto &ranges = update.data.theme.ranges;
+			auto [erased_begin, erased_end] =
+				mod->ranges.erase_ranges_overlapping(update.range_begin, update.range_end);
+			mod.mark_changed(erased_begin, erased_end);
+			for (auto it = ranges.begin_position(); it.get_iterator() != ranges.end(); it.move_next()) {
+				editors::code::document_theme::range_value value = it.get_iterator()->value;
+				value.cookie = cookies[static_cast<std::size_t>(value.cookie)];
+				std::size_t start = it.get_range_start(), end = start + it.get_iterator()->length;
+				mod->add_range(start, end, value);
+				mod.mark_changed(start, end);
+			}
+		}
+		_full_highlight = false;
+		_invalidated_range.reset();
 	}
 }
@@ -7,30 +7,113 @@
 /// Implementation of certain AST functionalities such as analysis.
 
 namespace codepad::regex {
+	namespace _details {
+		/// Adds two lengths, saturating at \p std::numeric_limits<std::size_t>::max() which indicates that the
+		/// length is unbounded.
+		[[nodiscard]] std::size_t saturating_add(std::size_t a, std::size_t b) {
+			constexpr std::size_t _max = std::numeric_limits<std::size_t>::max();
+			return a > _max - b ? _max : a + b;
+		}
+		/// Multiplies two lengths, saturating at \p std::numeric_limits<std::size_t>::max().
+		[[nodiscard]] std::size_t saturating_multiply(std::size_t a, std::size_t b) {
+			constexpr std::size_t _max = std::numeric_limits<std::size_t>::max();
+			return b != 0 && a > _max / b ? _max : a * b;
+		}
+		/// Combines the current analysis of all capture groups that satisfy the given predicate. Multiple groups
+		/// can share the same index or name. If no group matches, the default (unbounded) analysis is returned.
+		template <typename Pred> [[nodiscard]] ast_nodes::analysis analyze_referenced_groups(
+			const ast &tree, const std::vector<ast_nodes::node_ref> &groups, const ast::analysis &current,
+			Pred &&pred
+		) {
+			ast_nodes::analysis result;
+			bool found = false;
+			for (auto group : groups) {
+				if (pred(std::get<ast_nodes::subexpression>(tree.get_node(group).value))) {
+					ast_nodes::analysis group_analysis = current.get_for(group);
+					if (found) {
+						result.minimum_length = std::min(result.minimum_length, group_analysis.minimum_length);
+						result.maximum_length = std::max(result.maximum_length, group_analysis.maximum_length);
+					} else {
+						result = group_analysis;
+						found = true;
+					}
+				}
+			}
+			return result;
+		}
+	}
+
 	ast::analysis ast::analyze() const {
 		_analysis_context ctx;
 		ctx.output._node_analysis.resize(_nodes.size());
 		// figure out the order in which we need to analyze the nodes
 		ctx.dependency_queue.emplace_back(_root);
 		while (!ctx.dependency_queue.empty()) {
-			ctx.end_stack.emplace_back(ctx.dependency_queue.front());
-			_collect_dependencies(ctx.dependency_queue.front(), ctx);
+			auto cur = ctx.dependency_queue.front();
+			const auto &cur_node = get_node(cur);
+			if (auto *expr = std::get_if<ast_nodes::subexpression>(&cur_node.value)) {
+				if (expr->subexpr_type == ast_nodes::subexpression::type::normal) {
+					ctx.capture_groups.emplace_back(cur);
+				}
+			} else if (
+				cur_node.is<ast_nodes::numbered_subroutine>() || cur_node.is<ast_nodes::named_subroutine>()
+			) {
+				++ctx.num_subroutines;
+			}
+			ctx.end_stack.emplace_back(cur);
+			_collect_dependencies(cur, ctx);
 			ctx.dependency_queue.pop_front();
 		}
 		// actually analyze all nodes
-		for (auto it = ctx.end_stack.rbegin(); it != ctx.end_stack.rend(); ++it) {
-			_analyze(*it, ctx);
+		// subroutines depend on groups that may be analyzed after them, so the analysis is repeated until it
+		// stabilizes. every pass only narrows the bounds of the previous one, so all intermediate results are
+		// valid; recursive groups may not converge, in which case we stop after one pass for every subroutine
+		for (std::size_t pass = 0; pass <= ctx.num_subroutines; ++pass) {
+			bool changed = false;
+			for (auto it = ctx.end_stack.rbegin(); it != ctx.end_stack.rend(); ++it) {
+				ast_nodes::analysis old_analysis = ctx.output.get_for(*it);
+				_analyze(*it, ctx);
+				ast_nodes::analysis new_analysis = ctx.output.get_for(*it);
+				if (
+					new_analysis.minimum_length != old_analysis.minimum_length ||
+					new_analysis.maximum_length != old_analysis.maximum_length
+				) {
+					changed = true;
+				}
+			}
+			if (!changed) {
+				break;
+			}
 		}
 		return std::move(ctx.output);
 	}
 
+	ast_nodes::analysis ast::_analyze(const ast_nodes::numbered_subroutine &n, _analysis_context &ctx) const {
+		if (n.index == 0) {
+			return ctx.output.get_for(_root);
+		}
+		return _details::analyze_referenced_groups(
+			*this, ctx.capture_groups, ctx.output, [&](const ast_nodes::subexpression &expr) {
+				return expr.capture_index == n.index;
+			}
+		);
+	}
+
+	ast_nodes::analysis ast::_analyze(const ast_nodes::named_subroutine &n, _analysis_context &ctx) const {
+		return _details::analyze_referenced_groups(
+			*this, ctx.capture_groups, ctx.output, [&](const ast_nodes::subexpression &expr) {
+				return expr.capture_name == n.name;
+			}
+		);
+	}
+
 	ast_nodes::analysis ast::_analyze(const ast_nodes::subexpression &n, _analysis_context &ctx) const {
 		ast_nodes::analysis result;
 		result.minimum_length = result.maximum_length = 0;
 		for (auto child : n.nodes) {
 			auto child_analysis = ctx.output.get_for(child);
-			result.minimum_length += child_analysis.minimum_length;
-			result.maximum_length += child_analysis.maximum_length;
+			result.minimum_length = _details::saturating_add(result.minimum_length, child_analysis.minimum_length);
+			result.maximum_length = _details::saturating_add(result.maximum_length, child_analysis.maximum_length);
 		}
 		return result;
 	}
@@ -55,7 +138,7 @@ namespace codepad::regex {
 		ast_nodes::analysis result;
 		ast_nodes::analysis subject_analysis = ctx.output.get_for(n.expression);
 		// minimum length
-		result.minimum_length = subject_analysis.minimum_length * n.min;
+		result.minimum_length = _details::saturating_multiply(subject_analysis.minimum_length, n.min);
 		// maximum length
 		if (n.max == ast_nodes::repetition::no_limit) {
 			result.maximum_length =
@@ -63,7 +146,7 @@ namespace codepad::regex {
 				std::numeric_limits<std::size_t>::max() :
 				0;
 		} else {
-			result.maximum_length = subject_analysis.maximum_length * n.max;
+			result.maximum_length = _details::saturating_multiply(subject_analysis.maximum_length, n.max);
 		}
 		return result;
 	}
@@ -72,6 +155,11 @@ namespace codepad::regex {
 		const ast_nodes::conditional_expression &n, _analysis_context &ctx
 	) const {
 		ast_nodes::analysis result;
+		if (std::holds_alternative<ast_nodes::conditional_expression::define>(n.condition)) {
+			// the condition is always false, so the definitions never match anything here
+			result.minimum_length = result.maximum_length = 0;
+			return result;
+		}
 		result = ctx.output.get_for(n.if_true);
 		if (n.if_false) {
 			ast_nodes::analysis false_analysis = ctx.output.get_for(n.if_false.value());
@@ -7,6 +7,36 @@
 /// Regex tests using the PCRE2 test data.
 
 namespace codepad::regex {
+	void first_codepoint_set::finalize() {
+		ranges.sort_and_compact();
+		case_insensitive_ranges.sort_and_compact();
+		for (codepoint cp = 0; cp < _ascii.size(); ++cp) {
+			_ascii[cp] = _contains_slow(cp);
+		}
+	}
+
+	bool first_codepoint_set::_contains_slow(codepoint cp) const {
+		if (ranges.contains(cp)) {
+			return true;
+		}
+		if (case_insensitive_ranges.ranges.empty()) {
+			return false;
+		}
+		if (case_insensitive_ranges.contains(cp)) {
+			return true;
+		}
+		if (case_insensitive_ranges.contains(unicode::case_folding::fold_simple(cp))) {
+			return true;
+		}
+		for (auto folded : unicode::case_folding::inverse_fold_simple(cp)) {
+			if (case_insensitive_ranges.contains(folded)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+
 	namespace half_compiled {
 		compiled_unoptimized::state_ref state_machine::create_state() {
 			std::size_t res_idx = states.size();
@@ -227,6 +257,9 @@ namespace codepad::regex {
 			jmp.target = group_info.end;
 		}
 
+		_result.first_codepoints = _find_first_codepoints();
+		_result.requires_backtracking = _requires_backtracking();
+
 		_capture_names.clear();
 		_captures.clear();
 		_subroutines.clear();
@@ -236,6 +269,97 @@ namespace codepad::regex {
 		return std::move(_result);
 	}
 
+	std::optional<first_codepoint_set> compiler::_find_first_codepoints() const {
+		using _transitions = compiled_unoptimized::transitions;
+
+		first_codepoint_set result;
+		std::vector<bool> visited(_result.states.size(), false);
+		std::vector<compiled_unoptimized::state_ref> stack;
+		stack.emplace_back(_result.start_state);
+		visited[_result.start_state.get_index()] = true;
+		while (!stack.empty()) {
+			compiled_unoptimized::state_ref cur = stack.back();
+			stack.pop_back();
+			if (cur == _result.end_state) { // the expression can match an empty string
+				return std::nullopt;
+			}
+			for (const auto &trans : _result.states[cur.get_index()].transitions) {
+				// whether this transition consumes no codepoints and should be followed
+				bool follow = false;
+				if (auto *lit = std::get_if<_transitions::literal>(&trans.condition)) {
+					if (lit->contents.empty()) {
+						follow = true;
+					} else {
+						// contents of case-insensitive literals are already folded
+						auto &list = lit->case_insensitive ? result.case_insensitive_ranges : result.ranges;
+						list.ranges.emplace_back(lit->contents.front());
+					}
+				} else if (auto *cls = std::get_if<_transitions::character_class>(&trans.condition)) {
+					auto &list = cls->case_insensitive ? result.case_insensitive_ranges : result.ranges;
+					if (cls->is_negate) {
+						if (cls->case_insensitive) { // the negated set is hard to compute
+							return std::nullopt;
+						}
+						codepoint_range_list sorted = cls->ranges;
+						sorted.sort_and_compact();
+						codepoint_range_list negated = sorted.get_negated();
+						list.ranges.insert(list.ranges.end(), negated.ranges.begin(), negated.ranges.end());
+					} else {
+						list.ranges.insert(list.ranges.end(), cls->ranges.ranges.begin(), cls->ranges.ranges.end());
+					}
+				} else if (
+					// these transitions don't consume codepoints; assertions are treated as if they always succeed,
+					// which may only add codepoints to the set
+					std::holds_alternative<_transitions::simple_assertion>(trans.condition) ||
+					std::holds_alternative<_transitions::character_class_assertion>(trans.condition) ||
+					std::holds_alternative<_transitions::capture_begin>(trans.condition) ||
+					std::holds_alternative<_transitions::capture_end>(trans.condition) ||
+					std::holds_alternative<_transitions::reset_match_start>(trans.condition) ||
+					std::holds_alternative<_transitions::push_atomic>(trans.condition) ||
+					std::holds_alternative<_transitions::pop_atomic>(trans.condition) ||
+					std::holds_alternative<_transitions::push_position>(trans.condition) ||
+					std::holds_alternative<_transitions::check_infinite_loop>(trans.condition)
+				) {
+					follow = true;
+				} else {
+					// backreferences, subroutines, lookarounds, conditions, and marks which are reported even when
+					// the match fails
+					return std::nullopt;
+				}
+
+				if (follow && !visited[trans.new_state.get_index()]) {
+					visited[trans.new_state.get_index()] = true;
+					stack.emplace_back(trans.new_state);
+				}
+			}
+		}
+		result.finalize();
+		return result;
+	}
+
+	bool compiler::_requires_backtracking() const {
+		using _transitions = compiled_unoptimized::transitions;
+
+		for (const auto &state : _result.states) {
+			for (const auto &trans : state.transitions) {
+				bool supported =
+					std::holds_alternative<_transitions::literal>(trans.condition) ||
+					std::holds_alternative<_transitions::character_class>(trans.condition) ||
+					std::holds_alternative<_transitions::simple_assertion>(trans.condition) ||
+					std::holds_alternative<_transitions::character_class_assertion>(trans.condition) ||
+					std::holds_alternative<_transitions::capture_begin>(trans.condition) ||
+					std::holds_alternative<_transitions::capture_end>(trans.condition) ||
+					std::holds_alternative<_transitions::reset_match_start>(trans.condition) ||
+					std::holds_alternative<_transitions::push_position>(trans.condition) ||
+					std::holds_alternative<_transitions::check_infinite_loop>(trans.condition);
+				if (!supported) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
 	void compiler::_compile(
 		compiled_unoptimized::state_ref start, compiled_unoptimized::state_ref end, const ast_nodes::literal &node
 	) {
@@ -244,7 +368,7 @@ namespace codepad::regex {
 		cond.case_insensitive = node.case_insensitive;
 		if (node.case_insensitive) {
 			for (codepoint cp : node.contents) {
-				cond.contents.push_back(unicode::case_folding::get_cached().fold_simple(cp));
+				cond.contents.push_back(unicode::case_folding::fold_simple(cp));
 			}
 		} else {
 			cond.contents = node.contents;
@@ -11,10 +11,9 @@
 namespace codepad::regex {
 	namespace tables {
 		const codepoint_range_list &horizontal_whitespaces() {
-			static codepoint_range_list _result;
-
-			if (_result.ranges.empty()) {
-				_result.ranges = {
+			static const codepoint_range_list _result = [] {
+				codepoint_range_list result;
+				result.ranges = {
 					codepoint_range(0x0009), // horizontal tab
 					codepoint_range(0x0020), // space
 					codepoint_range(0x00A0), // non-break space
@@ -35,17 +34,16 @@ namespace codepad::regex {
 					codepoint_range(0x205F), // medium mathematical space
 					codepoint_range(0x3000), // ideographic space
 				};
-				_result.sort_and_compact();
-			}
-
+				result.sort_and_compact();
+				return result;
+			}();
 			return _result;
 		}
 
 		const codepoint_range_list &vertical_whitespaces() {
-			static codepoint_range_list _result;
-
-			if (_result.ranges.empty()) {
-				_result.ranges = {
+			static const codepoint_range_list _result = [] {
+				codepoint_range_list result;
+				result.ranges = {
 					codepoint_range(0x000A), // linefeed
 					codepoint_range(0x000B), // vertical tab
 					codepoint_range(0x000C), // form feed
@@ -54,17 +52,16 @@ namespace codepad::regex {
 					codepoint_range(0x2028), // line separator
 					codepoint_range(0x2029), // paragraph separator
 				};
-				_result.sort_and_compact();
-			}
-
+				result.sort_and_compact();
+				return result;
+			}();
 			return _result;
 		}
 
 		const codepoint_range_list &extended_mode_whitespaces() {
-			static codepoint_range_list _result;
-
-			if (_result.ranges.empty()) {
-				_result.ranges = {
+			static const codepoint_range_list _result = [] {
+				codepoint_range_list result;
+				result.ranges = {
 					codepoint_range(0x0009), // tab
 					codepoint_range(0x000A), // linefeed
 					codepoint_range(0x000B), // vertical tab
@@ -77,31 +74,28 @@ namespace codepad::regex {
 					codepoint_range(0x2028), // line separator
 					codepoint_range(0x2029), // paragraph separator
 				};
-				_result.sort_and_compact();
-			}
-
+				result.sort_and_compact();
+				return result;
+			}();
 			return _result;
 		}
 
 		const codepoint_range_list &word_characters() {
-			static codepoint_range_list _result;
-
-			if (_result.ranges.empty()) {
-				_result = unicode::unicode_data::cache::get_codepoints_in_category(
+			static const codepoint_range_list _result = [] {
+				codepoint_range_list result = unicode::unicode_data::cache::get_codepoints_in_category(
 					unicode::general_category::letter | unicode::general_category::number
 				);
-				_result.ranges.emplace_back(U'_');
-				_result.sort_and_compact();
-			}
-
+				result.ranges.emplace_back(U'_');
+				result.sort_and_compact();
+				return result;
+			}();
 			return _result;
 		}
 
 		const codepoint_range_list &newline_characters() {
-			static codepoint_range_list _result;
-
-			if (_result.ranges.empty()) {
-				_result.ranges = {
+			static const codepoint_range_list _result = [] {
+				codepoint_range_list result;
+				result.ranges = {
 					codepoint_range(0x000A), // line feed
 					codepoint_range(0x000B), // vertical tab
 					codepoint_range(0x000C), // form feed
@@ -110,27 +104,25 @@ namespace codepad::regex {
 					codepoint_range(0x2028), // line separator
 					codepoint_range(0x2029), // paragraph separator
 				};
-				_result.sort_and_compact();
-			}
-
+				result.sort_and_compact();
+				return result;
+			}();
 			return _result;
 		}
 
 		const codepoint_range_list &posix_spaces() {
-			static codepoint_range_list _result;
-
-			if (_result.ranges.empty()) {
-				_result = unicode::unicode_data::cache::get_codepoints_in_category(
+			static const codepoint_range_list _result = [] {
+				codepoint_range_list result = unicode::unicode_data::cache::get_codepoints_in_category(
 					unicode::general_category::separator
 				);
-				_result.ranges.emplace_back(0x0009); // horizontal tab
-				_result.ranges.emplace_back(0x000A); // line feed
-				_result.ranges.emplace_back(0x000B); // vertical tab
-				_result.ranges.emplace_back(0x000C); // form feed
-				_result.ranges.emplace_back(0x000D); // carriage return
-				_result.sort_and_compact();
-			}
-
+				result.ranges.emplace_back(0x0009); // horizontal tab
+				result.ranges.emplace_back(0x000A); // line feed
+				result.ranges.emplace_back(0x000B); // vertical tab
+				result.ranges.emplace_back(0x000C); // form feed
+				result.ranges.emplace_back(0x000D); // carriage return
+				result.sort_and_compact();
+				return result;
+			}();
 			return _result;
 		}
 	}
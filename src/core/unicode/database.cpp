@@ -9,6 +9,10 @@
 #include <fstream>
 #include <map>
 #include <charconv>
+#include <bit>
+#include <shared_mutex>
+
+#include "property_tables.inl"
 
 namespace codepad {
 	namespace unicode::database {
@@ -173,36 +177,132 @@ namespace codepad {
 
 
 		const unicode_data &unicode_data::cache::get_database() {
-			static unicode_data _database;
-
-			if (_database.entries.empty()) {
-				_database = parse("thirdparty/ucd/UnicodeData.txt");
-			}
+			// initialization of function-local statics is thread-safe
+			static const unicode_data _database = parse("thirdparty/ucd/UnicodeData.txt");
 			return _database;
 		}
 
 		const codepoint_range_list &unicode_data::cache::get_codepoints_in_category(
 			general_category_index category
 		) {
-			static std::array<
-				codepoint_range_list, static_cast<std::size_t>(general_category_index::num_categories)
-			> _cached;
+			static const auto _cached = [] {
+				std::array<
+					codepoint_range_list, static_cast<std::size_t>(general_category_index::num_categories)
+				> result;
+				for (std::size_t i = 0; i < result.size(); ++i) {
+					result[i] = _get_codepoints_in_category(
+						general_category_index_to_cateogry(static_cast<general_category_index>(i))
+					);
+				}
+				return result;
+			}();
 
-			auto &result = _cached[static_cast<std::size_t>(category)];
-			if (result.ranges.empty()) {
-				result = get_database().get_codepoints_in_category(general_category_index_to_cateogry(category));
-			}
-			return result;
+			return _cached[static_cast<std::size_t>(category)];
 		}
 
 		const codepoint_range_list &unicode_data::cache::get_codepoints_in_category(general_category category) {
+			auto bits = static_cast<std::underlying_type_t<general_category>>(category);
+			if (std::has_single_bit(bits)) { // a single category, no need to lock
+				return get_codepoints_in_category(static_cast<general_category_index>(std::countr_zero(bits)));
+			}
+
+			// combinations that have names, and those used by the regex parser, are computed once and can be
+			// looked up without locking
+			static const auto _named = [] {
+				constexpr general_category _combinations[]{
+					general_category::cased_letter,
+					general_category::letter,
+					general_category::mark,
+					general_category::number,
+					general_category::punctuation,
+					general_category::symbol,
+					general_category::separator,
+					general_category::other,
+					general_category::all,
+					general_category::letter | general_category::number,
+				};
+				std::array<std::pair<general_category, codepoint_range_list>, std::size(_combinations)> result;
+				for (std::size_t i = 0; i < result.size(); ++i) {
+					result[i].first = _combinations[i];
+					result[i].second = _get_codepoints_in_category(_combinations[i]);
+				}
+				return result;
+			}();
+			for (const auto &[named_category, codepoints] : _named) {
+				if (named_category == category) {
+					return codepoints;
+				}
+			}
+
+			// other combinations are computed on demand; entries are never removed, and references to elements of
+			// an unordered_map stay valid after insertions
+			static std::shared_mutex _lock;
 			static std::unordered_map<general_category, codepoint_range_list> _cached;
 
-			auto [it, inserted] = _cached.try_emplace(category);
-			if (inserted) {
-				it->second = get_database().get_codepoints_in_category(category);
+			{
+				std::shared_lock<std::shared_mutex> lock(_lock);
+				if (auto it = _cached.find(category); it != _cached.end()) {
+					return it->second;
+				}
 			}
-			return it->second;
+			codepoint_range_list result = _get_codepoints_in_category(category);
+			std::unique_lock<std::shared_mutex> lock(_lock);
+			return _cached.try_emplace(category, std::move(result)).first->second;
+		}
+
+		codepoint_range_list unicode_data::cache::_get_codepoints_in_category(general_category category) {
+			codepoint_range_list result;
+			for (std::size_t i = 0; i < static_cast<std::size_t>(general_category_index::num_categories); ++i) {
+				auto index = static_cast<general_category_index>(i);
+				if ((general_category_index_to_cateogry(index) & category) == general_category::unknown) {
+					continue;
+				}
+				for (
+					std::size_t j = tables::general_category_range_offsets[i];
+					j < tables::general_category_range_offsets[i + 1];
+					++j
+				) {
+					result.ranges.emplace_back(
+						tables::general_category_ranges[j * 2], tables::general_category_ranges[j * 2 + 1]
+					);
+				}
+			}
+			result.sort_and_compact();
+			return result;
+		}
+
+		/// Looks up the value of a codepoint in a two-stage table generated by \p unicode_dump.
+		template <
+			typename Block, std::size_t NumBlocks, typename Data, typename Default
+		> [[nodiscard]] static Default _lookup_property_table(
+			const Block (&blocks)[NumBlocks], const Data *data, codepoint cp, Default default_value
+		) {
+			constexpr codepoint _mask = (static_cast<codepoint>(1) << tables::property_block_bits) - 1;
+			std::size_t block = cp >> tables::property_block_bits;
+			if (block >= NumBlocks) {
+				return default_value;
+			}
+			std::size_t block_begin = static_cast<std::size_t>(blocks[block]) << tables::property_block_bits;
+			return static_cast<Default>(data[block_begin | (cp & _mask)]);
+		}
+
+		general_category get_general_category(codepoint cp) {
+			auto index = _lookup_property_table(
+				tables::general_category_blocks, tables::general_category_data, cp,
+				general_category_index::unassigned
+			);
+			return general_category_index_to_cateogry(index);
+		}
+
+		bidi_class get_bidi_class(codepoint cp) {
+			return _lookup_property_table(tables::bidi_class_blocks, tables::bidi_class_data, cp, bidi_class::unknown);
+		}
+
+		std::uint8_t get_canonical_combining_class(codepoint cp) {
+			return _lookup_property_table(
+				tables::canonical_combining_class_blocks, tables::canonical_combining_class_data, cp,
+				static_cast<std::uint8_t>(0)
+			);
 		}
 
 
@@ -275,11 +375,7 @@ namespace codepad {
 		}
 
 		const property_list &property_list::get_cached() {
-			static property_list _list;
-
-			if (_list.white_space.ranges.empty()) {
-				_list = parse("thirdparty/ucd/PropList.txt");
-			}
+			static const property_list _list = parse("thirdparty/ucd/PropList.txt");
 			return _list;
 		}
 
@@ -319,45 +415,11 @@ namespace codepad {
 				}
 				assert_true_logical(inserted, "duplicate case folding entries");
 			}
-			// compute inverse simple mapping
-			for (const auto &[from, to] : result.simple) {
-				result._simple_inverse_info.try_emplace(to).first->second.count++;
-			}
-			std::vector<std::size_t> count(result._simple_inverse_info.size(), 0);
-			result._simple_inverse_data.resize(result.simple.size());
-			std::size_t index = 0, total = 0;
-			for (
-				auto it = result._simple_inverse_info.begin();
-				it != result._simple_inverse_info.end();
-				++it, ++index
-			) {
-				it->second.begin = total;
-				total += it->second.count;
-				count[index] = it->second.count;
-			}
-			for (const auto &[from, to] : result.simple) {
-				auto found = result._simple_inverse_info.find(to);
-				--found->second.count;
-				result._simple_inverse_data[found->second.begin + found->second.count] = from;
-			}
-			auto count_it = count.begin();
-			for (
-				auto it = result._simple_inverse_info.begin();
-				it != result._simple_inverse_info.end();
-				++it, ++count_it
-			) {
-				assert_true_logical(it->second.count == 0, "incorrect inverse simple case folding mappping");
-				it->second.count = *count_it;
-			}
 			return result;
 		}
 
 		const case_folding &case_folding::get_cached() {
-			static case_folding _res;
-
-			if (_res.simple.empty()) {
-				_res = parse("thirdparty/ucd/CaseFolding.txt");
-			}
+			static const case_folding _res = parse("thirdparty/ucd/CaseFolding.txt");
 			return _res;
 		}
 	}
@@ -159,9 +159,9 @@ namespace codepad::os {
 		if (GetLastError() == ERROR_ALREADY_EXISTS) {
 			return std::error_code(ERROR_ALREADY_EXISTS, std::system_category());
 		}
-		void *ptr = MapViewOfFile(_handle, acc == access_rights::read ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, 0);
+		void *ptr = MapViewOfFile(handle, acc == access_rights::read ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, 0);
 		if (!ptr) {
-			CloseHandle(_handle); // no point checking the result
+			CloseHandle(handle); // no point checking the result
 			return _details::make_error_result<file_mapping>();
 		}
 		file_mapping result;
@@ -140,8 +140,7 @@ namespace codepad::ui::cairo {
 		cairo_t *context = _render_stack.top().context;
 		cairo_save(context);
 		{
-			// reset state
-			cairo_reset_clip(context);
+			// the clip is kept so that partial redraws only clear the damaged region
 			cairo_set_operator(context, CAIRO_OPERATOR_SOURCE);
 			// clear
 			cairo_set_source_rgba(context, color.r, color.g, color.b, color.a);
@@ -81,7 +81,18 @@ namespace codepad::ui {
 		return nullptr;
 	}
 
+	rectd element::get_window_bounds() const {
+		matd3x3 trans = matd3x3::identity();
+		for (const element *cur = this; cur && !cur->_get_as_window(); cur = cur->parent()) {
+			trans = cur->_get_local_render_matrix() * trans;
+		}
+		return trans.transform_bounding_box(rectd::from_corners(vec2d(), get_layout().size()));
+	}
+
 	void element::invalidate_visual() {
+		for (element *cur = this; cur; cur = cur->parent()) {
+			cur->_layer_valid = false;
+		}
 		get_manager().get_scheduler().invalidate_visual(*this);
 	}
 
@@ -141,6 +152,17 @@ namespace codepad::ui {
 					u8"element.clip_to_bounds"
 				);
 			}
+			if (path.front().property == u8"cache_layer") {
+				return property_info::make_getter_setter_property_info<element, bool>(
+					[](const element &e) {
+						return e.get_cache_layer();
+					},
+					[](element &e, bool val) {
+						e.set_cache_layer(val);
+					},
+					u8"element.cache_layer"
+				);
+			}
 
 		}
 		logger::get().log_error() <<
@@ -194,6 +216,9 @@ namespace codepad::ui {
 				"layout system produced nan on " << demangle(typeid(*this).name());
 		}
 		invalidate_visual();
+		if (parent()) {
+			parent()->invalidate_visual();
+		}
 		layout_changed.invoke();
 	}
 
@@ -224,14 +249,16 @@ namespace codepad::ui {
 		// TODO handle visibility::focus
 	}
 
-	void element::_on_prerender() {
+	matd3x3 element::_get_local_render_matrix() const {
 		vec2d offset = get_layout().xmin_ymin();
 		if (parent()) {
 			offset -= parent()->get_layout().xmin_ymin();
 		}
-		get_manager().get_renderer().push_matrix_mult(
-			matd3x3::translate(offset) * get_visual_parameters().transform.get_matrix(get_layout().size())
-		);
+		return matd3x3::translate(offset) * get_visual_parameters().transform.get_matrix(get_layout().size());
+	}
+
+	void element::_on_prerender() {
+		get_manager().get_renderer().push_matrix_mult(_get_local_render_matrix());
 		if (_clip_to_bounds) {
 			get_manager().get_renderer().push_rectangle_clip(rectd::from_corners(vec2d(), _layout.size()));
 		}
@@ -256,10 +283,63 @@ namespace codepad::ui {
 		get_manager().get_renderer().pop_matrix();
 	}
 
+	void element::_render_cached_layer() {
+		window *wnd = get_window();
+		vec2d size = get_layout().size();
+		if (!wnd || _get_as_window() || size.x <= 0.0 || size.y <= 0.0) {
+			_custom_render();
+			return;
+		}
+		renderer_base &rend = get_manager().get_renderer();
+		vec2d scaling = wnd->get_scaling_factor();
+		// only recreate the layer when its size changes; otherwise it's reused and cleared before being redrawn
+		if (
+			!_layer.target ||
+			_layer_size.x != size.x || _layer_size.y != size.y ||
+			_layer_scaling_factor.x != scaling.x || _layer_scaling_factor.y != scaling.y
+		) {
+			_layer = rend.create_render_target(size, scaling, colord(0.0, 0.0, 0.0, 0.0));
+			_layer_size = size;
+			_layer_scaling_factor = scaling;
+			_layer_valid = false;
+		}
+		if (!_layer_valid) {
+			// the layer is in a different coordinate system, so it should not be culled against the damaged
+			// region of the window
+			std::optional<rectd> damage = std::exchange(wnd->_rendering_damage, std::nullopt);
+			rend.begin_drawing(*_layer.target);
+			rend.clear(colord(0.0, 0.0, 0.0, 0.0));
+			_custom_render();
+			rend.end_drawing();
+			wnd->_rendering_damage = damage;
+			_layer_valid = true;
+		}
+		rend.draw_rectangle(
+			rectd::from_corners(vec2d(), size),
+			generic_brush(brushes::bitmap_pattern(_layer.target_bitmap.get())),
+			generic_pen()
+		);
+	}
+
 	void element::_on_render() {
 		if (is_visible(visibility::visual)) {
+			if (_clip_to_bounds || _cache_layer) { // skip this element if it's outside of the damaged region
+				if (window *wnd = get_window()) {
+					if (const std::optional<rectd> &damage = wnd->get_rendering_damage()) {
+						rectd bounds = (get_manager().get_renderer().get_matrix() * _get_local_render_matrix())
+							.transform_bounding_box(rectd::from_corners(vec2d(), get_layout().size()));
+						if (!rectd::common_part(bounds, *damage).has_positive_area()) {
+							return;
+						}
+					}
+				}
+			}
 			_on_prerender();
-			_custom_render();
+			if (_cache_layer) {
+				_render_cached_layer();
+			} else {
+				_custom_render();
+			}
 			_on_postrender();
 		}
 	}
@@ -6,6 +6,9 @@
 /// \file
 /// Implementation of the scheduler.
 
+#include <map>
+#include <vector>
+
 #include "codepad/ui/element.h"
 #include "codepad/ui/panel.h"
 #include "codepad/ui/window.h"
@@ -73,21 +76,40 @@ namespace codepad::ui {
 			return;
 		}
 		performance_monitor mon(u8"render", render_time_redline);
-		// gather the list of windows to render
-		std::set<window*> ss;
+		// gather the list of windows to render, and the regions in them that need redrawing
+		std::set<window*> full;
+		std::map<window*, std::vector<rectd>> partial;
 		for (auto i : _dirty) {
 			window *wnd = i->get_window();
 			if (!wnd) {
 				wnd = dynamic_cast<window*>(i);
 			}
-			if (wnd) {
-				ss.insert(wnd);
+			if (!wnd) {
+				continue;
+			}
+			// everything rendered by an element is within the bounds of its nearest ancestor that clips its
+			// contents; if there's no such ancestor, the entire window needs to be redrawn
+			element *clip = i;
+			while (clip != wnd && !clip->get_clip_to_bounds() && !clip->get_cache_layer()) {
+				clip = clip->parent();
+			}
+			if (clip == wnd) {
+				full.insert(wnd);
+			} else {
+				partial[wnd].emplace_back(clip->get_window_bounds());
 			}
 		}
 		_dirty.clear();
-		for (auto i : ss) {
+		for (auto i : full) {
 			i->invalidate_window_visuals();
 		}
+		for (auto &[wnd, rects] : partial) {
+			if (!full.contains(wnd)) {
+				for (const rectd &r : rects) {
+					wnd->invalidate_window_region(r);
+				}
+			}
+		}
 	}
 
 	void scheduler::update_synchronous_tasks() {
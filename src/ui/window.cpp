@@ -81,13 +81,34 @@ namespace codepad::ui {
 
 	void window::_on_prerender() {
 		get_manager().get_renderer().begin_drawing(*this);
-		get_manager().get_renderer().clear(colord(0.0, 0.0, 0.0, 0.0));
+		if (_is_full_redraw()) {
+			get_manager().get_renderer().clear(colord(0.0, 0.0, 0.0, 0.0));
+		}
 		panel::_on_prerender();
 	}
 
+	void window::_custom_render() const {
+		if (_is_full_redraw()) {
+			_render_contents();
+			return;
+		}
+		renderer_base &rend = get_manager().get_renderer();
+		matd3x3 trans = rend.get_matrix();
+		for (const rectd &r : _damage.get_rectangles()) {
+			_rendering_damage = trans.transform_bounding_box(r);
+			rend.push_rectangle_clip(r);
+			rend.clear(colord(0.0, 0.0, 0.0, 0.0));
+			_render_contents();
+			rend.pop_clip();
+		}
+		_rendering_damage.reset();
+	}
+
 	void window::_on_postrender() {
 		panel::_on_postrender();
 		get_manager().get_renderer().end_drawing();
+		_damage.clear();
+		_full_redraw = false;
 	}
 
 	void window::_initialize() {
@@ -65,6 +65,7 @@ using tree = cp::red_black_tree::tree<
 enum class operations : unsigned char {
 	insert, ///< Insertion of one element into a tree.
 	insert_subtree, ///< Insertion of a range of elements into a tree.
+	insert_range, ///< Insertion of a range of elements into a tree using a tree built in linear time.
 	insert_tree, ///< Insertion of a new tree into the array of trees.
 	erase, ///< Removal of one element from a tree.
 	erase_subtree, ///< Removal of a range of elements from a tree.
@@ -124,6 +125,22 @@ public:
 				ref_arr.insert(ref_arr.begin() + minor_index, test_values.begin(), test_values.end());
 			}
 			break;
+		case operations::insert_range:
+			{
+				std::size_t major_index = random_index(_reference_data);
+				std::size_t minor_index = random_insertion_index(_reference_data[major_index]);
+				std::vector<int> test_values(random_int(insert_count_range));
+				for (int &v : test_values) {
+					v = random_token<int>();
+				}
+				// test
+				tree &test_tree = _test_data[major_index];
+				test_tree.insert_range_before_copy(at(test_tree, minor_index), test_values.begin(), test_values.end());
+				// reference
+				auto &ref_arr = _reference_data[major_index];
+				ref_arr.insert(ref_arr.begin() + minor_index, test_values.begin(), test_values.end());
+			}
+			break;
 		case operations::insert_tree:
 			{
 				std::size_t major_index = random_insertion_index(_reference_data);
@@ -197,7 +214,7 @@ public:
 				if (!left_tree.empty()) {
 					_test_data.insert(_test_data.begin() + major_index, std::move(left_tree));
 				}
-				delete mid;
+				tree::destroy_node(mid);
 				// reference
 				auto &ref_arr = _reference_data[major_index];
 				std::vector<int> second(ref_arr.begin() + (minor_index + 1), ref_arr.end());
@@ -0,0 +1,79 @@
+// Copyright (c) the Codepad contributors. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See LICENSE.txt in the project root for license information.
+
+/// \file
+/// Tests for character classes and literals in finalized state machines. Latin-1 codepoints are looked up in a
+/// bitmap, while other codepoints are looked up in the sorted ranges of the shared range pool.
+
+#include "common.h"
+
+namespace character_classes {
+	using data_types = cp::regex::data_types::unoptimized; ///< Data types.
+
+	/// Checks that the given pattern matches exactly the codepoints in \p expected among \p tested.
+	void check(
+		std::u8string_view pattern, std::initializer_list<cp::codepoint> tested,
+		std::initializer_list<cp::codepoint> expected
+	) {
+		INFO("pattern: " << std::string_view(reinterpret_cast<const char*>(pattern.data()), pattern.size()));
+		auto sm = regex_test::compile<data_types>(pattern);
+		REQUIRE_FALSE(sm.requires_backtracking());
+		for (cp::codepoint c : tested) {
+			INFO("codepoint: U+" << std::hex << std::uppercase << c);
+			bool should_match = std::find(expected.begin(), expected.end(), c) != expected.end();
+			CHECK(
+				regex_test::matches_entirely<data_types>(sm, cp::encodings::utf8::encode_codepoint_u8(c)) ==
+				should_match
+			);
+		}
+	}
+}
+
+TEST_CASE("Character classes around the end of Latin-1", "[regex.character_classes]") {
+	using character_classes::check;
+	check(
+		u8"[\\x{FE}-\\x{101}]",
+		{ 0x61, 0xFD, 0xFE, 0xFF, 0x100, 0x101, 0x102, 0x10000 },
+		{ 0xFE, 0xFF, 0x100, 0x101 }
+	);
+	check(u8"[\\x{100}-\\x{200}]", { 0xFE, 0xFF, 0x100, 0x200, 0x201 }, { 0x100, 0x200 });
+	check(u8"[a-z\\x{FF}]", { 0x61, 0x7A, 0xFE, 0xFF, 0x100, 0x17F }, { 0x61, 0x7A, 0xFF });
+	check(u8"[\\x{0}-\\x{10FFFF}]", { 0x0, 0xFF, 0x100, 0x10FFFF }, { 0x0, 0xFF, 0x100, 0x10FFFF });
+	check(u8"[\\x{3B1}-\\x{3C9}\\x{4E00}]", { 0xB1, 0x3B1, 0x3C9, 0x3CA, 0x4E00, 0x4E01 }, { 0x3B1, 0x3C9, 0x4E00 });
+}
+
+TEST_CASE("Negated character classes", "[regex.character_classes]") {
+	using character_classes::check;
+	check(u8"[^\\x{FF}\\x{100}]", { 0x61, 0xFE, 0xFF, 0x100, 0x101 }, { 0x61, 0xFE, 0x101 });
+	check(u8"[^a-z]", { 0x61, 0x7A, 0x41, 0xFF, 0x100 }, { 0x41, 0xFF, 0x100 });
+	check(u8"[^\\x{100}-\\x{10FFFF}]", { 0x0, 0xFF, 0x100, 0x10FFFF }, { 0x0, 0xFF });
+	check(u8"\\D", { 0x30, 0x39, 0x61, 0xFF, 0x100, 0x660 }, { 0x61, 0xFF, 0x100 });
+}
+
+TEST_CASE("Case-insensitive character classes", "[regex.character_classes]") {
+	using character_classes::check;
+	// U+00FF and U+0178 are case variants on both sides of the end of Latin-1
+	check(u8"(?i)[\\x{FF}]", { 0xFE, 0xFF, 0x178, 0x179 }, { 0xFF, 0x178 });
+	check(u8"(?i)[\\x{178}]", { 0xFE, 0xFF, 0x178, 0x179 }, { 0xFF, 0x178 });
+	// U+212A KELVIN SIGN folds to k
+	check(u8"(?i)[k]", { 0x4B, 0x6B, 0x212A, 0x6C }, { 0x4B, 0x6B, 0x212A });
+	check(u8"(?i)[\\x{212A}]", { 0x6B, 0x212A, 0x6C }, { 0x6B, 0x212A });
+	check(u8"(?i)[^k]", { 0x4B, 0x6B, 0x212A, 0x6C, 0x100 }, { 0x6C, 0x100 });
+	check(u8"(?i)[\\x{100}-\\x{101}]", { 0xFF, 0x100, 0x101, 0x102 }, { 0x100, 0x101 });
+}
+
+TEST_CASE("Literals and classes sharing pools", "[regex.character_classes]") {
+	using data_types = character_classes::data_types;
+	auto matches_entirely = regex_test::matches_entirely<data_types>;
+	auto sm = regex_test::compile<data_types>(u8"abc|[x-z]\\x{100}d|(?i)\\x{FF}[\\x{100}-\\x{17F}]e|[^\\x{100}]f");
+	REQUIRE_FALSE(sm.requires_backtracking());
+	CHECK(matches_entirely(sm, u8"abc"));
+	CHECK_FALSE(matches_entirely(sm, u8"abd"));
+	CHECK(matches_entirely(sm, u8"yĀd"));
+	CHECK_FALSE(matches_entirely(sm, u8"yād"));
+	CHECK(matches_entirely(sm, u8"Ÿſe"));
+	CHECK(matches_entirely(sm, u8"ÿĀE"));
+	CHECK_FALSE(matches_entirely(sm, u8"þĀe"));
+	CHECK(matches_entirely(sm, u8"ÿf"));
+	CHECK_FALSE(matches_entirely(sm, u8"Āf"));
+}
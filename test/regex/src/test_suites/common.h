@@ -0,0 +1,137 @@
+// Copyright (c) the Codepad contributors. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See LICENSE.txt in the project root for license information.
+
+#pragma once
+
+/// \file
+/// Types and helpers shared by the regex test suites, including helpers that run both matching engines.
+
+#include <sstream>
+
+#include <catch2/catch.hpp>
+
+#include <codepad/core/encodings.h>
+#include <codepad/core/regex/parser.h>
+#include <codepad/core/regex/parser.inl>
+#include <codepad/core/regex/compiler.h>
+#include <codepad/core/regex/matcher.h>
+#include <codepad/core/regex/matcher.inl>
+
+namespace cp = codepad;
+
+namespace regex_test {
+	using stream_t = cp::regex::basic_input_stream<cp::encodings::utf8, const std::byte*>; ///< UTF-8 input stream type.
+	/// Matcher type.
+	template <typename DataTypes> using matcher_t = cp::regex::matcher<stream_t, DataTypes>;
+	/// State machine type.
+	template <typename DataTypes> using state_machine_t = typename cp::regex::compiled<DataTypes>::state_machine;
+
+	/// The maximum number of matches collected by \ref find_all() and \ref find_all_backtracking(), to avoid
+	/// running forever if a matcher fails to make progress.
+	constexpr std::size_t max_num_matches = 1000;
+
+	/// Creates a stream for the given string.
+	[[nodiscard]] inline stream_t make_stream(std::u8string_view str) {
+		auto *data = reinterpret_cast<const std::byte*>(str.data());
+		return stream_t(data, data + str.size());
+	}
+
+	/// Parses and compiles the given pattern. Parsing errors fail the test.
+	template <typename DataTypes> [[nodiscard]] state_machine_t<DataTypes> compile(std::u8string_view pattern) {
+		cp::regex::parser<stream_t> parser([](const stream_t&, std::u8string_view msg) {
+			FAIL(std::string(reinterpret_cast<const char*>(msg.data()), msg.size()));
+		});
+		cp::regex::ast ast = parser.parse(make_stream(pattern), cp::regex::options());
+		cp::regex::compiler compiler;
+		return compiler.compile(ast, ast.analyze()).template finalize<DataTypes>();
+	}
+
+	/// Finds all matches using \ref cp::regex::matcher::find_all(), which uses the prefilter and, for expressions
+	/// that don't require backtracking, the linear engine.
+	template <typename DataTypes> [[nodiscard]] std::vector<typename matcher_t<DataTypes>::result> find_all(
+		matcher_t<DataTypes> &matcher, stream_t stream, const state_machine_t<DataTypes> &sm
+	) {
+		std::vector<typename matcher_t<DataTypes>::result> result;
+		matcher.find_all(stream, sm, [&](typename matcher_t<DataTypes>::result match) {
+			result.emplace_back(std::move(match));
+			return result.size() <= max_num_matches;
+		});
+		return result;
+	}
+	/// Finds all matches by calling \ref cp::regex::matcher::try_match() at every position, which always uses the
+	/// backtracking engine and no prefilter.
+	template <typename DataTypes> [[nodiscard]] std::vector<typename matcher_t<DataTypes>::result> find_all_backtracking(
+		matcher_t<DataTypes> &matcher, stream_t stream, const state_machine_t<DataTypes> &sm
+	) {
+		std::vector<typename matcher_t<DataTypes>::result> result;
+		bool reject_empty_match = false;
+		while (result.size() <= max_num_matches) {
+			stream_t temp = stream;
+			if (auto match = matcher.try_match(temp, sm, reject_empty_match)) {
+				reject_empty_match = stream.codepoint_position() == temp.codepoint_position();
+				result.emplace_back(std::move(match.value()));
+				stream = std::move(temp);
+				continue;
+			}
+			if (stream.empty()) {
+				break;
+			}
+			stream.take();
+			reject_empty_match = false;
+		}
+		return result;
+	}
+	/// Formats the positions of all captures of all matches.
+	template <typename Result> [[nodiscard]] std::string format_matches(const std::vector<Result> &matches) {
+		std::stringstream ss;
+		for (const auto &match : matches) {
+			ss << "{ ";
+			if (match.overriden_match_begin) {
+				ss << "start " << match.overriden_match_begin->codepoint_position() << ", ";
+			}
+			for (const auto &cap : match.captures) {
+				if (cap.is_valid()) {
+					std::size_t beg = cap.begin.codepoint_position();
+					ss << "[" << beg << ", " << beg + cap.length << "] ";
+				} else {
+					ss << "<unset> ";
+				}
+			}
+			ss << "} ";
+		}
+		return ss.str();
+	}
+	/// Finds all matches using both \ref find_all() and \ref find_all_backtracking(), and checks that they
+	/// produce the same matches and captures.
+	template <typename DataTypes> void check_engines_agree(
+		matcher_t<DataTypes> &matcher, const stream_t &stream, const state_machine_t<DataTypes> &sm
+	) {
+		CHECK(
+			format_matches(find_all(matcher, stream, sm)) ==
+			format_matches(find_all_backtracking(matcher, stream, sm))
+		);
+	}
+
+	/// Checks whether the entire subject is matched by both the backtracking and the linear engine, and that both
+	/// engines agree.
+	template <typename DataTypes> [[nodiscard]] bool matches_entirely(
+		const state_machine_t<DataTypes> &sm, std::u8string_view subject
+	) {
+		matcher_t<DataTypes> matcher;
+
+		stream_t backtrack_stream = make_stream(subject);
+		auto backtrack_result = matcher.try_match(backtrack_stream, sm, false);
+		bool backtrack_matched = backtrack_result && backtrack_stream.empty();
+
+		stream_t linear_stream = make_stream(subject);
+		bool reject_empty = false;
+		auto linear_result = matcher.find_next(linear_stream, sm, reject_empty);
+		bool linear_matched =
+			linear_result &&
+			linear_result->captures[0].begin.codepoint_position() == 0 &&
+			linear_stream.empty();
+
+		CHECK(backtrack_matched == linear_matched);
+		return backtrack_matched;
+	}
+}
@@ -0,0 +1,74 @@
+// Copyright (c) the Codepad contributors. All rights reserved.
+// Licensed under the Apache License, Version 2.0. See LICENSE.txt in the project root for license information.
+
+/// \file
+/// Tests for the first codepoint prefilter that's used to skip positions where no match can start.
+
+#include "common.h"
+
+namespace first_codepoints {
+	using data_types = cp::regex::data_types::unoptimized; ///< Data types.
+
+	/// Subject that contains ASCII and non-ASCII codepoints in different cases, including codepoints with
+	/// non-trivial case folding such as the Kelvin sign and the sharp S.
+	constexpr std::u8string_view subject =
+		u8"xAbaBcABC abcÀàb K k K ß SS ss\n"
+		u8"a1b22 aab aaab Āā zZ-_ Σσς end";
+
+	/// Checks that the given pattern has a prefilter iff \p expect_prefilter is \p true, and that matching with
+	/// the prefilter produces the same results as trying every position with the backtracking engine.
+	void check(std::u8string_view pattern, bool expect_prefilter) {
+		INFO("pattern: " << std::string_view(reinterpret_cast<const char*>(pattern.data()), pattern.size()));
+		auto sm = regex_test::compile<data_types>(pattern);
+		CHECK(sm.get_first_codepoints().has_value() == expect_prefilter);
+		regex_test::matcher_t<data_types> matcher;
+		regex_test::check_engines_agree(matcher, regex_test::make_stream(subject), sm);
+	}
+}
+
+TEST_CASE("Prefilter with case-insensitive literals", "[regex.first_codepoints]") {
+	using first_codepoints::check;
+	check(u8"(?i)abc", true);
+	check(u8"(?i)k", true);
+	check(u8"(?i)K", true);
+	check(u8"(?i)ss", true);
+	check(u8"(?i)ß", true);
+	check(u8"(?i)àB", true);
+	check(u8"(?i)σ+", true);
+	check(u8"(?i)ab|c", true);
+	check(u8"a(?i)b", true);
+	check(u8"(?i:a)B", true);
+	// atomic groups and possessive repetitions are matched by backtracking
+	check(u8"(?i)(?>ab|a)c", true);
+	check(u8"(?i)a++b", true);
+}
+
+TEST_CASE("Prefilter with character classes", "[regex.first_codepoints]") {
+	using first_codepoints::check;
+	check(u8"[a-c]+", true);
+	check(u8"[^a-z ]", true);
+	check(u8"\\d+|b", true);
+	check(u8"[\\x{100}-\\x{10FFFF}]", true);
+	check(u8"\\w\\d", true);
+	check(u8"(?i)[a-c]x?", true);
+	check(u8"(?i)[\\x{212A}]", true);
+	check(u8"(?i)[\\x{100}\\x{3C2}]", true);
+	check(u8"\\b[A-Z]", true);
+	check(u8"^[ax]", true);
+	check(u8"(?>[a-c]|\\s)+\\S", true);
+	// the negation of case-insensitive classes is not computed
+	check(u8"(?i)[^a-z]", false);
+}
+
+TEST_CASE("Prefilter with patterns that match empty strings", "[regex.first_codepoints]") {
+	using first_codepoints::check;
+	check(u8"a*", false);
+	check(u8"(?i)x*?", false);
+	check(u8"(?:abc)?", false);
+	check(u8"b|", false);
+	check(u8"(?i)|k", false);
+	check(u8"\\b", false);
+	check(u8"$", false);
+	check(u8"(?:[a-c]*)+", false);
+	check(u8"(?>a?)", false);
+}
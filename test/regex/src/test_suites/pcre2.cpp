@@ -9,13 +9,9 @@
 #include <sstream>
 #include <filesystem>
 
-#include <catch2/catch.hpp>
-
 #include <codepad/core/logging.h>
-#include <codepad/core/regex/matcher.h>
-#include <codepad/core/regex/matcher.inl>
 
-namespace cp = codepad;
+#include "common.h"
 
 /// Returns whether the character is a PCRE2 non-printing character.
 [[nodiscard]] bool is_non_printing_char(cp::codepoint c) {
@@ -97,9 +93,9 @@ struct test {
 	pattern_data pattern; ///< The pattern.
 	std::vector<test_data> data; ///< Test strings.
 };
-using stream_t = cp::regex::basic_input_stream<cp::encodings::utf8, const std::byte*>; ///< UTF-8 input stream type.
+using regex_test::stream_t;
 using data_types = cp::regex::data_types::small_expression; ///< Data types.
-using matcher_t = cp::regex::matcher<stream_t, data_types>; /// Matcher type.
+using matcher_t = regex_test::matcher_t<data_types>; ///< Matcher type.
 
 /// Fails with the given message.
 void fail(const char *msg = nullptr) {
@@ -680,6 +676,116 @@ void run_pcre2_tests(const std::filesystem::path &filename) {
 	}
 }
 
+/// Patterns for which the linear engine intentionally produces different results from the backtracking engine.
+/// When an iteration of a repetition matches an empty string, the backtracking engine abandons the repetition,
+/// while the linear engine still tries the other alternatives of that iteration like PCRE does. See
+/// \ref cp::regex::matcher::_find_next_linear().
+const std::set<std::u8string_view> linear_engine_differences{
+	u8"(|ab)*?d",
+};
+
+/// Patterns whose repetitions unroll to more nodes than this are not compared, since compiling them would take
+/// gigabytes of memory.
+constexpr std::size_t max_unrolled_size = 100000;
+/// Estimates the number of nodes the given AST node unrolls to when compiled. The result saturates at
+/// \ref max_unrolled_size.
+[[nodiscard]] std::size_t estimate_unrolled_size(const cp::regex::ast &ast, cp::regex::ast_nodes::node_ref n) {
+	return std::visit(
+		[&](const auto &node) -> std::size_t {
+			using node_t = std::decay_t<decltype(node)>;
+			std::size_t result = 1;
+			auto add = [&](std::size_t size) {
+				result = std::min(result + size, max_unrolled_size);
+			};
+			if constexpr (std::is_same_v<node_t, cp::regex::ast_nodes::literal>) {
+				add(node.contents.size());
+			} else if constexpr (std::is_same_v<node_t, cp::regex::ast_nodes::subexpression>) {
+				for (auto child : node.nodes) {
+					add(estimate_unrolled_size(ast, child));
+				}
+			} else if constexpr (std::is_same_v<node_t, cp::regex::ast_nodes::alternative>) {
+				for (auto child : node.alternatives) {
+					add(estimate_unrolled_size(ast, child));
+				}
+			} else if constexpr (std::is_same_v<node_t, cp::regex::ast_nodes::repetition>) {
+				std::size_t count = std::max<std::size_t>(
+					node.max == cp::regex::ast_nodes::repetition::no_limit ? node.min + 1 : node.max, 1
+				);
+				std::size_t body = estimate_unrolled_size(ast, node.expression);
+				add(count > max_unrolled_size / body ? max_unrolled_size : count * body);
+			} else if constexpr (std::is_same_v<node_t, cp::regex::ast_nodes::complex_assertion>) {
+				add(estimate_unrolled_size(ast, node.expression));
+			} else if constexpr (std::is_same_v<node_t, cp::regex::ast_nodes::conditional_expression>) {
+				add(estimate_unrolled_size(ast, node.if_true));
+				if (node.if_false) {
+					add(estimate_unrolled_size(ast, node.if_false.value()));
+				}
+			}
+			return result;
+		},
+		ast.get_node(n).value
+	);
+}
+
+/// Matches all expressions in the given file that don't require backtracking using both the linear engine and the
+/// backtracking engine, and checks that they produce the same matches and captures. Patterns whose repetitions
+/// unroll to more than \ref max_unrolled_size nodes are skipped.
+void compare_pcre2_engines(const std::filesystem::path &filename) {
+	std::vector<test> tests;
+	INFO("Test file: " << filename);
+	{
+		std::ifstream fin(filename, std::ios::binary);
+		fin.seekg(0, std::ios::end);
+		auto file_size = fin.tellg();
+		fin.seekg(0, std::ios::beg);
+		auto test_file = std::make_unique<std::byte[]>(file_size);
+		fin.read(reinterpret_cast<char*>(test_file.get()), file_size);
+		tests = parse_tests(test_file.get(), file_size);
+	}
+
+	matcher_t matcher;
+	cp::regex::parser<stream_t> parser([](const stream_t&, const std::u8string_view) {
+	});
+	cp::regex::compiler compiler;
+	for (const auto &test : tests) {
+		std::basic_string<std::byte> pattern_str;
+		for (cp::codepoint c : test.pattern.pattern) {
+			pattern_str.append(cp::encodings::utf8::encode_codepoint(c));
+		}
+		auto pattern_view = std::string_view(reinterpret_cast<const char*>(pattern_str.data()), pattern_str.size());
+		if (linear_engine_differences.contains(std::u8string_view(
+			reinterpret_cast<const char8_t*>(pattern_str.data()), pattern_str.size()
+		))) {
+			continue;
+		}
+		INFO("Pattern: " << pattern_view.substr(0, std::min<std::size_t>(300, pattern_view.size())));
+
+		stream_t pattern_stream(pattern_str.data(), pattern_str.data() + pattern_str.size());
+		cp::regex::ast ast = parser.parse(pattern_stream, test.pattern.options);
+		if (estimate_unrolled_size(ast, ast.root()) >= max_unrolled_size) {
+			continue;
+		}
+		auto sm = compiler.compile(ast, ast.analyze()).finalize<data_types>();
+		if (sm.requires_backtracking()) {
+			continue;
+		}
+
+		for (const auto &str : test.data) {
+			std::basic_string<std::byte> data_str;
+			for (cp::codepoint c : str.string) {
+				data_str.append(cp::encodings::utf8::encode_codepoint(c));
+			}
+			std::stringstream data_ss;
+			dump_string(data_ss, str.string);
+			INFO("Data string: " << data_ss.str());
+
+			regex_test::check_engines_agree(
+				matcher, stream_t(data_str.data(), data_str.data() + data_str.size()), sm
+			);
+		}
+	}
+}
+
 const std::filesystem::path directory = "thirdparty/pcre2/testdata";
 
 TEST_CASE("PCRE2 testinput1", "[regex.pcre2.testinput1]") {
@@ -689,3 +795,11 @@ TEST_CASE("PCRE2 testinput1", "[regex.pcre2.testinput1]") {
 TEST_CASE("PCRE2 testinput2", "[regex.pcre2.testinput2]") {
 	run_pcre2_tests(directory / "testinput2");
 }
+
+TEST_CASE("PCRE2 testinput1 with both matching engines", "[regex.pcre2.engines]") {
+	compare_pcre2_engines(directory / "testinput1");
+}
+
+TEST_CASE("PCRE2 testinput2 with both matching engines", "[regex.pcre2.engines]") {
+	compare_pcre2_engines(directory / "testinput2");
+}
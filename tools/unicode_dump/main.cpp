@@ -4,16 +4,287 @@
 #pragma once
 
 /// \file
-/// Reads and dumps the Unicode Character Database.
+/// Reads and dumps the Unicode Character Database, and generates lookup tables from it.
+///
+/// Usage:
+///  - `unicode_dump [UnicodeData.txt]`: dumps all ranges of decimal numbers.
+///  - `unicode_dump case_folding_tables [CaseFolding.txt]`: prints the contents of
+///    `include/codepad/core/unicode/case_folding_tables.h`.
+///  - `unicode_dump property_tables [UnicodeData.txt]`: prints the contents of
+///    `src/core/unicode/property_tables.inl`.
 
+#include <algorithm>
+#include <bit>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include <codepad/core/unicode/database.h>
 
 namespace cp = codepad;
 
+/// A two-stage lookup table. The value for a codepoint is
+/// `data[(blocks[cp >> block_bits] << block_bits) | (cp & ((1 << block_bits) - 1))]`, and codepoints past the
+/// last block have the default value.
+template <typename T> struct two_stage_table {
+	std::vector<std::size_t> blocks; ///< For each block of codepoints, the index of its contents in \ref data.
+	std::vector<T> data; ///< Contents of all unique blocks.
+};
+
+/// Builds a \ref two_stage_table from the values of all codepoints. Trailing codepoints with the default value
+/// are not included in the table.
+template <typename T> [[nodiscard]] two_stage_table<T> build_two_stage_table(
+	std::vector<T> values, std::size_t block_bits, const T &default_value
+) {
+	const std::size_t block_size = static_cast<std::size_t>(1) << block_bits;
+	while (!values.empty() && values.back() == default_value) {
+		values.pop_back();
+	}
+	values.resize((values.size() + block_size - 1) / block_size * block_size, default_value);
+
+	two_stage_table<T> result;
+	std::map<std::vector<T>, std::size_t> unique_blocks;
+	for (std::size_t begin = 0; begin < values.size(); begin += block_size) {
+		std::vector<T> block(values.begin() + begin, values.begin() + begin + block_size);
+		auto [it, inserted] = unique_blocks.try_emplace(std::move(block), unique_blocks.size());
+		if (inserted) {
+			result.data.insert(result.data.end(), it->first.begin(), it->first.end());
+		}
+		result.blocks.emplace_back(it->second);
+	}
+	return result;
+}
+
+/// Returns the smallest unsigned integer type that can hold the given value.
+[[nodiscard]] std::string_view get_index_type(std::size_t max_value) {
+	if (max_value <= std::numeric_limits<std::uint8_t>::max()) {
+		return "std::uint8_t";
+	}
+	if (max_value <= std::numeric_limits<std::uint16_t>::max()) {
+		return "std::uint16_t";
+	}
+	return "std::uint32_t";
+}
+
+/// Writes the definition of a constexpr array.
+template <typename T> void write_array(
+	std::ostream &out, std::string_view comment, std::string_view type, std::string_view name,
+	const std::vector<T> &values
+) {
+	constexpr std::size_t _max_line_width = 112; // excluding indentation
+
+	out << "\t/// " << comment << "\n";
+	out << "\tinline constexpr " << type << " " << name << "[] = {";
+	std::size_t line_width = _max_line_width;
+	for (const T &val : values) {
+		std::string str = std::to_string(static_cast<std::int64_t>(val)) + ",";
+		if (line_width + 1 + str.size() > _max_line_width) {
+			out << "\n\t\t";
+			line_width = 0;
+		} else {
+			out << " ";
+			++line_width;
+		}
+		out << str;
+		line_width += str.size();
+	}
+	out << "\n\t};\n";
+}
+
+/// Writes the license, the file comment, includes, and the beginning of the namespace of a generated file.
+void write_file_header(std::ostream &out, std::string_view file_comment, std::string_view includes) {
+	out <<
+		"// Copyright (c) the Codepad contributors. All rights reserved.\n"
+		"// Licensed under the Apache License, Version 2.0. See LICENSE.txt in the project root for license "
+		"information.\n"
+		"\n"
+		"#pragma once\n"
+		"\n"
+		"/// \\file\n" << file_comment <<
+		"\n"
+		"#include <cstddef>\n"
+		"#include <cstdint>\n"
+		"\n" << includes <<
+		"\n"
+		"namespace codepad::unicode::tables {\n";
+}
+
+/// Writes the header that contains lookup tables for simple case folding.
+void write_case_folding_tables(std::ostream &out, const cp::unicode::case_folding &folding) {
+	constexpr std::size_t _block_bits = 7;
+
+	std::vector<std::int32_t> deltas(cp::unicode::codepoint_max + 1, 0);
+	std::map<cp::codepoint, std::vector<cp::codepoint>> inverse;
+	for (auto [from, to] : folding.simple) {
+		deltas[from] = static_cast<std::int32_t>(to) - static_cast<std::int32_t>(from);
+		inverse[to].emplace_back(from);
+	}
+	// inverse mappings are stored contiguously, and indexed by the position of the mapping plus one, with index 0
+	// meaning that there are no mappings
+	std::vector<std::size_t> inverse_indices(cp::unicode::codepoint_max + 1, 0);
+	std::vector<std::size_t> inverse_offsets{ 0 };
+	std::vector<cp::codepoint> inverse_data;
+	for (auto &[to, froms] : inverse) {
+		std::sort(froms.begin(), froms.end());
+		inverse_data.insert(inverse_data.end(), froms.begin(), froms.end());
+		inverse_indices[to] = inverse_offsets.size();
+		inverse_offsets.emplace_back(inverse_data.size());
+	}
+	auto delta_table = build_two_stage_table(std::move(deltas), _block_bits, 0);
+	auto inverse_table = build_two_stage_table(std::move(inverse_indices), _block_bits, static_cast<std::size_t>(0));
+
+	write_file_header(
+		out,
+		"/// Lookup tables for simple case folding. This file is generated by `unicode_dump case_folding_tables` "
+		"from\n"
+		"/// CaseFolding.txt and should not be modified manually.\n",
+		"#include \"common.h\"\n"
+	);
+	out <<
+		"\t/// The number of low bits of a codepoint used to index into a block of the case folding tables.\n"
+		"\tinline constexpr std::size_t case_folding_block_bits = " << _block_bits << ";\n";
+	write_array(
+		out, "For each block of codepoints, the index of the block in \\ref simple_case_folding_deltas.",
+		get_index_type(delta_table.data.size() >> _block_bits), "simple_case_folding_blocks", delta_table.blocks
+	);
+	write_array(
+		out, "Differences between the simple case folding of codepoints and the codepoints themselves.",
+		"std::int32_t", "simple_case_folding_deltas", delta_table.data
+	);
+	write_array(
+		out, "For each block of codepoints, the index of the block in \\ref simple_case_folding_inverse_indices.",
+		get_index_type(inverse_table.data.size() >> _block_bits), "simple_case_folding_inverse_blocks",
+		inverse_table.blocks
+	);
+	write_array(
+		out, "Indices in \\ref simple_case_folding_inverse_offsets of all codepoints, or 0 if there's none.",
+		get_index_type(inverse_offsets.size()), "simple_case_folding_inverse_indices", inverse_table.data
+	);
+	write_array(
+		out,
+		"Codepoints with mapping index \\p i are `[offsets[i - 1], offsets[i])` in the data array below.",
+		get_index_type(inverse_data.size()), "simple_case_folding_inverse_offsets", inverse_offsets
+	);
+	write_array(
+		out, "Codepoints that are folded to other codepoints, grouped by the result of folding.",
+		"codepoint", "simple_case_folding_inverse_data", inverse_data
+	);
+	out << "}\n";
+}
+
+/// Writes the source file that contains lookup tables for properties in UnicodeData.txt.
+void write_property_tables(std::ostream &out, const cp::unicode::unicode_data &data) {
+	constexpr std::size_t _block_bits = 7;
+	constexpr auto _num_categories = static_cast<std::size_t>(cp::unicode::general_category_index::num_categories);
+
+	// codepoints that are not listed are unassigned
+	std::vector<std::uint8_t> categories(
+		cp::unicode::codepoint_max + 1,
+		static_cast<std::uint8_t>(cp::unicode::general_category_index::unassigned)
+	);
+	std::vector<std::uint8_t> bidi_classes(
+		cp::unicode::codepoint_max + 1, static_cast<std::uint8_t>(cp::unicode::bidi_class::unknown)
+	);
+	std::vector<std::uint8_t> combining_classes(cp::unicode::codepoint_max + 1, 0);
+	std::vector<cp::codepoint_range_list> category_ranges(_num_categories);
+	for (const auto &entry : data.entries) {
+		auto category = static_cast<std::uint8_t>(std::countr_zero(static_cast<std::uint32_t>(entry.category)));
+		for (cp::codepoint c = entry.value.first; c <= entry.value.last; ++c) {
+			categories[c] = category;
+			bidi_classes[c] = static_cast<std::uint8_t>(entry.bidi_cls);
+			combining_classes[c] = static_cast<std::uint8_t>(entry.canonical_combining_class);
+		}
+		auto &ranges = category_ranges[category].ranges;
+		if (!ranges.empty() && ranges.back().last + 1 == entry.value.first) {
+			ranges.back().last = entry.value.last;
+		} else {
+			ranges.emplace_back(entry.value);
+		}
+	}
+	// the ranges of all categories are stored contiguously as pairs of the first and last codepoints
+	std::vector<std::size_t> range_offsets{ 0 };
+	std::vector<cp::codepoint> range_data;
+	for (const auto &list : category_ranges) {
+		for (const auto &range : list.ranges) {
+			range_data.emplace_back(range.first);
+			range_data.emplace_back(range.last);
+		}
+		range_offsets.emplace_back(range_data.size() / 2);
+	}
+
+	auto category_table = build_two_stage_table(
+		std::move(categories), _block_bits, static_cast<std::uint8_t>(cp::unicode::general_category_index::unassigned)
+	);
+	auto bidi_table = build_two_stage_table(
+		std::move(bidi_classes), _block_bits, static_cast<std::uint8_t>(cp::unicode::bidi_class::unknown)
+	);
+	auto combining_table = build_two_stage_table(
+		std::move(combining_classes), _block_bits, static_cast<std::uint8_t>(0)
+	);
+
+	write_file_header(
+		out,
+		"/// Lookup tables for properties in UnicodeData.txt. This file is generated by\n"
+		"/// `unicode_dump property_tables` and should not be modified manually.\n",
+		"#include \"codepad/core/unicode/common.h\"\n"
+	);
+	out <<
+		"\t/// The number of low bits of a codepoint used to index into a block of the property tables.\n"
+		"\tinline constexpr std::size_t property_block_bits = " << _block_bits << ";\n";
+	write_array(
+		out, "For each block of codepoints, the index of the block in \\ref general_category_data.",
+		get_index_type(category_table.data.size() >> _block_bits), "general_category_blocks", category_table.blocks
+	);
+	write_array(
+		out, "The \\ref general_category_index of all codepoints.",
+		"std::uint8_t", "general_category_data", category_table.data
+	);
+	write_array(
+		out, "For each block of codepoints, the index of the block in \\ref bidi_class_data.",
+		get_index_type(bidi_table.data.size() >> _block_bits), "bidi_class_blocks", bidi_table.blocks
+	);
+	write_array(
+		out, "The \\ref bidi_class of all codepoints.",
+		"std::uint8_t", "bidi_class_data", bidi_table.data
+	);
+	write_array(
+		out, "For each block of codepoints, the index of the block in \\ref canonical_combining_class_data.",
+		get_index_type(combining_table.data.size() >> _block_bits), "canonical_combining_class_blocks",
+		combining_table.blocks
+	);
+	write_array(
+		out, "The canonical combining class of all codepoints.",
+		"std::uint8_t", "canonical_combining_class_data", combining_table.data
+	);
+	write_array(
+		out, "Ranges of category \\p i are `[offsets[i], offsets[i + 1])` in the range array below.",
+		get_index_type(range_offsets.back()), "general_category_range_offsets", range_offsets
+	);
+	write_array(
+		out, "First and last codepoints of ranges of codepoints in each category, sorted by category.",
+		"codepoint", "general_category_ranges", range_data
+	);
+	out << "}\n";
+}
+
 int main(int argc, char **argv) {
+	std::string_view command = argc > 1 ? argv[1] : "";
+	if (command == "case_folding_tables") {
+		const char *path = argc > 2 ? argv[2] : "thirdparty/ucd/CaseFolding.txt";
+		write_case_folding_tables(std::cout, cp::unicode::case_folding::parse(path));
+		return 0;
+	}
+	if (command == "property_tables") {
+		const char *path = argc > 2 ? argv[2] : "thirdparty/ucd/UnicodeData.txt";
+		write_property_tables(std::cout, cp::unicode::unicode_data::parse(path));
+		return 0;
+	}
+
 	const char *path = argc > 1 ? argv[1] : "thirdparty/ucd/UnicodeData.txt";
 	auto database = cp::unicode::unicode_data::parse(path);
 	for (const auto &entry : database.get_codepoints_in_category(cp::unicode::general_category::decimal_number).ranges) {